@@ -0,0 +1,336 @@
+
+/*
+<https://github.com/rafagafe/tiny-json>
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "json-maker.hpp"
+
+#if __has_include( <nlohmann/json.hpp> )
+#include <nlohmann/json.hpp>
+#define BENCH_NLOHMANN 1
+#endif
+
+using namespace jsonmaker;
+using namespace jsonmaker::literals;
+
+// ------------------------------------------------------ Bench "framework": ---
+
+/* Sink the compiler can not see through, so the work is not optimized out. */
+static char volatile sink;
+
+static double now( void ) {
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration< double >( clock::now().time_since_epoch() ).count();
+}
+
+enum { warmupms = 20, numsamples = 101 };
+
+/* Run an operation that writes the document and returns its length. The
+   warm-up sizes the batches to about a millisecond, then each batch is a
+   sample and the percentiles of the time of an operation are reported. */
+template< class Op >
+static void measure( char const* name, Op op ) {
+    size_t bytes = 0;
+    long batch = 0;
+    double const start = now();
+    do {
+        bytes = op();
+        ++batch;
+    } while( now() - start < warmupms * 1e-3 );
+    batch = batch / warmupms > 1 ? batch / warmupms : 1;
+    std::array< double, numsamples > ns;
+    for( double& s: ns ) {
+        double const t = now();
+        for( long i = 0; i < batch; ++i )
+            sink = (char)op();
+        s = ( now() - t ) * 1e9 / batch;
+    }
+    std::sort( ns.begin(), ns.end() );
+    double const p50 = ns[ numsamples / 2 ];
+    double const p90 = ns[ numsamples * 9 / 10 ];
+    double const p99 = ns[ numsamples * 99 / 100 ];
+    printf( " %-32s %8.0f %8.0f %8.0f %8.0f %9.1f\n", name, ns[ 0 ], p50, p90, p99, bytes / p50 * 1e3 );
+}
+
+// -------------------------------------------------------------- Document: ---
+
+struct reading {
+    long long time;
+    double temp;
+    int hum;
+    bool valid;
+};
+
+struct telemetry {
+    std::string device;
+    std::uint64_t serial;
+    std::vector< std::string > tags;
+    std::vector< reading > readings;
+    std::vector< int > counters;
+};
+
+static telemetry makeDocument( void ) {
+    telemetry t;
+    t.device = "meter-7 \"north\"";
+    t.serial = 0x1234567890ULL;
+    t.tags = { "roof", "solar", "v2" };
+    for( int i = 0; i < 32; ++i )
+        t.readings.push_back( { 1700000000000LL + i * 1000, 20.5 + i * 0.25, 40 + i % 20, i % 7 != 0 } );
+    for( int i = 0; i < 16; ++i )
+        t.counters.push_back( i * i * 37 );
+    return t;
+}
+
+// ------------------------------------------------------------ C++ writer: ---
+
+static void jsonFields( JsonWriter& w, reading const& r ) {
+    w.field( "time"_jk, r.time )
+     .field( "temp"_jk, r.temp )
+     .field( "hum"_jk, r.hum )
+     .field( "valid"_jk, r.valid );
+}
+
+static void jsonFields( JsonWriter& w, telemetry const& t ) {
+    w.field( "device"_jk, t.device )
+     .field( "serial"_jk, t.serial )
+     .field( "tags"_jk, t.tags )
+     .field( "readings"_jk, t.readings )
+     .field( "counters", t.counters );
+}
+
+static size_t cppWriter( telemetry const& t, char* buff, size_t size ) {
+    JsonWriter w( buff, size );
+    w << t;
+    return w.end();
+}
+
+// ---------------------------------------------------------------- C chain: ---
+
+static size_t cChain( telemetry const& t, char* buff, size_t size ) {
+    static jsonKey_t const device = JSON_KEY( "device" );
+    static jsonKey_t const serial = JSON_KEY( "serial" );
+    static jsonKey_t const tags = JSON_KEY( "tags" );
+    static jsonKey_t const readings = JSON_KEY( "readings" );
+    static jsonKey_t const time = JSON_KEY( "time" );
+    static jsonKey_t const temp = JSON_KEY( "temp" );
+    static jsonKey_t const hum = JSON_KEY( "hum" );
+    static jsonKey_t const valid = JSON_KEY( "valid" );
+    jsonWriter_t w;
+    jsonw_init( &w, buff, size );
+    jsonw_objOpen( &w, NULL );
+    jsonw_strLen_k( &w, &device, t.device.data(), t.device.size() );
+    jsonw_ulong_k( &w, &serial, t.serial );
+    jsonw_arrOpen_k( &w, &tags );
+    for( std::string const& tag: t.tags )
+        jsonw_strLen( &w, NULL, tag.data(), tag.size() );
+    jsonw_arrClose( &w );
+    jsonw_arrOpen_k( &w, &readings );
+    for( reading const& r: t.readings ) {
+        jsonw_objOpen( &w, NULL );
+        jsonw_verylong_k( &w, &time, r.time );
+        jsonw_double_k( &w, &temp, r.temp );
+        jsonw_int_k( &w, &hum, r.hum );
+        jsonw_bool_k( &w, &valid, r.valid );
+        jsonw_objClose( &w );
+    }
+    jsonw_arrClose( &w );
+    jsonw_intArray( &w, "counters", t.counters.data(), t.counters.size() );
+    jsonw_objClose( &w );
+    return jsonw_end( &w );
+}
+
+// ------------------------------------------------------------ Minimal DOM: ---
+
+/* A tree of values built first and serialized after, as the DOM libraries
+   do: one allocation per string, array and object. */
+class Value {
+public:
+    using Array = std::vector< Value >;
+    using Object = std::vector< std::pair< std::string, Value > >;
+
+    Value(): kind_( null ), u_( 0 ) { }
+    Value( bool b ): kind_( boolean ), b_( b ) { }
+    Value( int i ): kind_( integer ), i_( i ) { }
+    Value( long long i ): kind_( integer ), i_( i ) { }
+    Value( unsigned long long u ): kind_( uinteger ), u_( u ) { }
+    Value( double d ): kind_( real ), d_( d ) { }
+    Value( std::string s ): kind_( string ), u_( 0 ), s_( std::move( s ) ) { }
+    Value( Array a ): kind_( array ), u_( 0 ), items_( std::move( a ) ) { }
+    Value( Object o ): kind_( object ), u_( 0 ), fields_( std::move( o ) ) { }
+
+    Value& operator[]( char const* name ) {
+        fields_.emplace_back( name, Value() );
+        return fields_.back().second;
+    }
+
+    void push_back( Value v ) { items_.push_back( std::move( v ) ); }
+
+    std::string dump() const {
+        std::string out;
+        dump( out );
+        return out;
+    }
+
+private:
+    static void escape( std::string& out, std::string const& s ) {
+        out += '\"';
+        for( char const ch: s ) {
+            if ( ch == '\"' || ch == '\\' ) {
+                out += '\\';
+                out += ch;
+            }
+            else if ( (unsigned char)ch < ' ' ) {
+                char esc[ 8 ];
+                snprintf( esc, sizeof esc, "\\u%04X", (unsigned char)ch );
+                out += esc;
+            }
+            else
+                out += ch;
+        }
+        out += '\"';
+    }
+
+    void dump( std::string& out ) const {
+        char num[ 32 ];
+        switch( kind_ ) {
+            case null: out += "null"; break;
+            case boolean: out += b_ ? "true" : "false"; break;
+            case integer: out.append( num, std::to_chars( num, num + sizeof num, i_ ).ptr ); break;
+            case uinteger: out.append( num, std::to_chars( num, num + sizeof num, u_ ).ptr ); break;
+            case real: out.append( num, (size_t)snprintf( num, sizeof num, "%.17g", d_ ) ); break;
+            case string: escape( out, s_ ); break;
+            case array: {
+                out += '[';
+                char const* sep = "";
+                for( Value const& item: items_ ) {
+                    out += sep;
+                    item.dump( out );
+                    sep = ",";
+                }
+                out += ']';
+                break;
+            }
+            case object: {
+                out += '{';
+                char const* sep = "";
+                for( auto const& field: fields_ ) {
+                    out += sep;
+                    escape( out, field.first );
+                    out += ':';
+                    field.second.dump( out );
+                    sep = ",";
+                }
+                out += '}';
+                break;
+            }
+        }
+    }
+
+    enum kind { null, boolean, integer, uinteger, real, string, array, object } kind_;
+    union {
+        bool b_;
+        long long i_;
+        unsigned long long u_;
+        double d_;
+    };
+    std::string s_;
+    Array items_;
+    Object fields_;
+};
+
+static size_t minimalDom( telemetry const& t ) {
+    Value doc( Value::Object{} );
+    doc[ "device" ] = t.device;
+    doc[ "serial" ] = static_cast< unsigned long long >( t.serial );
+    Value& tags = doc[ "tags" ] = Value::Array{};
+    for( std::string const& tag: t.tags )
+        tags.push_back( tag );
+    Value& readings = doc[ "readings" ] = Value::Array{};
+    for( reading const& r: t.readings ) {
+        Value item( Value::Object{} );
+        item[ "time" ] = r.time;
+        item[ "temp" ] = r.temp;
+        item[ "hum" ] = r.hum;
+        item[ "valid" ] = r.valid;
+        readings.push_back( std::move( item ) );
+    }
+    Value& counters = doc[ "counters" ] = Value::Array{};
+    for( int const c: t.counters )
+        counters.push_back( c );
+    return doc.dump().size();
+}
+
+// --------------------------------------------------------------- nlohmann: ---
+
+#ifdef BENCH_NLOHMANN
+
+template< class Json >
+static size_t nlohmannDom( telemetry const& t ) {
+    Json doc;
+    doc[ "device" ] = t.device;
+    doc[ "serial" ] = t.serial;
+    doc[ "tags" ] = t.tags;
+    Json& readings = doc[ "readings" ] = Json::array();
+    for( reading const& r: t.readings )
+        readings.push_back( { { "time", r.time }, { "temp", r.temp }, { "hum", r.hum }, { "valid", r.valid } } );
+    doc[ "counters" ] = t.counters;
+    return doc.dump().size();
+}
+
+#endif
+
+int main( void ) {
+    telemetry const t = makeDocument();
+    static char buff[ 8192 ];
+    static char cbuff[ 8192 ];
+    size_t const len = cChain( t, cbuff, sizeof cbuff );
+    if ( len != cppWriter( t, buff, sizeof buff ) || 0 != strcmp( buff, cbuff ) ) {
+        printf( "%s\n", "The C++ writer and the C chain do not match." );
+        return 1;
+    }
+    printf( "\nDocument of %zu bytes, %zu readings:\n", len, t.readings.size() );
+    printf( " %-32s %8s %8s %8s %8s %9s\n", "ns per document:", "min", "p50", "p90", "p99", "MB/s" );
+    measure( "C chain with keys", [&]{ return cChain( t, buff, sizeof buff ); } );
+    measure( "C++ JsonWriter", [&]{ return cppWriter( t, buff, sizeof buff ); } );
+    measure( "Minimal DOM and dump", [&]{ return minimalDom( t ); } );
+#ifdef BENCH_NLOHMANN
+    measure( "nlohmann::json and dump", [&]{ return nlohmannDom< nlohmann::json >( t ); } );
+    measure( "nlohmann::ordered_json and dump", [&]{ return nlohmannDom< nlohmann::ordered_json >( t ); } );
+#else
+    printf( " %-32s %s\n", "nlohmann::json", "not found, see BENCHFLAGS in the makefile" );
+#endif
+    return 0;
+}
@@ -0,0 +1,1526 @@
+
+/*
+<https://github.com/rafagafe/tiny-json>
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+*/
+
+#ifdef __linux__
+#define _GNU_SOURCE // For the affinity of the CPU
+#endif
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "json-maker.h"
+
+#ifndef JSON_UTF8
+#define JSON_UTF8 JSON_UTF8_PASS
+#endif
+
+// ------------------------------------------------------ Bench "framework": ---
+
+/* Sink the compiler can not see through, so the work is not optimized out. */
+static char volatile sink;
+
+static double now( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The configuration of the build in the machine-readable output. */
+#ifdef NO_SPRINTF
+#define CONFIG_LIB "nosprintf"
+#else
+#define CONFIG_LIB "default"
+#endif
+
+#if defined(JSON_NO_SIMD)
+#define CONFIG_SIMD "scalar"
+#elif defined(__AVX2__)
+#define CONFIG_SIMD "avx2"
+#elif defined(__SSE2__) || defined(_M_X64)
+#define CONFIG_SIMD "sse2"
+#elif defined(__ARM_NEON)
+#define CONFIG_SIMD "neon"
+#else
+#define CONFIG_SIMD "scalar"
+#endif
+
+#if defined(JSON_MAKER_IMPLEMENTATION)
+#define CONFIG_LINK "header"
+#elif defined(BENCH_LTO)
+#define CONFIG_LINK "lto"
+#else
+#define CONFIG_LINK "separate"
+#endif
+
+/* Machine-readable output, one metric per line, or null. */
+static FILE* csv;
+static char section_title[ 96 ];
+
+/* Start a section of the report. */
+static void section( char const* title ) {
+    snprintf( section_title, sizeof section_title, "%s", title );
+    printf( "\n%s:\n", title );
+}
+
+static void csvrow( char const* name, char const* metric, double value ) {
+    if ( NULL != csv )
+        fprintf( csv, "%s/%s/%s,\"%s\",\"%s\",%s,%.6g\n", CONFIG_LIB, CONFIG_SIMD, CONFIG_LINK, section_title, name, metric, value );
+}
+
+static void report( char const* name, double secs, double bytes ) {
+    printf( " %-32s %8.3f GB/s\n", name, bytes / secs * 1e-9 );
+    csvrow( name, "MB/s", bytes / secs * 1e-6 );
+}
+
+static void reportops( char const* name, double secs, double ops ) {
+    printf( " %-32s %8.2f ns/op\n", name, secs / ops * 1e9 );
+    csvrow( name, "ns/op", secs / ops * 1e9 );
+}
+
+static void reportrate( char const* name, double secs, double elems ) {
+    printf( " %-32s %8.1f M elements/s\n", name, elems / secs * 1e-6 );
+    csvrow( name, "Melements/s", elems / secs * 1e-6 );
+}
+
+/* Time stamp counter for the cycles, zero where there is none. It ticks at
+   the nominal frequency, so with turbo the cycles are an estimate. */
+static unsigned long long cycles( void ) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#ifdef __linux__
+static cpu_set_t freecpus;
+
+/* Pin the thread to a CPU, the one in BENCH_CPU or the current one. */
+static void pin( void ) {
+    sched_getaffinity( 0, sizeof freecpus, &freecpus );
+    char const* const env = getenv( "BENCH_CPU" );
+    int const cpu = NULL != env ? atoi( env ) : sched_getcpu();
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
+    if ( 0 == sched_setaffinity( 0, sizeof set, &set ) )
+        printf( "Pinned to CPU %d\n", cpu );
+}
+
+/* Let the thread and the threads it creates run on any CPU again. */
+static void unpin( void ) {
+    sched_setaffinity( 0, sizeof freecpus, &freecpus );
+}
+#else
+static void pin( void ) { }
+static void unpin( void ) { }
+#endif
+
+/* An operation of the suite. It makes some calls and returns the length of
+   the JSON that they wrote. */
+typedef size_t (*benchop_t)( void const* arg );
+
+enum { warmupms = 20, numsamples = 101 };
+
+static int cmpdouble( void const* a, void const* b ) {
+    double const x = *(double const*)a;
+    double const y = *(double const*)b;
+    return ( x > y ) - ( x < y );
+}
+
+/* Run an operation of the suite. The warm-up sizes the batches to about a
+   millisecond, then each batch is a sample and the percentiles of the time
+   of a call are reported. */
+static void measure( char const* name, benchop_t op, void const* arg, int calls ) {
+    size_t bytes = 0;
+    long batch = 0;
+    double const start = now();
+    do {
+        bytes = op( arg );
+        ++batch;
+    } while( now() - start < warmupms * 1e-3 );
+    batch = batch / warmupms > 1 ? batch / warmupms : 1;
+    static double ns[ numsamples ];
+    static double cyc[ numsamples ];
+    for( int s = 0; s < numsamples; ++s ) {
+        double const t = now();
+        unsigned long long const c = cycles();
+        for( long i = 0; i < batch; ++i )
+            sink = (char)op( arg );
+        cyc[ s ] = (double)( cycles() - c ) / batch;
+        ns[ s ] = ( now() - t ) * 1e9 / batch / calls;
+    }
+    qsort( ns, numsamples, sizeof *ns, cmpdouble );
+    qsort( cyc, numsamples, sizeof *cyc, cmpdouble );
+    double const p50 = ns[ numsamples / 2 ];
+    double const p90 = ns[ numsamples * 9 / 10 ];
+    double const p99 = ns[ numsamples * 99 / 100 ];
+    double const mbs = bytes / ( p50 * calls ) * 1e3;
+    double const cpb = cyc[ numsamples / 2 ] / bytes;
+    printf( " %-32s %8.2f %8.2f %8.2f %8.2f %9.1f %7.2f\n", name, ns[0], p50, p90, p99, mbs, cpb );
+    csvrow( name, "ns/op min", ns[0] );
+    csvrow( name, "ns/op p50", p50 );
+    csvrow( name, "ns/op p90", p90 );
+    csvrow( name, "ns/op p99", p99 );
+    csvrow( name, "MB/s", mbs );
+    if ( 0 != cyc[ numsamples / 2 ] )
+        csvrow( name, "cycles/B", cpb );
+}
+
+/* Start a section of the suite with the heading of the columns. */
+static void suite( char const* title ) {
+    section( title );
+    printf( " %-32s %8s %8s %8s %8s %9s %7s\n", "ns per call:", "min", "p50", "p90", "p99", "MB/s", "cyc/B" );
+}
+
+// -------------------------------------------------------- Legacy versions: ---
+
+/* The byte-by-byte escaping that json_nstr() used before the lookup table. */
+static char* legacy_atoesc( char* dest, char const* src, size_t* remLen ) {
+    static char const spec[] = "\"\\/\b\f\n\r\t";
+    static char const code[] = "\"\\/bfnrt";
+    for( ; *src != '\0' && *remLen != 0; ++src ) {
+        if ( *src >= ' ' && *src != '\"' && *src != '\\' && *src != '/' ) {
+            *dest++ = *src;
+            --*remLen;
+            continue;
+        }
+        char const* pos = strchr( spec, *src );
+        char seq[ 8 ];
+        int const len = NULL != pos
+                      ? sprintf( seq, "\\%c", code[ pos - spec ] )
+                      : sprintf( seq, "\\u%04X", (unsigned char)*src );
+        for( int i = 0; i < len && *remLen != 0; ++i, --*remLen )
+            *dest++ = seq[i];
+    }
+    *dest = '\0';
+    return dest;
+}
+
+// ------------------------------------------------------------- Benchmarks: ---
+
+enum { strsize = 4096, totalbytes = 1 << 28 };
+
+/* Fill a string with printable text and a special character every period. */
+static void fill( char* str, size_t len, int period ) {
+    static char const special[] = "\"\\\n\t/\x01";
+    for( size_t i = 0; i < len; ++i )
+        str[i] = 0 != period && 0 == i % period
+               ? special[ ( i / period ) % ( sizeof special - 1 ) ]
+               : 'a' + i % 26;
+    str[ len ] = '\0';
+}
+
+static void bench_escape( char const* name, int period ) {
+    static char str[ strsize + 1 ];
+    static char buff[ 6 * strsize + 16 ];
+    fill( str, strsize, period );
+    int const reps = totalbytes / strsize;
+    char label[ 64 ];
+
+    double start = now();
+    for( int i = 0; i < reps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_str( buff, NULL, str, &rem );
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "json_str %s", name );
+    report( label, now() - start, (double)reps * strsize );
+
+    start = now();
+    for( int i = 0; i < reps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_strLen( buff, NULL, str, strsize, &rem );
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "json_strLen %s", name );
+    report( label, now() - start, (double)reps * strsize );
+
+    start = now();
+    for( int i = 0; i < reps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = legacy_atoesc( buff, str, &rem );
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "legacy %s", name );
+    report( label, now() - start, (double)reps * strsize );
+}
+
+/* Fill a string repeating a sample text, padded with ASCII letters. */
+static void utf8fill( char* str, size_t len, char const* text ) {
+    size_t const textlen = strlen( text );
+    size_t i = 0;
+    for( ; i + textlen <= len; i += textlen )
+        memcpy( str + i, text, textlen );
+    memset( str + i, 'a', len - i );
+    str[ len ] = '\0';
+}
+
+static void bench_utf8( char const* name, char const* text ) {
+    static char str[ strsize + 1 ];
+    static char buff[ 6 * strsize + 16 ];
+    utf8fill( str, strsize, text );
+    int const reps = totalbytes / strsize;
+    double const start = now();
+    for( int i = 0; i < reps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_strLen( buff, NULL, str, strsize, &rem );
+        sink = p[-1];
+    }
+    char label[ 64 ];
+    snprintf( label, sizeof label, "json_strLen %s", name );
+    report( label, now() - start, (double)reps * strsize );
+}
+
+/* The usual way without binary emitters: encode in a temporary string with a
+   lookup table and then add it as a string. */
+static size_t tablebase64( char* dest, unsigned char const* src, size_t len ) {
+    static char const digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char* p = dest;
+    for( size_t i = 0; i < len; i += 3 ) {
+        unsigned long x = (unsigned long)src[i] << 16;
+        if ( i + 1 < len ) x |= (unsigned long)src[i+1] << 8;
+        if ( i + 2 < len ) x |= src[i+2];
+        *p++ = digits[ x >> 18 ];
+        *p++ = digits[ x >> 12 & 63 ];
+        *p++ = i + 1 < len ? digits[ x >> 6 & 63 ] : '=';
+        *p++ = i + 2 < len ? digits[ x & 63 ] : '=';
+    }
+    *p = '\0';
+    return p - dest;
+}
+
+static size_t tablehex( char* dest, unsigned char const* src, size_t len ) {
+    for( size_t i = 0; i < len; ++i ) {
+        dest[ 2 * i ] = "0123456789abcdef"[ src[i] >> 4 ];
+        dest[ 2 * i + 1 ] = "0123456789abcdef"[ src[i] & 15 ];
+    }
+    dest[ 2 * len ] = '\0';
+    return 2 * len;
+}
+
+static void bench_binary( void ) {
+    static unsigned char data[ strsize ];
+    static char tmp[ 2 * strsize + 1 ];
+    static char buff[ 2 * strsize + 16 ];
+    for( size_t i = 0; i < strsize; ++i )
+        data[ i ] = i * 2654435761u >> 13;
+    int const reps = totalbytes / strsize;
+    for( int base64 = 1; base64 >= 0; --base64 ) {
+        char const* const enc = base64 ? "base64" : "hex";
+        char label[ 64 ];
+        double start = now();
+        for( int i = 0; i < reps; ++i ) {
+            size_t rem = sizeof buff - 1;
+            char* p = base64 ? json_base64( buff, NULL, data, strsize, &rem ) : json_hex( buff, NULL, data, strsize, &rem );
+            sink = p[-1];
+        }
+        snprintf( label, sizeof label, "json_%s", enc );
+        report( label, now() - start, (double)reps * strsize );
+        start = now();
+        for( int i = 0; i < reps; ++i ) {
+            size_t rem = sizeof buff - 1;
+            size_t const len = base64 ? tablebase64( tmp, data, strsize ) : tablehex( tmp, data, strsize );
+            char* p = json_strLen( buff, NULL, tmp, len, &rem );
+            sink = p[-1];
+        }
+        snprintf( label, sizeof label, "%s then json_strLen", enc );
+        report( label, now() - start, (double)reps * strsize );
+    }
+}
+
+enum { numvalues = 1 << 12, numreps = 1 << 12 };
+
+/* Values of each distribution of the integer benchmark. */
+static void numfill( long long* values, int dist ) {
+    unsigned long long seed = 88172645463325252ull;
+    for( int i = 0; i < numvalues; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        switch( dist ) {
+            case 0:  values[i] = seed % 1000; break;
+            case 1:  values[i] = 1500000000000ll + seed % 100000000000ll; break;
+            default: values[i] = seed & 1 ? LLONG_MAX : LLONG_MIN; break;
+        }
+    }
+}
+
+static void bench_integer( char const* name, int dist ) {
+    static long long values[ numvalues ];
+    static char buff[ 24 * numvalues ];
+    numfill( values, dist );
+    char label[ 64 ];
+
+    double start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = buff;
+        for( int i = 0; i < numvalues; ++i )
+            p = json_verylong( p, NULL, values[i], &rem );
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "json_verylong %s", name );
+    reportops( label, now() - start, (double)numreps * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = buff;
+        for( int i = 0; i < numvalues; ++i ) {
+            int const len = snprintf( p, rem, "%lld,", values[i] );
+            p += len;
+            rem -= len;
+        }
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "snprintf %s", name );
+    reportops( label, now() - start, (double)numreps * numvalues );
+}
+
+/* Values of each distribution of the double benchmark. */
+static void realfill( double* values, int dist ) {
+    unsigned long long seed = 88172645463325252ull;
+    for( int i = 0; i < numvalues; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        switch( dist ) {
+            case 0:  values[i] = ( seed % 1000000 ) / 100.0; break;
+            case 1:  values[i] = ( seed >> 11 ) * 0x1p-53 * 100.0 - 50.0; break;
+            default: memcpy( &values[i], &seed, sizeof seed );
+                     if ( values[i] != values[i] || values[i] - values[i] != 0 )
+                         values[i] = 0.0;
+                     break;
+        }
+    }
+}
+
+static void bench_double( char const* name, int dist ) {
+    static double values[ numvalues ];
+    static char buff[ 32 * numvalues ];
+    realfill( values, dist );
+    char label[ 64 ];
+
+    double start = now();
+    for( int r = 0; r < numreps / 4; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = buff;
+        for( int i = 0; i < numvalues; ++i )
+            p = json_double( p, NULL, values[i], &rem );
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "json_double %s", name );
+    reportops( label, now() - start, (double)numreps / 4 * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps / 4; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = buff;
+        for( int i = 0; i < numvalues; ++i ) {
+            int const len = snprintf( p, rem, "%.17g,", values[i] );
+            p += len;
+            rem -= len;
+        }
+        sink = p[-1];
+    }
+    snprintf( label, sizeof label, "snprintf %%.17g %s", name );
+    reportops( label, now() - start, (double)numreps / 4 * numvalues );
+}
+
+/* A record of the strided benchmark. */
+struct record {
+    long long stamp;
+    double value;
+    int flags;
+};
+
+static void bench_arrays( void ) {
+    static long long values[ numvalues ];
+    static double reals[ numvalues ];
+    static int ints[ numvalues ];
+    static struct record records[ numvalues ];
+    static char buff[ 34 * numvalues ];
+    numfill( values, 0 );
+    for( int i = 0; i < numvalues; ++i )
+        ints[i] = (int)values[i];
+    numfill( values, 1 );
+    realfill( reals, 1 );
+    for( int i = 0; i < numvalues; ++i ) {
+        records[i].stamp = values[i];
+        records[i].value = reals[i];
+        records[i].flags = ints[i];
+    }
+
+    double start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_arrOpen( buff, NULL, &rem );
+        for( int i = 0; i < numvalues; ++i )
+            p = json_int( p, NULL, ints[i], &rem );
+        p = json_arrClose( p, &rem );
+        sink = p[-1];
+    }
+    reportrate( "json_int loop counters", now() - start, (double)numreps * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_intArray( buff, NULL, ints, numvalues, &rem );
+        sink = p[-1];
+    }
+    reportrate( "json_intArray counters", now() - start, (double)numreps * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_arrOpen( buff, NULL, &rem );
+        for( int i = 0; i < numvalues; ++i )
+            p = json_verylong( p, NULL, records[i].stamp, &rem );
+        p = json_arrClose( p, &rem );
+        sink = p[-1];
+    }
+    reportrate( "json_verylong loop timestamps", now() - start, (double)numreps * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_verylongStride( buff, NULL, &records->stamp, numvalues, sizeof *records, &rem );
+        sink = p[-1];
+    }
+    reportrate( "json_verylongStride timestamps", now() - start, (double)numreps * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps / 4; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_arrOpen( buff, NULL, &rem );
+        for( int i = 0; i < numvalues; ++i )
+            p = json_double( p, NULL, reals[i], &rem );
+        p = json_arrClose( p, &rem );
+        sink = p[-1];
+    }
+    reportrate( "json_double loop sensor values", now() - start, (double)numreps / 4 * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps / 4; ++r ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_doubleArray( buff, NULL, reals, numvalues, &rem );
+        sink = p[-1];
+    }
+    reportrate( "json_doubleArray sensor values", now() - start, (double)numreps / 4 * numvalues );
+
+    jsonWriter_t w;
+    start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_arrOpen( &w, NULL );
+        for( int i = 0; i < numvalues; ++i )
+            jsonw_int( &w, NULL, ints[i] );
+        jsonw_arrClose( &w );
+        sink = (char)jsonw_end( &w );
+    }
+    reportrate( "jsonw_int loop counters", now() - start, (double)numreps * numvalues );
+
+    start = now();
+    for( int r = 0; r < numreps; ++r ) {
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_intArray( &w, NULL, ints, numvalues );
+        sink = (char)jsonw_end( &w );
+    }
+    reportrate( "jsonw_intArray counters", now() - start, (double)numreps * numvalues );
+}
+
+/* The document of example.c. */
+
+struct weather {
+    int temp;
+    int hum;
+};
+
+struct time {
+    int hour;
+    int minute;
+};
+
+struct measure {
+    struct weather weather;
+    struct time time;
+};
+
+struct data {
+    char const* city;
+    char const* street;
+    struct measure measure;
+    int samples[ 4 ];
+};
+
+static char* json_weather( char* dest, char const* name, struct weather const* weather, size_t* remLen ) {
+    dest = json_objOpen( dest, name, remLen );
+    dest = json_int( dest, "temp", weather->temp, remLen );
+    dest = json_int( dest, "hum", weather->hum, remLen );
+    dest = json_objClose( dest, remLen );
+    return dest;
+}
+
+static char* json_time( char* dest, char const* name, struct time const* time, size_t* remLen ) {
+    dest = json_objOpen( dest, name, remLen );
+    dest = json_int( dest, "hour",   time->hour, remLen );
+    dest = json_int( dest, "minute", time->minute, remLen );
+    dest = json_objClose( dest, remLen );
+    return dest;
+}
+
+static char* json_measure( char* dest, char const* name, struct measure const* measure, size_t* remLen ) {
+    dest = json_objOpen( dest, name, remLen );
+    dest = json_weather( dest, "weather", &measure->weather, remLen );
+    dest = json_time( dest, "time", &measure->time, remLen );
+    dest = json_objClose( dest, remLen );
+    return dest;
+}
+
+static char* json_data( char* dest, char const* name, struct data const* data, size_t* remLen ) {
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_str( dest, "city",   data->city, remLen );
+    dest = json_str( dest, "street", data->street, remLen );
+    dest = json_measure( dest, "measure", &data->measure, remLen );
+    dest = json_arrOpen( dest, "samples", remLen );
+    for( int i = 0; i < 4; ++i )
+        dest = json_int( dest, NULL, data->samples[i], remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return dest;
+}
+
+/* The same document with encoded keys. */
+static jsonKey_t const kcity    = JSON_KEY( "city" );
+static jsonKey_t const kstreet  = JSON_KEY( "street" );
+static jsonKey_t const kmeasure = JSON_KEY( "measure" );
+static jsonKey_t const kweather = JSON_KEY( "weather" );
+static jsonKey_t const ktemp    = JSON_KEY( "temp" );
+static jsonKey_t const khum     = JSON_KEY( "hum" );
+static jsonKey_t const ktime    = JSON_KEY( "time" );
+static jsonKey_t const khour    = JSON_KEY( "hour" );
+static jsonKey_t const kminute  = JSON_KEY( "minute" );
+static jsonKey_t const ksamples = JSON_KEY( "samples" );
+
+static char* json_data_k( char* dest, struct data const* data, size_t* remLen ) {
+    dest = json_objOpen_k( dest, NULL, remLen );
+    dest = json_str_k( dest, &kcity,   data->city, remLen );
+    dest = json_str_k( dest, &kstreet, data->street, remLen );
+    dest = json_objOpen_k( dest, &kmeasure, remLen );
+    dest = json_objOpen_k( dest, &kweather, remLen );
+    dest = json_int_k( dest, &ktemp, data->measure.weather.temp, remLen );
+    dest = json_int_k( dest, &khum, data->measure.weather.hum, remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_objOpen_k( dest, &ktime, remLen );
+    dest = json_int_k( dest, &khour, data->measure.time.hour, remLen );
+    dest = json_int_k( dest, &kminute, data->measure.time.minute, remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_arrOpen_k( dest, &ksamples, remLen );
+    for( int i = 0; i < 4; ++i )
+        dest = json_int_k( dest, NULL, data->samples[i], remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return dest;
+}
+
+static struct data const exampledata = {
+    .city    = "liverpool",
+    .street  = "mathew",
+    .measure = {
+        .weather = { .hum  = 65, .temp = 25 },
+        .time    = { .hour = 14, .minute = 31 }
+    },
+    .samples = { 25, 65, -37, 512 }
+};
+
+/* The same document described by schemas. */
+#define WEATHER( X ) \
+    X( int, temp, 0 ) \
+    X( int, hum,  0 )
+
+JSON_SCHEMA( weather, struct weather, WEATHER )
+
+#define TIME( X ) \
+    X( int, hour,   0 ) \
+    X( int, minute, 0 )
+
+JSON_SCHEMA( time, struct time, TIME )
+
+#define MEASURE( X )           \
+    X( obj, weather, weather ) \
+    X( obj, time,    time )
+
+JSON_SCHEMA( measure, struct measure, MEASURE )
+
+#define DATA( X )                    \
+    X( str,   city,    0 )           \
+    X( str,   street,  0 )           \
+    X( obj,   measure, measure )     \
+    X( array, samples, ( int, 4 ) )
+
+JSON_SCHEMA( data, struct data, DATA )
+
+enum { docreps = 1 << 22 };
+
+static void bench_document( void ) {
+    static char buff[ 512 ];
+    double start = now();
+    size_t len = 0;
+    for( int i = 0; i < docreps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_data( buff, NULL, &exampledata, &rem );
+        p = json_end( p, &rem );
+        len = p - buff;
+        sink = p[-1];
+    }
+    double secs = now() - start;
+    reportops( "json_data", secs, docreps );
+    report( "json_data", secs, (double)docreps * len );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_data_k( buff, &exampledata, &rem );
+        p = json_end( p, &rem );
+        len = p - buff;
+        sink = p[-1];
+    }
+    secs = now() - start;
+    reportops( "json_data with keys", secs, docreps );
+    report( "json_data with keys", secs, (double)docreps * len );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        size_t rem = sizeof buff - 1;
+        char* p = json_schema_data( buff, NULL, &exampledata, &rem );
+        p = json_end( p, &rem );
+        len = p - buff;
+        sink = p[-1];
+    }
+    secs = now() - start;
+    reportops( "schema", secs, docreps );
+    report( "schema", secs, (double)docreps * len );
+}
+
+/* The document of example.c with a writer. */
+static void jsonw_data( jsonWriter_t* w, struct data const* data ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_str( w, "city",   data->city );
+    jsonw_str( w, "street", data->street );
+    jsonw_objOpen( w, "measure" );
+    jsonw_objOpen( w, "weather" );
+    jsonw_int( w, "temp", data->measure.weather.temp );
+    jsonw_int( w, "hum", data->measure.weather.hum );
+    jsonw_objClose( w );
+    jsonw_objOpen( w, "time" );
+    jsonw_int( w, "hour", data->measure.time.hour );
+    jsonw_int( w, "minute", data->measure.time.minute );
+    jsonw_objClose( w );
+    jsonw_objClose( w );
+    jsonw_arrOpen( w, "samples" );
+    for( int i = 0; i < 4; ++i )
+        jsonw_int( w, NULL, data->samples[i] );
+    jsonw_arrClose( w );
+    jsonw_objClose( w );
+}
+
+enum { exportrecords = 20000, exportreps = 16 };
+
+/* An export: an array with many copies of the document of example.c. */
+static void jsonw_export( jsonWriter_t* w ) {
+    jsonw_arrOpen( w, NULL );
+    for( int i = 0; i < exportrecords; ++i )
+        jsonw_data( w, &exampledata );
+    jsonw_arrClose( w );
+}
+
+static void bench_format( void ) {
+    jsonWriter_t w;
+    jsonw_measure( &w );
+    jsonw_export( &w );
+    size_t const size = jsonw_needed( &w );
+    char* const compact = malloc( size );
+    char* const pretty = malloc( 4 * size );
+    jsonw_init( &w, compact, size );
+    jsonw_export( &w );
+    size_t const len = jsonw_end( &w );
+    jsonFormat_t f;
+    size_t prettylen = 0;
+
+    double start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        json_formatInit( &f, 2, "\n" );
+        size_t rem = 4 * size - 1;
+        prettylen = json_format( pretty, &f, compact, len, &rem ) - pretty;
+    }
+    report( "json_format pretty", now() - start, (double)exportreps * len );
+
+    start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        json_formatInit( &f, 0, NULL );
+        size_t rem = size - 1;
+        sink = *json_format( compact, &f, pretty, prettylen, &rem );
+    }
+    report( "json_format minify", now() - start, (double)exportreps * prettylen );
+
+    start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        jsonw_init( &w, compact, size );
+        jsonw_export( &w );
+        sink = (char)jsonw_end( &w );
+    }
+    report( "compact writer", now() - start, (double)exportreps * len );
+
+    start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        jsonWriter_t out;
+        jsonPretty_t p;
+        jsonw_init( &out, pretty, 4 * size );
+        jsonw_initPretty( &w, &p, &out, 2, "\n" );
+        jsonw_export( &w );
+        sink = (char)jsonw_end( &w );
+    }
+    report( "pretty writer", now() - start, (double)exportreps * len );
+    free( pretty );
+    free( compact );
+}
+
+/* A message with a subtree that rarely changes: a device and its sensors. */
+static void jsonw_device( jsonWriter_t* w, char const* name ) {
+    jsonw_objOpen( w, name );
+    jsonw_str( w, "model", "TH-2000 outdoor station" );
+    jsonw_str( w, "firmware", "4.12.7-release" );
+    jsonw_verylong( w, "serial", 90210334455LL );
+    jsonw_arrOpen( w, "sensors" );
+    for( int i = 0; i < 8; ++i ) {
+        jsonw_objOpen( w, NULL );
+        jsonw_int( w, "channel", i );
+        jsonw_str( w, "kind", 0 == i % 2 ? "temperature" : "humidity" );
+        jsonw_double( w, "offset", 0.125 * i );
+        jsonw_bool( w, "enabled", 1 );
+        jsonw_objClose( w );
+    }
+    jsonw_arrClose( w );
+    jsonw_objClose( w );
+}
+
+static void jsonw_message( jsonWriter_t* w, jsonFragment_t const* device, int seq ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_int( w, "seq", seq );
+    if ( NULL == device )
+        jsonw_device( w, "device" );
+    else
+        jsonw_fragment( w, "device", device );
+    jsonw_data( w, &exampledata );
+    jsonw_objClose( w );
+}
+
+static void bench_fragment( void ) {
+    static char buff[ 2048 ];
+    static char devbuff[ 1024 ];
+    jsonFragment_t device;
+    json_fragmentInit( &device, devbuff, sizeof devbuff );
+    jsonWriter_t w;
+    jsonw_initFragment( &w, &device );
+    jsonw_device( &w, NULL );
+    json_fragmentEnd( &device, &w, 1 );
+
+    double start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_message( &w, NULL, i );
+        sink = (char)jsonw_end( &w );
+    }
+    reportops( "rebuild the device", now() - start, docreps );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_message( &w, &device, i );
+        sink = (char)jsonw_end( &w );
+    }
+    reportops( "copy the fragment", now() - start, docreps );
+
+    jsonArena_t a;
+    json_arenaInit( &a, 4096, NULL );
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_initArena( &w, &a );
+        jsonw_message( &w, &device, i );
+        jsonw_end( &w );
+        jsonIovec_t iov[ 8 ];
+        sink = (char)json_arenaIovec( &a, iov, 8 );
+    }
+    reportops( "reference it in an arena", now() - start, docreps );
+    json_arenaFree( &a );
+}
+
+/* The message of bench_fragment() with slots for the values of the data and
+   the sequence number. With fixed slots only the numbers are patched. */
+static int tplmessage( jsonWriter_t* w, jsonTemplate_t* t, int fixed ) {
+    jsonw_initTemplate( w, t );
+    jsonw_objOpen( w, NULL );
+    if ( fixed )
+        jsonw_fixedSlot( w, t, "seq", 10 );
+    else
+        jsonw_slot( w, t, "seq", JSON_SLOT_INT );
+    jsonw_device( w, "device" );
+    jsonw_objOpen( w, NULL );
+    jsonw_slot( w, t, "city", JSON_SLOT_STR );
+    jsonw_slot( w, t, "street", JSON_SLOT_STR );
+    jsonw_objOpen( w, "measure" );
+    jsonw_objOpen( w, "weather" );
+    static char const* const names[] = { "temp", "hum", "hour", "minute" };
+    for( int i = 0; i < 4; ++i ) {
+        if ( 2 == i ) {
+            jsonw_objClose( w );
+            jsonw_objOpen( w, "time" );
+        }
+        if ( fixed )
+            jsonw_fixedSlot( w, t, names[ i ], 4 );
+        else
+            jsonw_slot( w, t, names[ i ], JSON_SLOT_INT );
+    }
+    jsonw_objClose( w );
+    jsonw_objClose( w );
+    jsonw_arrOpen( w, "samples" );
+    for( int i = 0; i < 4; ++i )
+        jsonw_slot( w, t, NULL, JSON_SLOT_INT );
+    jsonw_arrClose( w );
+    jsonw_objClose( w );
+    jsonw_objClose( w );
+    return json_templateEnd( t, w );
+}
+
+static void bench_template( void ) {
+    static char buff[ 2048 ];
+    static char text[ 2048 ];
+    jsonSlot_t slots[ 16 ];
+    jsonTemplate_t t;
+    json_templateInit( &t, text, sizeof text, slots, 16 );
+    jsonWriter_t w;
+    tplmessage( &w, &t, 0 );
+    jsonValue_t values[ 16 ];
+    values[ 1 ].str = exampledata.city;
+    values[ 2 ].str = exampledata.street;
+    values[ 3 ].integer = exampledata.measure.weather.temp;
+    values[ 4 ].integer = exampledata.measure.weather.hum;
+    values[ 5 ].integer = exampledata.measure.time.hour;
+    values[ 6 ].integer = exampledata.measure.time.minute;
+    for( int i = 0; i < 4; ++i )
+        values[ 7 + i ].integer = exampledata.samples[ i ];
+
+    double start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_message( &w, NULL, i );
+        sink = (char)jsonw_end( &w );
+    }
+    reportops( "call by call", now() - start, docreps );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        size_t rem = sizeof buff;
+        values[ 0 ].integer = i;
+        char* const p = json_template( buff, NULL, &t, values, &rem );
+        sink = p[-1];
+    }
+    reportops( "json_template", now() - start, docreps );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        values[ 0 ].integer = i;
+        jsonw_template( &w, NULL, &t, values );
+        sink = (char)jsonw_end( &w );
+    }
+    reportops( "jsonw_template", now() - start, docreps );
+
+    tplmessage( &w, &t, 1 );
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        json_templatePatch( &t, 0, i );
+        json_templatePatch( &t, 3, i & 63 );
+        json_templatePatch( &t, 6, i % 60 );
+        size_t rem = sizeof buff;
+        char* const p = json_template( buff, NULL, &t, values, &rem );
+        sink = p[-1];
+    }
+    reportops( "3 fixed slots patched", now() - start, docreps );
+}
+
+/* A status message that is resent with three numbers changed: the sequence,
+   a temperature and a humidity. With fixed is true they are written with a
+   fixed width and their handles are set. */
+static size_t jsonw_status_feed( jsonWriter_t* w, int seq, double temp, int hum, int fixed, jsonFixed_t* f ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_str( w, "device", "meter-7" );
+    jsonw_str( w, "site", exampledata.city );
+    jsonw_str( w, "street", exampledata.street );
+    jsonw_str( w, "firmware", "2.4.1-rc3" );
+    if ( fixed ) {
+        jsonw_fixedInt( w, "seq", seq, 10, &f[ 0 ] );
+        jsonw_fixedDouble( w, "temp", temp, 7, 2, &f[ 1 ] );
+        jsonw_fixedInt( w, "hum", hum, 3, &f[ 2 ] );
+    }
+    else {
+        jsonw_int( w, "seq", seq );
+        jsonw_double( w, "temp", temp );
+        jsonw_int( w, "hum", hum );
+    }
+    jsonw_intArray( w, "samples", exampledata.samples, 4 );
+    jsonw_objClose( w );
+    return jsonw_end( w );
+}
+
+static void bench_fixed( void ) {
+    static char buff[ 1024 ];
+    jsonWriter_t w;
+    jsonFixed_t f[ 3 ];
+    double start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        sink = (char)jsonw_status_feed( &w, i, 20 + ( i & 1023 ) * 0.01, i & 63, 0, f );
+    }
+    reportops( "rebuilt", now() - start, docreps );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        sink = (char)jsonw_status_feed( &w, i, 20 + ( i & 1023 ) * 0.01, i & 63, 1, f );
+    }
+    reportops( "rebuilt with fixed widths", now() - start, docreps );
+
+    start = now();
+    for( int i = 0; i < docreps; ++i ) {
+        json_patchInt( buff, &f[ 0 ], i );
+        json_patchDouble( buff, &f[ 1 ], 20 + ( i & 1023 ) * 0.01 );
+        json_patchInt( buff, &f[ 2 ], i & 63 );
+        sink = buff[ f[ 1 ].offset ];
+    }
+    reportops( "3 numbers patched in place", now() - start, docreps );
+}
+
+enum { payloadlen = 16 * 1024, payloads = 4 };
+
+/* A message with a few long strings without escapes, such as encoded blobs. */
+static void jsonw_payloads( jsonWriter_t* w, char const* const* values ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_str( w, "kind", "upload" );
+    jsonw_arrOpen( w, "chunks" );
+    for( int i = 0; i < payloads; ++i ) {
+        jsonw_objOpen( w, NULL );
+        jsonw_int( w, "index", i );
+        jsonw_str( w, "data", values[i] );
+        jsonw_objClose( w );
+    }
+    jsonw_arrClose( w );
+    jsonw_objClose( w );
+}
+
+static void bench_vectored( void ) {
+    int fd = open( "/dev/null", O_WRONLY );
+    if ( 0 > fd )
+        return;
+    static char text[ payloads ][ payloadlen + 1 ];
+    char const* values[ payloads ];
+    for( int i = 0; i < payloads; ++i ) {
+        fill( text[i], payloadlen, 0 );
+        values[i] = text[i];
+    }
+    jsonArena_t a;
+    json_arenaInit( &a, 4096, NULL );
+    size_t len = 0;
+    for( int mode = 0; mode < 2; ++mode ) {
+        double const start = now();
+        for( int r = 0; r < numreps; ++r ) {
+            jsonWriter_t w;
+            if ( 0 == mode )
+                jsonw_initArena( &w, &a );
+            else
+                jsonw_initIovec( &w, &a );
+            jsonw_payloads( &w, values );
+            len = jsonw_end( &w );
+            jsonIovec_t iov[ 16 ];
+            int const count = json_arenaIovec( &a, iov, 16 );
+            if ( 0 > writev( fd, iov, count < 16 ? count : 16 ) )
+                break;
+        }
+        double const secs = now() - start;
+        char const* const name = 0 == mode ? "copied in an arena" : "referenced with jsonw_initIovec";
+        reportops( name, secs, numreps );
+        report( name, secs, (double)numreps * len );
+    }
+    json_arenaFree( &a );
+    close( fd );
+}
+
+static void bench_sizing( void ) {
+    size_t len = 0;
+    double start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        jsonWriter_t w;
+        jsonw_measure( &w );
+        jsonw_export( &w );
+        size_t const size = jsonw_needed( &w );
+        char* buff = malloc( size );
+        jsonw_init( &w, buff, size );
+        jsonw_export( &w );
+        len = jsonw_end( &w );
+        sink = buff[ len - 1 ];
+        free( buff );
+    }
+    double secs = now() - start;
+    reportops( "measure + write", secs / exportrecords, exportreps );
+    report( "measure + write", secs, (double)exportreps * len );
+
+    start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        size_t size = 4096;
+        char* buff = malloc( size );
+        for( ;; ) {
+            jsonWriter_t w;
+            jsonw_init( &w, buff, size );
+            jsonw_export( &w );
+            len = jsonw_end( &w );
+            if ( 0 == jsonw_status( &w ) )
+                break;
+            size *= 2;
+            buff = realloc( buff, size );
+        }
+        sink = buff[ len - 1 ];
+        free( buff );
+    }
+    secs = now() - start;
+    reportops( "write with doubling", secs / exportrecords, exportreps );
+    report( "write with doubling", secs, (double)exportreps * len );
+
+    jsonArena_t a;
+    json_arenaInit( &a, 4096, NULL );
+    start = now();
+    for( int r = 0; r < exportreps; ++r ) {
+        jsonWriter_t w;
+        jsonw_initArena( &w, &a );
+        jsonw_export( &w );
+        len = jsonw_end( &w );
+        sink = json_blockData( a.tail )[ a.tail->len - 1 ];
+    }
+    secs = now() - start;
+    json_arenaFree( &a );
+    reportops( "write in a reused arena", secs / exportrecords, exportreps );
+    report( "write in a reused arena", secs, (double)exportreps * len );
+}
+
+/* Flush callback that writes to a file descriptor. */
+static int fdflush( void* ctx, char const* data, size_t len ) {
+    int const fd = *(int const*)ctx;
+    while( 0 != len ) {
+        ssize_t const n = write( fd, data, len );
+        if ( 0 > n )
+            return 0;
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/* Stream a time series of 1 GB to /dev/null through a 64 KiB buffer. */
+static void bench_stream( void ) {
+    int fd = open( "/dev/null", O_WRONLY );
+    if ( 0 > fd )
+        return;
+    static char buff[ 64 * 1024 ];
+    jsonStream_t s;
+    jsonWriter_t w;
+    double const start = now();
+    jsonw_initStream( &w, &s, buff, sizeof buff, fdflush, &fd );
+    jsonw_arrOpen( &w, NULL );
+    long long t = 1546300800000LL;
+    for( unsigned i = 0; jsonw_needed( &w ) < 1000000000; ++i ) {
+        jsonw_objOpen( &w, NULL );
+        jsonw_verylong( &w, "t", t + i * 250LL );
+        jsonw_double( &w, "v", 20.0 + ( i % 1000 ) * 0.01 );
+        jsonw_str( &w, "unit", "degC" );
+        jsonw_objClose( &w );
+    }
+    jsonw_arrClose( &w );
+    size_t const len = jsonw_end( &w );
+    double const secs = now() - start;
+    close( fd );
+    if ( 0 != jsonw_status( &w ) )
+        return;
+    report( "1 GB to /dev/null", secs, (double)len );
+}
+
+// ---------------------------------------------------- Execute benchmarks: ---
+
+enum { maxthreads = 64 };
+
+/* A range of the records of a parallel export and the part it is written to. */
+struct job {
+    pthread_t thread;
+    jsonArena_t arena;
+    size_t first;
+    size_t last;
+    int status;
+};
+
+static void* partjob( void* arg ) {
+    struct job* const j = arg;
+    jsonWriter_t w;
+    jsonw_initPart( &w, &j->arena );
+    for( size_t i = j->first; i < j->last; ++i )
+        jsonw_data( &w, &exampledata );
+    jsonw_endPart( &w );
+    j->status = jsonw_status( &w );
+    return NULL;
+}
+
+/* Write an export of records with a number of threads and hand it to writev. */
+static double parallelexport( struct job* jobs, int threads, size_t records, int fd ) {
+    double const start = now();
+    for( int t = 0; t < threads; ++t ) {
+        jobs[t].first = records * t / threads;
+        jobs[t].last = records * ( t + 1 ) / threads;
+        if ( 0 != pthread_create( &jobs[t].thread, NULL, partjob, &jobs[t] ) )
+            partjob( &jobs[t] );
+    }
+    for( int t = 0; t < threads; ++t )
+        pthread_join( jobs[t].thread, NULL );
+    for( int t = 0; t < threads; ++t )
+        if ( 0 != jobs[t].status )
+            return 0;
+    jsonArena_t parts[ maxthreads ];
+    for( int t = 0; t < threads; ++t )
+        parts[t] = jobs[t].arena;
+    static jsonIovec_t iov[ 16 * maxthreads ];
+    int const count = json_joinIovec( parts, threads, iov, sizeof iov / sizeof *iov );
+    for( int i = 0; i < count; i += 16 )
+        if ( 0 > writev( fd, iov + i, count - i < 16 ? count - i : 16 ) )
+            return 0;
+    return now() - start;
+}
+
+static void bench_parallel( void ) {
+    int fd = open( "/dev/null", O_WRONLY );
+    if ( 0 > fd )
+        return;
+    jsonWriter_t w;
+    jsonw_measure( &w );
+    jsonw_data( &w, &exampledata );
+    size_t const doclen = jsonw_needed( &w ) - 1;
+    size_t const records = 1000000000 / ( doclen + 1 );
+    long cores = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+    cores = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+    if ( maxthreads < cores )
+        cores = maxthreads;
+    static struct job jobs[ maxthreads ];
+    double single = 0;
+    for( int threads = 1; ; threads *= 2 ) {
+        if ( threads > cores )
+            threads = cores;
+        for( int t = 0; t < threads; ++t )
+            json_arenaInit( &jobs[t].arena, 1 << 20, NULL );
+        parallelexport( jobs, threads, records, fd );
+        double const secs = parallelexport( jobs, threads, records, fd );
+        for( int t = 0; t < threads; ++t )
+            json_arenaFree( &jobs[t].arena );
+        if ( 0 == secs )
+            break;
+        if ( 1 == threads )
+            single = secs;
+        char label[ 64 ];
+        snprintf( label, sizeof label, "%d threads, x%.2f", threads, single / secs );
+        report( label, secs, records * ( doclen + 1.0 ) );
+        if ( threads == cores )
+            break;
+    }
+    close( fd );
+}
+
+// ------------------------------------------------------------ Suite: ---
+
+enum { suitecalls = 256, maxdepth = 32 };
+
+/* A string value of the suite. */
+struct strcase {
+    char str[ strsize ];
+    int len;
+};
+
+static size_t op_nstr( void const* arg ) {
+    struct strcase const* c = arg;
+    static char buff[ 6 * strsize + 16 ];
+    size_t rem = sizeof buff - 1;
+    return json_nstr( buff, "k", c->str, c->len, &rem ) - buff;
+}
+
+/* The values of the integers of each width for each range. */
+static int ints[ 3 ][ suitecalls ];
+static unsigned int uints[ 3 ][ suitecalls ];
+static long longs[ 3 ][ suitecalls ];
+static unsigned long ulongs[ 3 ][ suitecalls ];
+static long long verylongs[ 3 ][ suitecalls ];
+static double reals[ 3 ][ suitecalls ];
+
+/* Fill the values of the integers: below a thousand, any of the width and
+   the limits of the width. */
+static void intfill( void ) {
+    unsigned long long seed = 88172645463325252ull;
+    for( int i = 0; i < suitecalls; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        ints[0][i] = uints[0][i] = longs[0][i] = ulongs[0][i] = verylongs[0][i] = seed % 1000;
+        ints[1][i] = (int)( seed >> 32 );
+        uints[1][i] = (unsigned int)( seed >> 32 );
+        longs[1][i] = (long)seed;
+        ulongs[1][i] = (unsigned long)seed;
+        verylongs[1][i] = (long long)seed;
+        ints[2][i] = seed & 1 ? INT_MAX : INT_MIN;
+        uints[2][i] = UINT_MAX;
+        longs[2][i] = seed & 1 ? LONG_MAX : LONG_MIN;
+        ulongs[2][i] = ULONG_MAX;
+        verylongs[2][i] = seed & 1 ? LLONG_MAX : LLONG_MIN;
+    }
+}
+
+/* Define an operation that writes the values of a kind in an array. */
+#define SUITE_OP( func, type )                                  \
+static size_t op_##func( void const* arg ) {                    \
+    type const* values = arg;                                   \
+    static char buff[ 32 * suitecalls ];                        \
+    size_t rem = sizeof buff - 1;                               \
+    char* p = buff;                                             \
+    for( int i = 0; i < suitecalls; ++i )                       \
+        p = func( p, NULL, values[i], &rem );                   \
+    return p - buff;                                            \
+}
+
+SUITE_OP( json_int, int )
+SUITE_OP( json_uint, unsigned int )
+SUITE_OP( json_long, long )
+SUITE_OP( json_ulong, unsigned long )
+SUITE_OP( json_verylong, long long )
+SUITE_OP( json_double, double )
+
+static size_t op_bool( void const* arg ) {
+    static char buff[ 8 * suitecalls ];
+    size_t rem = sizeof buff - 1;
+    char* p = buff;
+    for( int i = 0; i < suitecalls; ++i )
+        p = json_bool( p, NULL, i & 1, &rem );
+    return p - buff;
+}
+
+static size_t op_null( void const* arg ) {
+    static char buff[ 8 * suitecalls ];
+    size_t rem = sizeof buff - 1;
+    char* p = buff;
+    for( int i = 0; i < suitecalls; ++i )
+        p = json_null( p, NULL, &rem );
+    return p - buff;
+}
+
+/* Open objects with a name, or arrays, down to the maximum depth and close
+   them. */
+static size_t op_nesting( void const* arg ) {
+    int const arrays = *(int const*)arg;
+    static char buff[ 16 * maxdepth ];
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    for( int i = 1; i < maxdepth; ++i )
+        p = arrays ? json_arrOpen( p, i == 1 ? "a" : NULL, &rem ) : json_objOpen( p, "obj", &rem );
+    for( int i = 1; i < maxdepth; ++i )
+        p = arrays ? json_arrClose( p, &rem ) : json_objClose( p, &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
+    return p - buff;
+}
+
+static size_t op_document( void const* arg ) {
+    static char buff[ 512 ];
+    size_t rem = sizeof buff - 1;
+    char* p = json_data( buff, NULL, arg, &rem );
+    p = json_end( p, &rem );
+    return p - buff;
+}
+
+static size_t op_wdocument( void const* arg ) {
+    static char buff[ 512 ];
+    jsonWriter_t w;
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_data( &w, arg );
+    jsonw_end( &w );
+    return jsonw_needed( &w ) - 1;
+}
+
+/* Each public function of the classic interface on its own, with percentiles
+   for comparisons between runs and builds. */
+static void bench_suite( void ) {
+    static int const lens[] = { 16, 256, strsize };
+    static int const periods[] = { 0, 64, 4 };
+    static char const* const densities[] = { "no escapes", "1/64 escaped", "1/4 escaped" };
+    static struct strcase cases[ 3 ];
+    char label[ 64 ];
+
+    suite( "Suite, json_nstr" );
+    for( int d = 0; d < 3; ++d ) {
+        fill( cases[d].str, strsize, periods[d] );
+        for( int l = 0; l < 3; ++l ) {
+            cases[d].len = lens[l];
+            snprintf( label, sizeof label, "%d bytes, %s", lens[l], densities[d] );
+            measure( label, op_nstr, &cases[d], 1 );
+        }
+    }
+
+    static char const* const ranges[] = { "small", "any", "limits" };
+    intfill();
+    suite( "Suite, integers, 256 per op" );
+    for( int r = 0; r < 3; ++r ) {
+        snprintf( label, sizeof label, "json_int %s", ranges[r] );
+        measure( label, op_json_int, ints[r], suitecalls );
+        snprintf( label, sizeof label, "json_uint %s", ranges[r] );
+        measure( label, op_json_uint, uints[r], suitecalls );
+        snprintf( label, sizeof label, "json_long %s", ranges[r] );
+        measure( label, op_json_long, longs[r], suitecalls );
+        snprintf( label, sizeof label, "json_ulong %s", ranges[r] );
+        measure( label, op_json_ulong, ulongs[r], suitecalls );
+        snprintf( label, sizeof label, "json_verylong %s", ranges[r] );
+        measure( label, op_json_verylong, verylongs[r], suitecalls );
+    }
+
+    static char const* const dists[] = { "prices", "sensor values", "random bits" };
+    static double values[ numvalues ];
+    suite( "Suite, other values, 256 per op" );
+    for( int d = 0; d < 3; ++d ) {
+        realfill( values, d );
+        memcpy( reals[d], values, sizeof reals[d] );
+        snprintf( label, sizeof label, "json_double %s", dists[d] );
+        measure( label, op_json_double, reals[d], suitecalls );
+    }
+    measure( "json_bool", op_bool, NULL, suitecalls );
+    measure( "json_null", op_null, NULL, suitecalls );
+
+    static int const objects = 0, arrays = 1;
+    suite( "Suite, nesting 32 levels, per open or close" );
+    measure( "json_objOpen/json_objClose", op_nesting, &objects, 2 * maxdepth );
+    measure( "json_arrOpen/json_arrClose", op_nesting, &arrays, 2 * maxdepth );
+
+    suite( "Suite, example.c document, per document" );
+    measure( "json_* calls", op_document, &exampledata, 1 );
+    measure( "jsonw_* calls", op_wdocument, &exampledata, 1 );
+}
+
+/* Usage: bench.exe [--suite] [--csv file]
+   With --suite only the suite runs. With --csv the results are also written
+   to the file, one metric of a case on each line. */
+int main( int argc, char** argv ) {
+    int only = 0;
+    for( int i = 1; i < argc; ++i ) {
+        if ( 0 == strcmp( argv[i], "--suite" ) )
+            only = 1;
+        else if ( 0 == strcmp( argv[i], "--csv" ) && i + 1 < argc ) {
+            csv = fopen( argv[++i], "w" );
+            if ( NULL == csv ) {
+                perror( argv[i] );
+                return EXIT_FAILURE;
+            }
+            fputs( "config,section,case,metric,value\n", csv );
+        }
+        else {
+            fprintf( stderr, "Usage: %s [--suite] [--csv file]\n", argv[0] );
+            return EXIT_FAILURE;
+        }
+    }
+    printf( "Configuration: %s/%s/%s\n", CONFIG_LIB, CONFIG_SIMD, CONFIG_LINK );
+    pin();
+    bench_suite();
+    unpin();
+    if ( only ) {
+        if ( NULL != csv )
+            fclose( csv );
+        return EXIT_SUCCESS;
+    }
+    section( "String escaping, 4 KiB values" );
+    bench_escape( "escape-free", 0 );
+    bench_escape( "mixed", 64 );
+    bench_escape( "escape-heavy", 4 );
+    char title[ 64 ];
+    snprintf( title, sizeof title, "UTF-8 text, 4 KiB values, JSON_UTF8 = %d", JSON_UTF8 );
+    section( title );
+    bench_utf8( "accented", "Le caf\xC3\xA9 de la cr\xC3\xA8me br\xC3\xBBl\xC3\xA9" "e. " );
+    bench_utf8( "CJK", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE6\x96\x87\xE7\xAB\xA0\xE3\x80\x82" );
+    bench_utf8( "emoji", "ok \xF0\x9F\x98\x80 " );
+    section( "Binary data, 4 KiB values" );
+    bench_binary();
+    section( "Integer formatting" );
+    bench_integer( "counters", 0 );
+    bench_integer( "timestamps", 1 );
+    bench_integer( "INT64_MIN/MAX", 2 );
+    section( "Double formatting" );
+    bench_double( "prices", 0 );
+    bench_double( "sensor values", 1 );
+    bench_double( "random bits", 2 );
+    section( "Arrays of 4096 numbers" );
+    bench_arrays();
+    section( "example.c document" );
+    bench_document();
+    section( "Sizing an export of 20000 documents, ns per document" );
+    bench_sizing();
+    section( "Reformatting the export" );
+    bench_format();
+    section( "Message with a cached device subtree" );
+    bench_fragment();
+    section( "The same message from a template" );
+    bench_template();
+    section( "Status message with 3 numbers that change" );
+    bench_fixed();
+    section( "Message with 4 strings of 16 KiB to writev" );
+    bench_vectored();
+    section( "Streaming through a 64 KiB buffer" );
+    bench_stream();
+    section( "Parallel export of 1 GB to writev" );
+    bench_parallel();
+    if ( NULL != csv )
+        fclose( csv );
+    return EXIT_SUCCESS;
+}
@@ -24,290 +24,3806 @@
 */
 
 #include <stddef.h> // For NULL
+#include <stdint.h> // For uintptr_t
+#include <string.h> // For memcpy
+#ifndef JSON_NO_MALLOC
+#include <stdlib.h> // For malloc
+#endif
+#define JSON_MAKER_C // Included once in a header-only build
 #include "json-maker.h"
 
+/* With JSON_STATS the family helpers count their calls in counters of the
+   thread. The outermost call of the thread also counts its bytes and samples
+   its cycles. Without JSON_STATS the macros expand to nothing. */
+#ifdef JSON_STATS
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define JSON_TLS _Thread_local
+#elif defined(_MSC_VER)
+#define JSON_TLS __declspec(thread)
+#else
+#define JSON_TLS __thread
+#endif
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static JSON_TLS jsonStats_t jsonm_stats;
+static JSON_TLS unsigned jsonm_statlevel;  /**< Nesting of the counted calls. */
+static JSON_TLS unsigned jsonm_statdepth;  /**< Nesting depth of the JSON. */
+static JSON_TLS unsigned jsonm_statperiod; /**< Period of the samples, or zero. */
+static JSON_TLS unsigned jsonm_statcount;  /**< Calls until the next sample. */
+
+/** Read the time stamp counter, or zero if there is none. */
+static inline unsigned long long jsonm_statclock( void ) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__) && defined(__GNUC__)
+    unsigned long long t;
+    __asm__ volatile( "mrs %0, cntvct_el0" : "=r"( t ) );
+    return t;
+#else
+    return 0;
+#endif
+}
+
+/** A counted call in progress. */
+typedef struct jsonm_statmark_s {
+    int family;               /**< Family of the call. */
+    uintptr_t pos;            /**< Position of the output at the start. */
+    unsigned long long start; /**< Time stamp at the start, or zero. */
+} jsonm_statmark_t;
+
+/** Start a counted call.
+  * @param family Family of the call.
+  * @param pos Position of the output: the end of the string or the length
+  *            written by the writer.
+  * @return The mark to end the call with. */
+static inline jsonm_statmark_t jsonm_statbegin( int family, uintptr_t pos ) {
+    jsonm_statmark_t m = { family, pos, 0 };
+    ++jsonm_stats.family[ family ].calls;
+    if ( 0 == jsonm_statlevel++ && 0 != jsonm_statperiod && 0 == --jsonm_statcount ) {
+        jsonm_statcount = jsonm_statperiod;
+        m.start = jsonm_statclock();
+    }
+    return m;
+}
+
+/** End a counted call.
+  * @param m Its mark.
+  * @param pos Position of the output at the end. */
+static inline void jsonm_statend( jsonm_statmark_t m, uintptr_t pos ) {
+    if ( 0 != --jsonm_statlevel )
+        return;
+    jsonFamilyStats_t* const f = &jsonm_stats.family[ m.family ];
+    f->bytes += pos - m.pos;
+    if ( 0 != m.start ) {
+        f->cycles += jsonm_statclock() - m.start;
+        ++f->samples;
+    }
+}
+
+/** End a counted call of the classic functions.
+  * @param m Its mark.
+  * @param dest The new end of the string.
+  * @return dest. */
+static inline char* jsonm_statret( jsonm_statmark_t m, char* dest ) {
+    jsonm_statend( m, (uintptr_t)dest );
+    return dest;
+}
+
+/** Count a name written.
+  * @param len Its length with quotes and colon. */
+static inline void jsonm_statname( size_t len ) {
+    ++jsonm_stats.names;
+    jsonm_stats.nameBytes += len;
+}
+
+/** Get the position of the output of a writer: the length written. */
+static inline uintptr_t jsonm_statpos( jsonWriter_t const* w ) {
+    return w->flushed + ( w->dest - w->start );
+}
+
+/** Enter an object or an array. */
+static inline void jsonm_statopen( void ) {
+    if ( ++jsonm_statdepth > jsonm_stats.maxDepth )
+        jsonm_stats.maxDepth = jsonm_statdepth;
+}
+
+/** Leave an object or an array. The depth is also reset at the end of each
+  * JSON, so a JSON left unbalanced does not shift the next ones. */
+static inline void jsonm_statclose( void ) {
+    if ( 0 != jsonm_statdepth )
+        --jsonm_statdepth;
+}
+
+#define STAT_BEGIN( family, pos ) jsonm_statmark_t const statmark = jsonm_statbegin( family, (uintptr_t)(pos) )
+#define STAT_END( pos ) jsonm_statend( statmark, (uintptr_t)(pos) )
+#define STAT_RETURN( dest ) return jsonm_statret( statmark, dest )
+#define STAT( expr ) ( expr )
+
+#else
+
+#define STAT_BEGIN( family, pos )
+#define STAT_END( pos )
+#define STAT_RETURN( dest ) return dest
+#define STAT( expr ) (void)0
+
+#endif
+
 /** Add a character at the end of a string.
   * @param dest Pointer to the null character of the string
   * @param ch Value to be added.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the null character of the destination string. */
-static char* chtoa( char* dest, char ch, size_t* remLen ) {
+static char* jsonm_chtoa( char* dest, char ch, size_t* remLen ) {
     if (*remLen != 0) {
         --*remLen;
         *dest   = ch;
         *++dest = '\0';
     }
+    else
+        STAT( ++jsonm_stats.truncations );
     return dest;
 }
 
-/** Copy a null-terminated string.
+/** Copy a memory block of a known length.
   * @param dest Destination memory block.
-  * @param src Source string.
+  * @param src Source memory block.
+  * @param len Length of the source.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the null character of the destination string. */
-static char* atoa( char* dest, char const* src, size_t* remLen  ) {
-    for( ; *src != '\0' && *remLen != 0; ++dest, ++src, --*remLen )
-        *dest = *src;
+static char* jsonm_memtoa( char* dest, char const* src, size_t len, size_t* remLen ) {
+    if ( len > *remLen ) {
+        len = *remLen;
+        STAT( ++jsonm_stats.truncations );
+    }
+    memcpy( dest, src, len );
+    *remLen -= len;
+    dest += len;
     *dest = '\0';
     return dest;
 }
 
-/* Open a JSON object in a JSON string. */
-char* json_objOpen( char* dest, char const* name, size_t* remLen  ) {
-    if ( NULL == name )
-        dest = chtoa( dest, '{', remLen );
-    else {
-        dest = chtoa( dest, '\"', remLen );
-        dest = atoa( dest, name, remLen );
-        dest = atoa( dest, "\":{", remLen );
-    }
+/** Write the name of a property. The room is not checked.
+  * @param dest Destination memory with room for len + 3 characters.
+  * @param name The name of the property.
+  * @param len Length of the name.
+  * @return Pointer to the next char. */
+static char* jsonm_namecpy( char* dest, char const* name, size_t len ) {
+    *dest++ = '\"';
+    memcpy( dest, name, len );
+    dest += len;
+    *dest++ = '\"';
+    *dest++ = ':';
     return dest;
 }
 
-/* Close a JSON object in a JSON string. */
-char* json_objClose( char* dest, size_t* remLen  ) {
-    if ( dest[-1] == ',' )
-    {
-        --dest;
-        ++*remLen;
+/** Finish a fragment written in a fast path, after the room was checked once.
+  * @param start Pointer to the start of the fragment.
+  * @param dest Pointer to the end of the fragment.
+  * @param remLen Pointer to remaining length of start
+  * @return Pointer to the null character of the destination string. */
+static char* jsonm_fastend( char const* start, char* dest, size_t* remLen ) {
+    *dest = '\0';
+    *remLen -= dest - start;
+    return dest;
+}
+
+/* Each function gets the worst case length of its fragment first. If it fits
+   in the remaining length the fragment is written without more checks. Only
+   near the end of the buffer is it written piece by piece and truncated. */
+
+/** Get the hexadecimal digit of the least significant nibble of a integer. */
+static int jsonm_nibbletoch( int nibble ) {
+    return "0123456789ABCDEF"[ nibble % 16u ];
+}
+
+#ifndef JSON_UTF8
+#define JSON_UTF8 JSON_UTF8_PASS
+#endif
+
+/** The bytes that are not ASCII are special characters if JSON_UTF8 checks them. */
+#if JSON_UTF8 == JSON_UTF8_PASS
+#define NONASCII 0
+#define NONASCII16
+#else
+#define NONASCII 1
+#define NONASCII16 \
+    'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',
+#endif
+
+/** Escape lookup table. Zero for the bytes that are copied as is. For the rest
+  * the character that follows the backslash. 'u' means a \u00XX sequence and
+  * 'x' a byte of UTF-8 that JSON_UTF8 checks. */
+static unsigned char const jsonm_esctab[ 256 ] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+      0,   0, '\"',  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, '/',
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, '\\',  0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    NONASCII16 NONASCII16 NONASCII16 NONASCII16
+    NONASCII16 NONASCII16 NONASCII16 NONASCII16
+};
+
+/** Classes of the first bytes of the UTF-8 sequences: the length of the
+  * sequence in the low nibble and the range of the second byte in the high
+  * one, see jsonm_utf8lo and jsonm_utf8hi. Zero for the bytes that can not start one:
+  * ASCII, continuation bytes, overlong leads and leads beyond U+10FFFF. */
+static unsigned char const jsonm_utf8tab[ 256 ] = {
+    [ 0xC2 ] = 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+    0x13, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x23, 0x03, 0x03,
+    0x34, 0x04, 0x04, 0x04, 0x44
+};
+
+/** Ranges of the second byte: any continuation byte, after E0 (no overlong
+  * forms), after ED (no surrogates), after F0 (no overlong forms) and after
+  * F4 (nothing beyond U+10FFFF). */
+static unsigned char const jsonm_utf8lo[] = { 0x80, 0xA0, 0x80, 0x90, 0x80 };
+static unsigned char const jsonm_utf8hi[] = { 0xBF, 0xBF, 0x9F, 0xBF, 0x8F };
+
+/** Get the length of the valid UTF-8 sequence at the start of a string.
+  * @param src The string. Its first byte is not ASCII.
+  * @param len Max length of src.
+  * @return 2 to 4, or zero if the sequence is not valid or it is cut. */
+static inline size_t jsonm_utf8len( char const* src, size_t len ) {
+    unsigned char const* s = (unsigned char const*)src;
+    unsigned int const class = jsonm_utf8tab[ s[0] ];
+    size_t const n = class & 0xF;
+    if ( 0 == n || len < n )
+        return 0;
+    if ( s[1] < jsonm_utf8lo[ class >> 4 ] || s[1] > jsonm_utf8hi[ class >> 4 ] )
+        return 0;
+    if ( 2 < n && 0x80 != ( s[2] & 0xC0 ) )
+        return 0;
+    if ( 3 < n && 0x80 != ( s[3] & 0xC0 ) )
+        return 0;
+    return n;
+}
+
+/** Get the length of the character at the start of a string if it is copied
+  * as it is: an ASCII character without escape or a valid UTF-8 sequence.
+  * @param src The string.
+  * @param len Max length of src. One at least.
+  * @return The length of the character or zero. */
+static inline size_t jsonm_utf8step( char const* src, size_t len ) {
+    unsigned char const ch = *src;
+    if ( 0x80 > ch )
+        return 0 == jsonm_esctab[ ch ];
+    return jsonm_utf8len( src, len );
+}
+
+/** Get the length of the prefix of a string made of valid UTF-8 and of ASCII
+  * characters without escapes, byte by byte. Text in other scripts mixes
+  * both, so they are checked in the same loop.
+  * @param src The string.
+  * @param len Max length of src.
+  * @return The length of the prefix. */
+static size_t jsonm_utf8span( char const* src, size_t len ) {
+    size_t i = 0;
+    while( i < len ) {
+        size_t const n = jsonm_utf8step( src + i, len - i );
+        if ( 0 == n )
+            break;
+        i += n;
     }
-    return atoa( dest, "},", remLen );
+    return i;
 }
 
-/* Open an array in a JSON string. */
-char* json_arrOpen( char* dest, char const* name, size_t* remLen  ) {
-    if ( NULL == name )
-        dest = chtoa( dest, '[', remLen );
-    else {
-        dest = chtoa( dest, '\"', remLen );
-        dest = atoa( dest, name, remLen );
-        dest = atoa( dest, "\":[", remLen );
+/** Flags of the escape functions. */
+enum {
+    jsonm_escsized  = 1, /**< The length of the source is known. Its null characters
+                              are escaped instead of ending it. */
+    jsonm_escstrict = 2  /**< Invalid UTF-8 stops the copy. Only with JSON_UTF8_ERROR. */
+};
+
+/** Flags for the string values. Names and the schema serializers replace the
+  * invalid UTF-8 with U+FFFD instead. */
+#define escvalue ( JSON_UTF8 == JSON_UTF8_ERROR ? jsonm_escstrict : 0 )
+
+/** Write \uXXXX. */
+static char* jsonm_utoesc( char* dest, unsigned int code ) {
+    dest[0] = '\\';
+    dest[1] = 'u';
+    dest[2] = jsonm_nibbletoch( code >> 12 );
+    dest[3] = jsonm_nibbletoch( code >> 8 );
+    dest[4] = jsonm_nibbletoch( code >> 4 );
+    dest[5] = jsonm_nibbletoch( code );
+    return dest + 6;
+}
+
+/** Write the escape sequence of a special character.
+  * @param dest Destination memory block with room for 12 characters at least.
+  * @param src Pointer to a character whose entry in jsonm_esctab is not zero.
+  * @param len Max length of src. One at least.
+  * @param flags Flags of the escape, see jsonm_escsized and jsonm_escstrict.
+  * @param used Set with the number of characters of src that are written.
+  * @return The length of the escape sequence. Zero for invalid UTF-8 with
+  *         the flag jsonm_escstrict. */
+static size_t jsonm_escseq( char* dest, char const* src, size_t len, int flags, size_t* used ) {
+    unsigned char const ch = *src;
+    int const esc = jsonm_esctab[ ch ];
+    *used = 1;
+    if ( 'x' != esc ) {
+        dest[0] = '\\';
+        dest[1] = esc;
+        if ( 'u' != esc )
+            return 2;
+        return jsonm_utoesc( dest, ch ) - dest;
     }
-    return dest;
+    size_t const n = jsonm_utf8len( src, len );
+    if ( 0 == n ) {
+        if ( flags & jsonm_escstrict )
+            return 0;
+        if ( JSON_UTF8 == JSON_UTF8_ASCII )
+            return jsonm_utoesc( dest, 0xFFFD ) - dest;
+        memcpy( dest, "\xEF\xBF\xBD", 3 );
+        return 3;
+    }
+    *used = n;
+    if ( JSON_UTF8 != JSON_UTF8_ASCII ) {
+        memcpy( dest, src, n );
+        return n;
+    }
+    unsigned long code = ch & ( 0x7Fu >> n );
+    for( size_t i = 1; i < n; ++i )
+        code = code << 6 | ( (unsigned char)src[i] & 0x3Fu );
+    if ( 0x10000 > code )
+        return jsonm_utoesc( dest, code ) - dest;
+    code -= 0x10000;
+    jsonm_utoesc( dest, 0xD800 + ( code >> 10 ) );
+    jsonm_utoesc( dest + 6, 0xDC00 + ( code & 0x3FF ) );
+    return 12;
 }
 
-/* Close an array in a JSON string. */
-char* json_arrClose( char* dest, size_t* remLen  ) {
-    if ( dest[-1] == ',')
-    {
-        --dest;
-        ++*remLen;
+/** Check if a string starts with UTF-8 that stops a strict escape.
+  * @param src Pointer to a character whose entry in jsonm_esctab is not zero.
+  * @param len Max length of src. One at least.
+  * @param flags Flags of the escape, see jsonm_escsized and jsonm_escstrict. */
+static int jsonm_escbad( char const* src, size_t len, int flags ) {
+    return ( flags & jsonm_escstrict ) && 'x' == jsonm_esctab[ (unsigned char)*src ] && 0 == jsonm_utf8len( src, len );
+}
+
+/* The scanner that looks for special characters processes blocks of SCAN_WIDTH
+   bytes with the widest SIMD instruction set enabled at compile time. Define
+   JSON_NO_SIMD to force the scalar version. The scanners never read past the
+   length that they are given: the length of a null-terminated string is found
+   first with memchr(), bounded by the room of the destination, see jsonm_srcbound().
+   Where the instruction set has a byte shuffle, blocks of UTF8_WIDTH bytes of
+   text that is not ASCII are also validated with the lookups of Keiser and
+   Lemire, so JSON_UTF8 copies valid UTF-8 at the speed of ASCII. */
+#if !defined(JSON_NO_SIMD) && ( defined(__AVX2__) || defined(__SSSE3__) || ( defined(__ARM_NEON) && defined(__aarch64__) ) )
+
+/* Errors of the UTF-8 that a pair of bytes shows. Each one needs some high
+   nibble in the first byte, some low nibble in it and some high nibble in the
+   second byte, so the three lookups are ANDed. */
+enum {
+    JSONM_U8SHORT   = 0x01, /* A lead byte followed by ASCII or by a lead byte. */
+    JSONM_U8LONG    = 0x02, /* ASCII followed by a continuation byte. */
+    JSONM_U8OVER3   = 0x04, /* E0 followed by 80..9F. */
+    JSONM_U8LARGE   = 0x08, /* F4..FF followed by 90..BF. */
+    JSONM_U8SURR    = 0x10, /* ED followed by A0..BF. */
+    JSONM_U8OVER2   = 0x20, /* C0 or C1 followed by a continuation byte. */
+    JSONM_U8LARGE80 = 0x40, /* F5..FF followed by 80..8F. */
+    JSONM_U8OVER4   = 0x40, /* F0 followed by 80..8F. */
+    JSONM_U8CONTS   = 0x80, /* Two continuation bytes, right in a sequence of three or four. */
+    JSONM_U8CARRY   = JSONM_U8SHORT | JSONM_U8LONG | JSONM_U8CONTS
+};
+
+/** Errors by the high nibble of the first byte of a pair. */
+static unsigned char const jsonm_u8high1[ 16 ] = {
+    JSONM_U8LONG, JSONM_U8LONG, JSONM_U8LONG, JSONM_U8LONG,
+    JSONM_U8LONG, JSONM_U8LONG, JSONM_U8LONG, JSONM_U8LONG,
+    JSONM_U8CONTS, JSONM_U8CONTS, JSONM_U8CONTS, JSONM_U8CONTS,
+    JSONM_U8SHORT | JSONM_U8OVER2,
+    JSONM_U8SHORT,
+    JSONM_U8SHORT | JSONM_U8OVER3 | JSONM_U8SURR,
+    JSONM_U8SHORT | JSONM_U8LARGE | JSONM_U8LARGE80 | JSONM_U8OVER4
+};
+
+/** Errors by the low nibble of the first byte of a pair. */
+static unsigned char const jsonm_u8low1[ 16 ] = {
+    JSONM_U8CARRY | JSONM_U8OVER3 | JSONM_U8OVER2 | JSONM_U8OVER4,
+    JSONM_U8CARRY | JSONM_U8OVER2,
+    JSONM_U8CARRY,
+    JSONM_U8CARRY,
+    JSONM_U8CARRY | JSONM_U8LARGE,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80 | JSONM_U8SURR,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80,
+    JSONM_U8CARRY | JSONM_U8LARGE | JSONM_U8LARGE80
+};
+
+/** Errors by the high nibble of the second byte of a pair. */
+static unsigned char const jsonm_u8high2[ 16 ] = {
+    JSONM_U8SHORT, JSONM_U8SHORT, JSONM_U8SHORT, JSONM_U8SHORT,
+    JSONM_U8SHORT, JSONM_U8SHORT, JSONM_U8SHORT, JSONM_U8SHORT,
+    JSONM_U8LONG | JSONM_U8OVER2 | JSONM_U8CONTS | JSONM_U8OVER3 | JSONM_U8LARGE80 | JSONM_U8OVER4,
+    JSONM_U8LONG | JSONM_U8OVER2 | JSONM_U8CONTS | JSONM_U8OVER3 | JSONM_U8LARGE,
+    JSONM_U8LONG | JSONM_U8OVER2 | JSONM_U8CONTS | JSONM_U8SURR | JSONM_U8LARGE,
+    JSONM_U8LONG | JSONM_U8OVER2 | JSONM_U8CONTS | JSONM_U8SURR | JSONM_U8LARGE,
+    JSONM_U8SHORT, JSONM_U8SHORT, JSONM_U8SHORT, JSONM_U8SHORT
+};
+
+#endif
+
+#if !defined(JSON_NO_SIMD) && defined(__AVX2__)
+
+#include <immintrin.h>
+#define SCAN_WIDTH 32
+#define UTF8_WIDTH 32
+typedef __m256i jsonm_utf8vec_t;
+
+/** Get the mask of the ASCII characters with escapes of a block. */
+static __m256i jsonm_specials( __m256i data ) {
+    __m256i const ctrl = _mm256_cmpeq_epi8( _mm256_max_epu8( data, _mm256_set1_epi8( 0x1F ) ), _mm256_set1_epi8( 0x1F ) );
+    __m256i const quot = _mm256_cmpeq_epi8( data, _mm256_set1_epi8( '\"' ) );
+    __m256i const bsla = _mm256_cmpeq_epi8( data, _mm256_set1_epi8( '\\' ) );
+    __m256i const sla  = _mm256_cmpeq_epi8( data, _mm256_set1_epi8( '/' ) );
+    return _mm256_or_si256( _mm256_or_si256( ctrl, quot ), _mm256_or_si256( bsla, sla ) );
+}
+
+static unsigned int jsonm_scanblock( char const* src ) {
+    __m256i const data = _mm256_load_si256( (__m256i const*)src );
+    __m256i const spec = jsonm_specials( data );
+    /* The sign bits of the bytes are the bytes that are not ASCII. */
+    return (unsigned int)_mm256_movemask_epi8( NONASCII ? _mm256_or_si256( spec, data ) : spec );
+}
+
+static __m256i jsonm_lookup16( unsigned char const* table, __m256i nibbles ) {
+    __m256i const tab = _mm256_broadcastsi128_si256( _mm_loadu_si128( (__m128i const*)table ) );
+    return _mm256_shuffle_epi8( tab, _mm256_and_si256( nibbles, _mm256_set1_epi8( 0x0F ) ) );
+}
+
+static int jsonm_utf8block( char const* src, __m256i* prev ) {
+    __m256i const data = _mm256_load_si256( (__m256i const*)src );
+    __m256i const cross = _mm256_permute2x128_si256( *prev, data, 0x21 );
+    __m256i const prev1 = _mm256_alignr_epi8( data, cross, 15 );
+    __m256i const prev2 = _mm256_alignr_epi8( data, cross, 14 );
+    __m256i const prev3 = _mm256_alignr_epi8( data, cross, 13 );
+    __m256i const pairs = _mm256_and_si256( _mm256_and_si256(
+        jsonm_lookup16( jsonm_u8high1, _mm256_srli_epi16( prev1, 4 ) ),
+        jsonm_lookup16( jsonm_u8low1, prev1 ) ),
+        jsonm_lookup16( jsonm_u8high2, _mm256_srli_epi16( data, 4 ) ) );
+    __m256i const must23 = _mm256_or_si256(
+        _mm256_subs_epu8( prev2, _mm256_set1_epi8( 0xE0 - 0x80 ) ),
+        _mm256_subs_epu8( prev3, _mm256_set1_epi8( 0xF0 - 0x80 ) ) );
+    __m256i const err = _mm256_xor_si256( _mm256_and_si256( must23, _mm256_set1_epi8( (char)0x80 ) ), pairs );
+    __m256i const stop = _mm256_or_si256( jsonm_specials( data ), err );
+    *prev = data;
+    return -1 != _mm256_movemask_epi8( _mm256_cmpeq_epi8( stop, _mm256_setzero_si256() ) );
+}
+
+static __m256i jsonm_utf8load( unsigned char const* src ) {
+    return _mm256_loadu_si256( (__m256i const*)src );
+}
+
+#elif !defined(JSON_NO_SIMD) && ( defined(__SSE2__) || defined(_M_X64) )
+
+#include <emmintrin.h>
+#define SCAN_WIDTH 16
+
+/** Get the mask of the ASCII characters with escapes of a block. */
+static __m128i jsonm_specials( __m128i data ) {
+    __m128i const ctrl = _mm_cmpeq_epi8( _mm_max_epu8( data, _mm_set1_epi8( 0x1F ) ), _mm_set1_epi8( 0x1F ) );
+    __m128i const quot = _mm_cmpeq_epi8( data, _mm_set1_epi8( '\"' ) );
+    __m128i const bsla = _mm_cmpeq_epi8( data, _mm_set1_epi8( '\\' ) );
+    __m128i const sla  = _mm_cmpeq_epi8( data, _mm_set1_epi8( '/' ) );
+    return _mm_or_si128( _mm_or_si128( ctrl, quot ), _mm_or_si128( bsla, sla ) );
+}
+
+static unsigned int jsonm_scanblock( char const* src ) {
+    __m128i const data = _mm_load_si128( (__m128i const*)src );
+    __m128i const spec = jsonm_specials( data );
+    /* The sign bits of the bytes are the bytes that are not ASCII. */
+    return (unsigned int)_mm_movemask_epi8( NONASCII ? _mm_or_si128( spec, data ) : spec );
+}
+
+#ifdef __SSSE3__
+
+#include <tmmintrin.h>
+#define UTF8_WIDTH 16
+typedef __m128i jsonm_utf8vec_t;
+
+static __m128i jsonm_lookup16( unsigned char const* table, __m128i nibbles ) {
+    __m128i const tab = _mm_loadu_si128( (__m128i const*)table );
+    return _mm_shuffle_epi8( tab, _mm_and_si128( nibbles, _mm_set1_epi8( 0x0F ) ) );
+}
+
+static int jsonm_utf8block( char const* src, __m128i* prev ) {
+    __m128i const data = _mm_load_si128( (__m128i const*)src );
+    __m128i const prev1 = _mm_alignr_epi8( data, *prev, 15 );
+    __m128i const prev2 = _mm_alignr_epi8( data, *prev, 14 );
+    __m128i const prev3 = _mm_alignr_epi8( data, *prev, 13 );
+    __m128i const pairs = _mm_and_si128( _mm_and_si128(
+        jsonm_lookup16( jsonm_u8high1, _mm_srli_epi16( prev1, 4 ) ),
+        jsonm_lookup16( jsonm_u8low1, prev1 ) ),
+        jsonm_lookup16( jsonm_u8high2, _mm_srli_epi16( data, 4 ) ) );
+    __m128i const must23 = _mm_or_si128(
+        _mm_subs_epu8( prev2, _mm_set1_epi8( 0xE0 - 0x80 ) ),
+        _mm_subs_epu8( prev3, _mm_set1_epi8( 0xF0 - 0x80 ) ) );
+    __m128i const err = _mm_xor_si128( _mm_and_si128( must23, _mm_set1_epi8( (char)0x80 ) ), pairs );
+    __m128i const stop = _mm_or_si128( jsonm_specials( data ), err );
+    *prev = data;
+    return 0xFFFF != _mm_movemask_epi8( _mm_cmpeq_epi8( stop, _mm_setzero_si128() ) );
+}
+
+static __m128i jsonm_utf8load( unsigned char const* src ) {
+    return _mm_loadu_si128( (__m128i const*)src );
+}
+
+#endif
+
+#elif !defined(JSON_NO_SIMD) && defined(__ARM_NEON)
+
+#include <arm_neon.h>
+#define SCAN_WIDTH 16
+
+/** Get the mask of the ASCII characters with escapes of a block. */
+static uint8x16_t jsonm_specials( uint8x16_t data ) {
+    uint8x16_t const ctrl = vcltq_u8( data, vdupq_n_u8( 0x20 ) );
+    uint8x16_t const quot = vceqq_u8( data, vdupq_n_u8( '\"' ) );
+    uint8x16_t const bsla = vceqq_u8( data, vdupq_n_u8( '\\' ) );
+    uint8x16_t const sla  = vceqq_u8( data, vdupq_n_u8( '/' ) );
+    return vorrq_u8( vorrq_u8( ctrl, quot ), vorrq_u8( bsla, sla ) );
+}
+
+static unsigned int jsonm_scanblock( char const* src ) {
+    uint8x16_t const data = vld1q_u8( (uint8_t const*)src );
+    uint8x16_t const high = vcgtq_u8( data, vdupq_n_u8( NONASCII ? 0x7F : 0xFF ) );
+    uint8x16_t const spec = vorrq_u8( jsonm_specials( data ), high );
+    /* Narrow to four bits per byte and keep one of them. */
+    uint8x8_t const nibbles = vshrn_n_u16( vreinterpretq_u16_u8( spec ), 4 );
+    uint64_t bits = vget_lane_u64( vreinterpret_u64_u8( nibbles ), 0 ) & 0x1111111111111111ull;
+    unsigned int mask = 0;
+    for( int i = 0; 0 != bits; ++i, bits >>= 4 )
+        mask |= ( bits & 1u ) << i;
+    return mask;
+}
+
+#ifdef __aarch64__
+
+#define UTF8_WIDTH 16
+typedef uint8x16_t jsonm_utf8vec_t;
+
+static uint8x16_t jsonm_lookup16( unsigned char const* table, uint8x16_t nibbles ) {
+    return vqtbl1q_u8( vld1q_u8( table ), nibbles );
+}
+
+static int jsonm_utf8block( char const* src, uint8x16_t* prev ) {
+    uint8x16_t const data = vld1q_u8( (uint8_t const*)src );
+    uint8x16_t const prev1 = vextq_u8( *prev, data, 15 );
+    uint8x16_t const prev2 = vextq_u8( *prev, data, 14 );
+    uint8x16_t const prev3 = vextq_u8( *prev, data, 13 );
+    uint8x16_t const pairs = vandq_u8( vandq_u8(
+        jsonm_lookup16( jsonm_u8high1, vshrq_n_u8( prev1, 4 ) ),
+        jsonm_lookup16( jsonm_u8low1, vandq_u8( prev1, vdupq_n_u8( 0x0F ) ) ) ),
+        jsonm_lookup16( jsonm_u8high2, vshrq_n_u8( data, 4 ) ) );
+    uint8x16_t const must23 = vorrq_u8(
+        vqsubq_u8( prev2, vdupq_n_u8( 0xE0 - 0x80 ) ),
+        vqsubq_u8( prev3, vdupq_n_u8( 0xF0 - 0x80 ) ) );
+    uint8x16_t const err = veorq_u8( vandq_u8( must23, vdupq_n_u8( 0x80 ) ), pairs );
+    *prev = data;
+    return 0 != vmaxvq_u8( vorrq_u8( jsonm_specials( data ), err ) );
+}
+
+static uint8x16_t jsonm_utf8load( unsigned char const* src ) {
+    return vld1q_u8( src );
+}
+
+#endif
+
+#endif
+
+#ifdef SCAN_WIDTH
+
+/** Get the index of the least significant bit set. The mask can not be zero. */
+static unsigned int jsonm_firstbit( unsigned int mask ) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz( mask );
+#else
+    unsigned int i = 0;
+    while( 0 == ( mask & 1u ) ) {
+        mask >>= 1;
+        ++i;
     }
-    return atoa( dest, "],", remLen );
+    return i;
+#endif
 }
 
-/** Add the name of a text property.
-  * @param dest Destination memory.
-  * @param name The name of the property.
-  * @param remLen Pointer to remaining length of dest
-  * @return Pointer to the next char. */
-static char* strname( char* dest, char const* name, size_t* remLen  ) {
-    dest = chtoa( dest, '\"', remLen );
-    if ( NULL != name ) {
-        dest = atoa( dest, name, remLen );
-        dest = atoa( dest, "\":\"", remLen );
+#endif
+
+/** Get the length of a source that the scanners can read. A null-terminated
+  * string is bounded by its null character, so no block goes past its end.
+  * @param src Source string.
+  * @param len Max length of source, (size_t)-1 for unlimit.
+  * @param max Max length that is going to be scanned.
+  * @param flags Flags of the escape, see jsonm_escsized.
+  * @return The length up to the null character if it is before max, else len. */
+static size_t jsonm_srcbound( char const* src, size_t len, size_t max, int flags ) {
+    if ( flags & jsonm_escsized )
+        return len;
+    char const* const nul = memchr( src, '\0', len < max ? len : max );
+    return NULL != nul ? (size_t)( nul - src ) : len;
+}
+
+/** Get the length of the prefix of a string that can be copied without escapes.
+  * The null character is a special character, so it also stops the scan.
+  * Only the first len characters are read.
+  * @param src Source string.
+  * @param len Max length to scan.
+  * @return The length of the prefix. It is len if no special character found. */
+static size_t jsonm_cleanspan( char const* src, size_t len ) {
+    size_t i = 0;
+#ifdef SCAN_WIDTH
+    for( ; i < len && 0 != ( (uintptr_t)( src + i ) % SCAN_WIDTH ); ++i )
+        if ( jsonm_esctab[ (unsigned char)src[i] ] )
+            return i;
+    for( ; len - i >= SCAN_WIDTH; i += SCAN_WIDTH ) {
+        unsigned int const mask = jsonm_scanblock( src + i );
+        if ( 0 != mask )
+            return i + jsonm_firstbit( mask );
     }
-    return dest;
+#endif
+    for( ; i < len; ++i )
+        if ( jsonm_esctab[ (unsigned char)src[i] ] )
+            break;
+    return i;
 }
 
-/** Get the hexadecimal digit of the least significant nibble of a integer. */
-static int nibbletoch( int nibble ) {
-    return "0123456789ABCDEF"[ nibble % 16u ];
+/** Get the length of the prefix of a string made of valid UTF-8 and of ASCII
+  * characters without escapes. With SIMD the blocks are validated whole and
+  * the scalar loop only looks into the block where the prefix ends.
+  * @param src The string.
+  * @param len Max length of src.
+  * @return The length of the prefix. */
+static size_t jsonm_textspan( char const* src, size_t len ) {
+    size_t i = 0;
+#ifdef UTF8_WIDTH
+    while( i < len && 0 != ( (uintptr_t)( src + i ) % UTF8_WIDTH ) ) {
+        size_t const n = jsonm_utf8step( src + i, len - i );
+        if ( 0 == n )
+            return i;
+        i += n;
+    }
+    if ( len - i >= UTF8_WIDTH ) {
+        /* The block before the first one: the end of the sequence that the
+           loop above has checked, if any. */
+        unsigned char tail[ UTF8_WIDTH ] = { 0 };
+        size_t const back = i < 3 ? i : 3;
+        memcpy( tail + UTF8_WIDTH - back, src + i - back, back );
+        jsonm_utf8vec_t prev = jsonm_utf8load( tail );
+        size_t const start = i;
+        while( len - i >= UTF8_WIDTH && !jsonm_utf8block( src + i, &prev ) )
+            i += UTF8_WIDTH;
+        /* Back to the first byte of the last sequence, which may be cut. */
+        size_t const first = i;
+        while( i > start && first - i < 3 && 0x80 == ( src[ i - 1 ] & 0xC0 ) )
+            --i;
+        if ( i > start && 0xC0 <= (unsigned char)src[ i - 1 ] )
+            --i;
+    }
+#endif
+    return i + jsonm_utf8span( src + i, len - i );
+}
+
+/** Copy a string inserting escape characters while whole escapes fit.
+  * Runs of characters without escapes are copied in bulk.
+  * @param dest Destination memory block.
+  * @param src Pointer to the source string. It is updated to the first
+  *            character that is not copied.
+  * @param srclen Pointer to max length of source, (size_t)-1 for unlimit.
+  *               It is updated with the length that is not copied.
+  * @param flags Flags of the escape, see jsonm_escsized and jsonm_escstrict. Without
+  *              jsonm_escsized it stops at a null character.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the end of the copy. It is not null-terminated. */
+static char* jsonm_esccpy( char* dest, char const** src, size_t* srclen, int flags, size_t* remLen ) {
+    char const* s = *src;
+    size_t rem = *remLen;
+    /* Each character of the source takes one of the destination at least. */
+    size_t len = jsonm_srcbound( s, *srclen, rem, flags );
+    for( ;; ) {
+        size_t const max = len < rem ? len : rem;
+        size_t const span = jsonm_cleanspan( s, max );
+        memcpy( dest, s, span );
+        dest += span;
+        rem -= span;
+        s += span;
+        len -= span;
+        if ( 0 == len || ( !( flags & jsonm_escsized ) && '\0' == *s ) || 0 == rem )
+            break;
+        if ( JSON_UTF8 == JSON_UTF8_REPLACE || JSON_UTF8 == JSON_UTF8_ERROR ) {
+            /* Valid text that is not ASCII is copied in bulk too. */
+            size_t const valid = jsonm_textspan( s, len < rem ? len : rem );
+            if ( 0 != valid ) {
+                memcpy( dest, s, valid );
+                dest += valid;
+                rem -= valid;
+                s += valid;
+                len -= valid;
+                continue;
+            }
+        }
+        char seq[ 12 ];
+        size_t used;
+        size_t const seqlen = jsonm_escseq( seq, s, len, flags, &used );
+        if ( 0 == seqlen || seqlen > rem )
+            break;
+        memcpy( dest, seq, seqlen );
+        dest += seqlen;
+        rem -= seqlen;
+        s += used;
+        len -= used;
+        STAT( jsonm_stats.escapeBytes += seqlen - used );
+    }
+    *src = s;
+    *srclen = len;
+    *remLen = rem;
+    return dest;
 }
 
-/** Get the escape character of a non-printable.
-  * @param ch Character source.
-  * @return The escape character or null character if error. */
-static int escape( int ch ) {
-    int i;
-    static struct { char code; char ch; } const pair[] = {
-        { '\"', '\"' }, { '\\', '\\' }, { '/',  '/'  }, { 'b',  '\b' },
-        { 'f',  '\f' }, { 'n',  '\n' }, { 'r',  '\r' }, { 't',  '\t' },
-    };
-    for( i = 0; i < sizeof pair / sizeof *pair; ++i )
-        if ( ch == pair[i].ch )
-            return pair[i].code;
-    return '\0';
+/** Get the length of a string once the escape characters are inserted.
+  * @param src Source string.
+  * @param len Max length of source, (size_t)-1 for unlimit.
+  * @param flags Flags of the escape. See jsonm_esccpy().
+  * @return The length with escapes or (size_t)-1 for invalid UTF-8 with
+  *         jsonm_escstrict. */
+static size_t jsonm_esclen( char const* src, size_t len, int flags ) {
+    size_t rslt = 0;
+    len = jsonm_srcbound( src, len, len, flags );
+    for( ;; ) {
+        size_t const span = jsonm_cleanspan( src, len );
+        rslt += span;
+        if ( span == len || ( !( flags & jsonm_escsized ) && '\0' == src[ span ] ) )
+            return rslt;
+        char seq[ 12 ];
+        size_t used;
+        size_t const seqlen = jsonm_escseq( seq, src + span, len - span, flags, &used );
+        if ( 0 == seqlen )
+            return (size_t)-1;
+        rslt += seqlen;
+        src += span + used;
+        len -= span + used;
+    }
 }
 
-/** Copy a null-terminated string inserting escape characters if needed.
+/** Copy a string inserting escape characters if needed.
   * @param dest Destination memory block.
   * @param src Source string.
-  * @param len Max length of source. < 0 for unlimit.
+  * @param srclen Max length of source, (size_t)-1 for unlimit.
+  * @param flags Flags of the escape. See jsonm_esccpy(). Invalid UTF-8 with
+  *              jsonm_escstrict truncates the JSON: *remLen is set to zero.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the null character of the destination string. */
-static char* atoesc( char* dest, char const* src, int len, size_t* remLen  ) {
-    int i;
-    for( i = 0; src[i] != '\0' && ( i < len || 0 > len ) && *remLen != 0; ++dest, ++i, --*remLen ) {
-        if ( src[i] >= ' ' && src[i] != '\"' && src[i] != '\\' && src[i] != '/' )
-            *dest = src[i];
-        else {
-            if (*remLen != 0) {
-                *dest++ = '\\';
-                --*remLen;
-                int const esc = escape( src[i] );
-                if ( esc )
-                    *dest = esc;
-                else {
-                    if (*remLen != 0) {
-                        --*remLen;
-                        *dest++ = 'u';
-                    }
-                    if (*remLen != 0) {
-                        --*remLen;
-                        *dest++ = '0';
-                    }
-                    if (*remLen != 0) {
-                        --*remLen;
-                        *dest++ = '0';
-                    }
-                    if (*remLen != 0) {
-                        --*remLen;
-                        *dest++ = nibbletoch( src[i] / 16 );
-                    }
-                    if (*remLen != 0) {
-                        --*remLen;
-                        *dest++ = nibbletoch( src[i] );
-                    }
-                }
-            }
+static char* jsonm_atoesc( char* dest, char const* src, size_t srclen, int flags, size_t* remLen  ) {
+    dest = jsonm_esccpy( dest, &src, &srclen, flags, remLen );
+    if ( 0 != srclen && ( ( flags & jsonm_escsized ) || '\0' != *src ) && 0 != *remLen ) {
+        if ( jsonm_escbad( src, srclen, flags ) ) {
+            *remLen = 0;
+            *dest = '\0';
+            return dest;
         }
+        char seq[ 12 ];
+        size_t used;
+        return jsonm_memtoa( dest, seq, jsonm_escseq( seq, src, srclen, flags, &used ), remLen );
     }
+    STAT( jsonm_stats.truncations += 0 != srclen && ( ( flags & jsonm_escsized ) || '\0' != *src ) );
     *dest = '\0';
     return dest;
 }
 
-/* Add a text property in a JSON string. */
-char* json_nstr( char* dest, char const* name, char const* value, int len, size_t* remLen  ) {
-    dest = strname( dest, name, remLen );
-    dest = atoesc( dest, value, len, remLen );
-    dest = atoa( dest, "\",", remLen );
+/** Name of a property as it is given to the functions: a plain name that
+  * is quoted and escaped when it is written, or a key already encoded. */
+typedef struct jsonm_keyref_s {
+    char const* text; /**< The plain name, the encoded key or null. */
+    size_t len;       /**< Length of text. */
+    size_t size;      /**< Length of the name once it is written. */
+    int plain;        /**< One for a plain name. */
+} jsonm_keyref_t;
+
+/** Get the length that the escape sequence of a special character adds.
+  * @param p Pointer to the special character in a name. It is updated to
+  *          the last character of the sequence.
+  * @param len Max length of the name from the special character.
+  * @return The length of the sequence minus the characters that it takes. */
+static size_t jsonm_escextra( char const** p, size_t len ) {
+    char seq[ 12 ];
+    size_t used;
+    size_t const seqlen = jsonm_escseq( seq, *p, len, jsonm_escsized, &used );
+    *p += used - 1;
+    return seqlen - used;
+}
+
+/** The characters that jsonm_esctab escapes, but the null character, for strcspn(). */
+#if NONASCII
+#define namespecials \
+    "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0A\x0B\x0C\x0D\x0E\x0F" \
+    "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1A\x1B\x1C\x1D\x1E\x1F\"/\\" \
+    "\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8A\x8B\x8C\x8D\x8E\x8F" \
+    "\x90\x91\x92\x93\x94\x95\x96\x97\x98\x99\x9A\x9B\x9C\x9D\x9E\x9F" \
+    "\xA0\xA1\xA2\xA3\xA4\xA5\xA6\xA7\xA8\xA9\xAA\xAB\xAC\xAD\xAE\xAF" \
+    "\xB0\xB1\xB2\xB3\xB4\xB5\xB6\xB7\xB8\xB9\xBA\xBB\xBC\xBD\xBE\xBF" \
+    "\xC0\xC1\xC2\xC3\xC4\xC5\xC6\xC7\xC8\xC9\xCA\xCB\xCC\xCD\xCE\xCF" \
+    "\xD0\xD1\xD2\xD3\xD4\xD5\xD6\xD7\xD8\xD9\xDA\xDB\xDC\xDD\xDE\xDF" \
+    "\xE0\xE1\xE2\xE3\xE4\xE5\xE6\xE7\xE8\xE9\xEA\xEB\xEC\xED\xEE\xEF" \
+    "\xF0\xF1\xF2\xF3\xF4\xF5\xF6\xF7\xF8\xF9\xFA\xFB\xFC\xFD\xFE\xFF"
+#else
+#define namespecials \
+    "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0A\x0B\x0C\x0D\x0E\x0F" \
+    "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1A\x1B\x1C\x1D\x1E\x1F\"/\\"
+#endif
+
+/** Get the reference of a plain name.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @return The reference. */
+static inline jsonm_keyref_t jsonm_namekey( char const* name ) {
+    jsonm_keyref_t k = { name, 0, 0, 1 };
+    if ( NULL == name )
+        return k;
+#if defined(__GNUC__) || defined(__clang__)
+    /* When the call is inlined, as in a header-only build or with LTO, a
+       literal name without escapes is measured at compile time. */
+    if ( __builtin_constant_p( strcspn( name, namespecials ) == strlen( name ) )
+         && strcspn( name, namespecials ) == strlen( name ) ) {
+        k.len = strlen( name );
+        k.size = k.len + 3;
+        return k;
+    }
+#endif
+    /* Names are short, so they are measured byte by byte in one pass. */
+    size_t extra = 0;
+    char const* p = name;
+    for( ; '\0' != *p; ++p )
+        if ( 0 != jsonm_esctab[ (unsigned char)*p ] )
+            extra += jsonm_escextra( &p, (size_t)-1 );
+    k.len = p - name;
+    k.size = k.len + extra + 3;
+    return k;
+}
+
+/** Get the reference of a plain name with a known length.
+  * @param name The name. It can have null characters.
+  * @param len Length of name.
+  * @return The reference. */
+static jsonm_keyref_t jsonm_sizedkey( char const* name, size_t len ) {
+    jsonm_keyref_t k = { name, len, 0, 1 };
+    size_t extra = 0;
+    for( char const* p = name; p < name + len; ++p )
+        if ( 0 != jsonm_esctab[ (unsigned char)*p ] )
+            extra += jsonm_escextra( &p, name + len - p );
+    k.size = len + extra + 3;
+    return k;
+}
+
+/** Reference of no name, for the elements of arrays. */
+static jsonm_keyref_t const jsonm_nokey = { NULL, 0, 0, 0 };
+
+/** Get the reference of an encoded key.
+  * @param key The key or null for unnamed.
+  * @return The reference. */
+static inline jsonm_keyref_t jsonm_tokenkey( jsonKey_t const* key ) {
+    jsonm_keyref_t k = { NULL, 0, 0, 0 };
+    if ( NULL != key ) {
+        k.text = key->text;
+        k.len = key->len;
+        k.size = key->len;
+    }
+    return k;
+}
+
+/** Write the name of a property. The room is not checked.
+  * @param dest Destination memory with room for k->size characters.
+  * @param k The name.
+  * @return Pointer to the next char. */
+static inline char* jsonm_keycpy( char* dest, jsonm_keyref_t const* k ) {
+    if ( NULL == k->text )
+        return dest;
+    STAT( jsonm_statname( k->size ) );
+    if ( !k->plain ) {
+        memcpy( dest, k->text, k->len );
+        return dest + k->len;
+    }
+    if ( k->size == k->len + 3 )
+        return jsonm_namecpy( dest, k->text, k->len );
+    char const* src = k->text;
+    size_t srclen = k->len;
+    size_t rem = (size_t)-1;
+    *dest++ = '\"';
+    dest = jsonm_esccpy( dest, &src, &srclen, jsonm_escsized, &rem );
+    *dest++ = '\"';
+    *dest++ = ':';
     return dest;
 }
 
-/** Add the name of a primitive property.
+/** Write the name of a property truncated if it does not fit.
   * @param dest Destination memory.
-  * @param name The name of the property.
+  * @param k The name.
   * @param remLen Pointer to remaining length of dest
-  * @return Pointer to the next char. */
-static char* primitivename( char* dest, char const* name, size_t* remLen  ) {
-    if( NULL == name )
+  * @return Pointer to the null character of the destination string. */
+static char* jsonm_keytoa( char* dest, jsonm_keyref_t const* k, size_t* remLen ) {
+    if ( NULL == k->text )
         return dest;
-    dest = chtoa( dest, '\"', remLen );
-    dest = atoa( dest, name, remLen );
-    dest = atoa( dest, "\":", remLen );
-    return dest;
+    STAT( jsonm_statname( k->size ) );
+    if ( !k->plain )
+        return jsonm_memtoa( dest, k->text, k->len, remLen );
+    dest = jsonm_chtoa( dest, '\"', remLen );
+    dest = jsonm_atoesc( dest, k->text, k->len, jsonm_escsized, remLen );
+    return jsonm_memtoa( dest, "\":", 2, remLen );
 }
 
-/*  Add a boolean property in a JSON string. */
-char* json_bool( char* dest, char const* name, int value, size_t* remLen  ) {
-    dest = primitivename( dest, name, remLen );
-    dest = atoa( dest, value ? "true," : "false,", remLen );
-    return dest;
+/** Encode a name as a key.
+  * @return The length of dest used or zero if it does not fit. */
+static size_t jsonm_keyinit( jsonKey_t* key, jsonm_keyref_t const* k, char* dest, size_t size ) {
+    if ( k->size > size )
+        return 0;
+    key->text = dest;
+    key->len = k->size;
+    jsonm_keycpy( dest, k );
+    return k->size;
 }
 
-/* Add a null property in a JSON string. */
-char* json_null( char* dest, char const* name, size_t* remLen  ) {
-    dest = primitivename( dest, name, remLen );
-    dest = atoa( dest, "null,", remLen );
-    return dest;
+/* Encode a property name as a key. */
+JSON_API size_t json_keyInit( jsonKey_t* key, char const* name, char* dest, size_t size ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_keyinit( key, &k, dest, size );
 }
 
-/* Used to finish the root JSON object. After call json_objClose(). */
-char* json_end( char* dest, size_t* remLen ) {
-    if ( ',' == dest[-1] ) {
-        dest[-1] = '\0';
+/* Encode a property name with a known length as a key. */
+JSON_API size_t json_keyInitLen( jsonKey_t* key, char const* name, size_t len, char* dest, size_t size ) {
+    jsonm_keyref_t const k = jsonm_sizedkey( name, len );
+    return jsonm_keyinit( key, &k, dest, size );
+}
+
+/** Open an object or an array.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param k The name.
+  * @param ch The opening character.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+static inline char* jsonm_openfrag( char* dest, jsonm_keyref_t const* k, char ch, size_t* remLen ) {
+    STAT_BEGIN( JSON_STATS_STRUCT, dest );
+    STAT( jsonm_statopen() );
+    if ( k->size + 1 <= *remLen ) {
+        char* p = jsonm_keycpy( dest, k );
+        *p++ = ch;
+        STAT_RETURN( jsonm_fastend( dest, p, remLen ) );
+    }
+    dest = jsonm_keytoa( dest, k, remLen );
+    STAT_RETURN( jsonm_chtoa( dest, ch, remLen ) );
+}
+
+/** Close an object or an array.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param ch The closing character.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+static char* jsonm_closefrag( char* dest, char ch, size_t* remLen ) {
+    STAT_BEGIN( JSON_STATS_STRUCT, dest );
+    STAT( jsonm_statclose() );
+    if ( dest[-1] == ',' ) {
         --dest;
         ++*remLen;
     }
-    return dest;
+    if ( 2 <= *remLen ) {
+        dest[0] = ch;
+        dest[1] = ',';
+        STAT_RETURN( jsonm_fastend( dest, dest + 2, remLen ) );
+    }
+    STAT_RETURN( jsonm_chtoa( dest, ch, remLen ) );
 }
 
-#ifdef NO_SPRINTF
+/* Open a JSON object in a JSON string. */
+JSON_API char* json_objOpen( char* dest, char const* name, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_openfrag( dest, &k, '{', remLen );
+}
 
-static char* format( char* dest, int len, int isnegative ) {
-    if ( isnegative )
-        dest[ len++ ] = '-';
-    dest[ len ] = '\0';
-    int head = 0;
-    int tail = len - 1;
-    while( head < tail ) {
-        char tmp = dest[ head ];
-        dest[ head ] = dest[ tail ];
-        dest[ tail ] = tmp;
-        ++head;
-        --tail;
-    }
-    return dest + len;
+/* Open a JSON object in a JSON string. */
+JSON_API char* json_objOpen_k( char* dest, jsonKey_t const* key, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_openfrag( dest, &k, '{', remLen );
 }
 
-#define numtoa( func, type, utype )         \
-static char* func( char* dest, type val ) { \
-    enum { base = 10 };                     \
-    if ( 0 == val )                         \
-        return chtoa( dest, '0' );          \
-    int const isnegative = 0 > val;         \
-    utype num = isnegative ? -val : val;    \
-    int len = 0;                            \
-    while( 0 != num ) {                     \
-        int rem = num % base;               \
-        dest[ len++ ] = rem + '0';          \
-        num = num / base;                   \
-    }                                       \
-    return format( dest, len, isnegative ); \
-}                                           \
-
-#define json_num( func, func2, type )                       \
-char* func( char* dest, char const* name, type value ) {    \
-    dest = primitivename( dest, name );                     \
-    dest = func2( dest, value );                            \
-    dest = chtoa( dest, ',' );                              \
-    return dest;                                            \
-}                                                           \
+/* Close a JSON object in a JSON string. */
+JSON_API char* json_objClose( char* dest, size_t* remLen  ) {
+    return jsonm_closefrag( dest, '}', remLen );
+}
 
-#define ALL_TYPES \
-    X( int,      int,          unsigned int        ) \
-    X( long,     long,         unsigned long       ) \
-    X( uint,     unsigned int, unsigned int        ) \
-    X( ulong,    unsigned      long, unsigned long ) \
-    X( verylong, long long,    unsigned long long  ) \
+/* Open an array in a JSON string. */
+JSON_API char* json_arrOpen( char* dest, char const* name, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_openfrag( dest, &k, '[', remLen );
+}
 
-#define X( name, type, utype ) numtoa( name##toa, type, utype )
-ALL_TYPES
-#undef X
+/* Open an array in a JSON string. */
+JSON_API char* json_arrOpen_k( char* dest, jsonKey_t const* key, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_openfrag( dest, &k, '[', remLen );
+}
 
-#define X( name, type, utype ) json_num( json_##name, name##toa, type )
-ALL_TYPES
-#undef X
+/* Close an array in a JSON string. */
+JSON_API char* json_arrClose( char* dest, size_t* remLen  ) {
+    return jsonm_closefrag( dest, ']', remLen );
+}
+
+/** Add a text property.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param k The name.
+  * @param value The value.
+  * @param len Max length of value, (size_t)-1 for unlimit.
+  * @param flags Flags of the escape. See jsonm_esccpy().
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+static inline char* jsonm_strprop( char* dest, jsonm_keyref_t const* k, char const* value, size_t len, int flags, size_t* remLen ) {
+    STAT_BEGIN( JSON_STATS_STRING, dest );
+    if ( k->size + 1 <= *remLen ) {
+        char* p = jsonm_keycpy( dest, k );
+        *p++ = '\"';
+        dest = jsonm_fastend( dest, p, remLen );
+    }
+    else {
+        dest = jsonm_keytoa( dest, k, remLen );
+        dest = jsonm_chtoa( dest, '\"', remLen );
+    }
+    dest = jsonm_atoesc( dest, value, len, flags, remLen );
+    STAT_RETURN( jsonm_memtoa( dest, "\",", 2, remLen ) );
+}
 
-char* json_double( char* dest, char const* name, double value ) {
-    return json_verylong( dest, name, value );
+/* Add a text property in a JSON string. */
+JSON_API char* json_nstr( char* dest, char const* name, char const* value, int len, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_strprop( dest, &k, value, 0 > len ? (size_t)-1 : (size_t)len, escvalue, remLen );
 }
 
-#else
+/* Add a text property in a JSON string. */
+JSON_API char* json_nstr_k( char* dest, jsonKey_t const* key, char const* value, int len, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_strprop( dest, &k, value, 0 > len ? (size_t)-1 : (size_t)len, escvalue, remLen );
+}
 
-#include <stdio.h>
+/* Add a text property with a known length in a JSON string. */
+JSON_API char* json_strLen( char* dest, char const* name, char const* value, size_t len, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_strprop( dest, &k, value, len, jsonm_escsized | escvalue, remLen );
+}
 
-#define ALL_TYPES \
-    X( json_int,      int,           "%d"   ) \
-    X( json_long,     long,          "%ld"  ) \
-    X( json_uint,     unsigned int,  "%u"   ) \
-    X( json_ulong,    unsigned long, "%lu"  ) \
-    X( json_verylong, long long,     "%lld" ) \
-    X( json_double,   double,        "%g"   ) \
+/* Add a text property with a known length in a JSON string. */
+JSON_API char* json_strLen_k( char* dest, jsonKey_t const* key, char const* value, size_t len, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_strprop( dest, &k, value, len, jsonm_escsized | escvalue, remLen );
+}
 
+/** Add a primitive property whose text is known.
+  * @param dest Destination memory.
+  * @param k The name.
+  * @param text The text of the value followed by the comma.
+  * @param len Length of the text.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the null character of the destination string. */
+static inline char* jsonm_primitive( char* dest, jsonm_keyref_t const* k, char const* text, size_t len, size_t* remLen ) {
+    STAT_BEGIN( JSON_STATS_LITERAL, dest );
+    if ( k->size + len <= *remLen ) {
+        char* p = jsonm_keycpy( dest, k );
+        memcpy( p, text, len );
+        STAT_RETURN( jsonm_fastend( dest, p + len, remLen ) );
+    }
+    dest = jsonm_keytoa( dest, k, remLen );
+    STAT_RETURN( jsonm_memtoa( dest, text, len, remLen ) );
+}
 
-#define json_num( funcname, type, fmt )                         \
-char* funcname( char* dest, char const* name, type value, size_t* remLen  ) {    \
-    dest = primitivename( dest, name, remLen );                         \
-    dest += snprintf( dest, *remLen, fmt, value );                        \
-    dest = chtoa( dest, ',', remLen );                                  \
-    return dest;                                                \
+/*  Add a boolean property in a JSON string. */
+JSON_API char* json_bool( char* dest, char const* name, int value, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return value ? jsonm_primitive( dest, &k, "true,", 5, remLen )
+                 : jsonm_primitive( dest, &k, "false,", 6, remLen );
 }
 
-#define X( name, type, fmt ) json_num( name, type, fmt )
-ALL_TYPES
-#undef X
+/*  Add a boolean property in a JSON string. */
+JSON_API char* json_bool_k( char* dest, jsonKey_t const* key, int value, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return value ? jsonm_primitive( dest, &k, "true,", 5, remLen )
+                 : jsonm_primitive( dest, &k, "false,", 6, remLen );
+}
 
+/* Add a null property in a JSON string. */
+JSON_API char* json_null( char* dest, char const* name, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_primitive( dest, &k, "null,", 5, remLen );
+}
 
-#endif
+/* Add a null property in a JSON string. */
+JSON_API char* json_null_k( char* dest, jsonKey_t const* key, size_t* remLen  ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_primitive( dest, &k, "null,", 5, remLen );
+}
+
+/* Add a value that is already serialized in a JSON string. */
+JSON_API char* json_raw( char* dest, char const* name, char const* value, size_t len, size_t* remLen ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    dest = jsonm_primitive( dest, &k, value, len, remLen );
+    return jsonm_chtoa( dest, ',', remLen );
+}
+
+/* Add a value that is already serialized in a JSON string. */
+JSON_API char* json_raw_k( char* dest, jsonKey_t const* key, char const* value, size_t len, size_t* remLen ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    dest = jsonm_primitive( dest, &k, value, len, remLen );
+    return jsonm_chtoa( dest, ',', remLen );
+}
+
+/* Binary values are written as strings that need no escapes, so they are
+   encoded straight into the destination. Their length is known up front, so
+   the room is checked once unless the JSON is near the end of the buffer. */
+
+/** The base64 alphabet. */
+static char const jsonm_b64digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#if !defined(JSON_NO_SIMD) && ( defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) )
+
+/** Bytes of input that the blocks of jsonm_b64block() take and read. */
+enum { JSONM_B64STEP = 12, JSONM_B64READ = 16 };
+
+/** Map 16 indices of the base64 alphabet to its characters. */
+static __m128i jsonm_b64map( __m128i i ) {
+    __m128i c = _mm_add_epi8( i, _mm_set1_epi8( 'A' ) );
+    c = _mm_add_epi8( c, _mm_and_si128( _mm_cmpgt_epi8( i, _mm_set1_epi8( 25 ) ), _mm_set1_epi8( 'a' - 26 - 'A' ) ) );
+    c = _mm_sub_epi8( c, _mm_and_si128( _mm_cmpgt_epi8( i, _mm_set1_epi8( 51 ) ), _mm_set1_epi8( 'a' - 26 - ( '0' - 52 ) ) ) );
+    c = _mm_sub_epi8( c, _mm_and_si128( _mm_cmpgt_epi8( i, _mm_set1_epi8( 61 ) ), _mm_set1_epi8( '0' - 52 - ( '+' - 62 ) ) ) );
+    return _mm_add_epi8( c, _mm_and_si128( _mm_cmpgt_epi8( i, _mm_set1_epi8( 62 ) ), _mm_set1_epi8( '/' - 63 - ( '+' - 62 ) ) ) );
+}
+
+/** Encode 12 bytes in 16 characters of base64. Each 32-bit lane gets three
+  * bytes and is split in four 6-bit indices with shifts and masks. */
+static void jsonm_b64block( char* dest, unsigned char const* src ) {
+    int w[ 4 ];
+    for( int i = 0; i < 4; ++i )
+        memcpy( &w[ i ], src + 3 * i, 4 );
+    __m128i const x = _mm_setr_epi32( w[0], w[1], w[2], w[3] );
+    __m128i i = _mm_and_si128( _mm_srli_epi32( x, 2 ), _mm_set1_epi32( 0x3F ) );
+    i = _mm_or_si128( i, _mm_and_si128( _mm_slli_epi32( x, 12 ), _mm_set1_epi32( 0x3000 ) ) );
+    i = _mm_or_si128( i, _mm_and_si128( _mm_srli_epi32( x, 4 ), _mm_set1_epi32( 0x0F00 ) ) );
+    i = _mm_or_si128( i, _mm_and_si128( _mm_slli_epi32( x, 10 ), _mm_set1_epi32( 0x3C0000 ) ) );
+    i = _mm_or_si128( i, _mm_and_si128( _mm_srli_epi32( x, 6 ), _mm_set1_epi32( 0x030000 ) ) );
+    i = _mm_or_si128( i, _mm_and_si128( _mm_slli_epi32( x, 8 ), _mm_set1_epi32( 0x3F000000 ) ) );
+    _mm_storeu_si128( (__m128i*)dest, jsonm_b64map( i ) );
+}
+
+/** Bytes of input that the blocks of jsonm_hexblock() take. */
+enum { JSONM_HEXSTEP = 16 };
+
+/** Map 16 nibbles to hexadecimal digits. */
+static __m128i jsonm_hexmap( __m128i x ) {
+    __m128i const letter = _mm_and_si128( _mm_cmpgt_epi8( x, _mm_set1_epi8( 9 ) ), _mm_set1_epi8( 'a' - '0' - 10 ) );
+    return _mm_add_epi8( x, _mm_add_epi8( _mm_set1_epi8( '0' ), letter ) );
+}
+
+/** Encode 16 bytes in 32 hexadecimal digits. */
+static void jsonm_hexblock( char* dest, unsigned char const* src ) {
+    __m128i const x = _mm_loadu_si128( (__m128i const*)src );
+    __m128i const hi = _mm_and_si128( _mm_srli_epi16( x, 4 ), _mm_set1_epi8( 0x0F ) );
+    __m128i const lo = _mm_and_si128( x, _mm_set1_epi8( 0x0F ) );
+    _mm_storeu_si128( (__m128i*)dest, jsonm_hexmap( _mm_unpacklo_epi8( hi, lo ) ) );
+    _mm_storeu_si128( (__m128i*)( dest + 16 ), jsonm_hexmap( _mm_unpackhi_epi8( hi, lo ) ) );
+}
+
+#elif !defined(JSON_NO_SIMD) && defined(__ARM_NEON)
+
+/** Bytes of input that the blocks of jsonm_b64block() take and read. */
+enum { JSONM_B64STEP = 48, JSONM_B64READ = 48 };
+
+/** Map 16 indices of the base64 alphabet to its characters. */
+static uint8x16_t jsonm_b64map( uint8x16_t i ) {
+    uint8x16_t c = vaddq_u8( i, vdupq_n_u8( 'A' ) );
+    c = vaddq_u8( c, vandq_u8( vcgtq_u8( i, vdupq_n_u8( 25 ) ), vdupq_n_u8( 'a' - 26 - 'A' ) ) );
+    c = vsubq_u8( c, vandq_u8( vcgtq_u8( i, vdupq_n_u8( 51 ) ), vdupq_n_u8( 'a' - 26 - ( '0' - 52 ) ) ) );
+    c = vsubq_u8( c, vandq_u8( vcgtq_u8( i, vdupq_n_u8( 61 ) ), vdupq_n_u8( '0' - 52 - ( '+' - 62 ) ) ) );
+    return vaddq_u8( c, vandq_u8( vcgtq_u8( i, vdupq_n_u8( 62 ) ), vdupq_n_u8( '/' - 63 - ( '+' - 62 ) ) ) );
+}
+
+/** Encode 48 bytes in 64 characters of base64. The loads and the stores
+  * deinterleave the bytes and interleave the characters. */
+static void jsonm_b64block( char* dest, unsigned char const* src ) {
+    uint8x16x3_t const in = vld3q_u8( src );
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8( in.val[0], 2 );
+    out.val[1] = vorrq_u8( vandq_u8( vshlq_n_u8( in.val[0], 4 ), vdupq_n_u8( 0x30 ) ), vshrq_n_u8( in.val[1], 4 ) );
+    out.val[2] = vorrq_u8( vandq_u8( vshlq_n_u8( in.val[1], 2 ), vdupq_n_u8( 0x3C ) ), vshrq_n_u8( in.val[2], 6 ) );
+    out.val[3] = vandq_u8( in.val[2], vdupq_n_u8( 0x3F ) );
+    for( int i = 0; i < 4; ++i )
+        out.val[i] = jsonm_b64map( out.val[i] );
+    vst4q_u8( (uint8_t*)dest, out );
+}
+
+/** Bytes of input that the blocks of jsonm_hexblock() take. */
+enum { JSONM_HEXSTEP = 16 };
+
+/** Map 16 nibbles to hexadecimal digits. */
+static uint8x16_t jsonm_hexmap( uint8x16_t x ) {
+    uint8x16_t const letter = vandq_u8( vcgtq_u8( x, vdupq_n_u8( 9 ) ), vdupq_n_u8( 'a' - '0' - 10 ) );
+    return vaddq_u8( x, vaddq_u8( vdupq_n_u8( '0' ), letter ) );
+}
+
+/** Encode 16 bytes in 32 hexadecimal digits. */
+static void jsonm_hexblock( char* dest, unsigned char const* src ) {
+    uint8x16_t const x = vld1q_u8( src );
+    uint8x16x2_t out;
+    out.val[0] = jsonm_hexmap( vshrq_n_u8( x, 4 ) );
+    out.val[1] = jsonm_hexmap( vandq_u8( x, vdupq_n_u8( 0x0F ) ) );
+    vst2q_u8( (uint8_t*)dest, out );
+}
+
+#else
+
+/** Bytes of input that the blocks of jsonm_b64block() take and read. */
+enum { JSONM_B64STEP = 3, JSONM_B64READ = 3 };
+
+/** Encode 3 bytes in 4 characters of base64. */
+static void jsonm_b64block( char* dest, unsigned char const* src ) {
+    unsigned long const x = (unsigned long)src[0] << 16 | (unsigned long)src[1] << 8 | src[2];
+    dest[0] = jsonm_b64digits[ x >> 18 ];
+    dest[1] = jsonm_b64digits[ x >> 12 & 0x3F ];
+    dest[2] = jsonm_b64digits[ x >> 6 & 0x3F ];
+    dest[3] = jsonm_b64digits[ x & 0x3F ];
+}
+
+/** Bytes of input that the blocks of jsonm_hexblock() take. */
+enum { JSONM_HEXSTEP = 1 };
+
+/** Encode a byte in 2 hexadecimal digits. */
+static void jsonm_hexblock( char* dest, unsigned char const* src ) {
+    dest[0] = "0123456789abcdef"[ *src >> 4 ];
+    dest[1] = "0123456789abcdef"[ *src & 0x0F ];
+}
+
+#endif
+
+/** Write binary data in base64 with padding. The room is not checked.
+  * @param dest Destination memory block with room for jsonm_b64len( len ).
+  * @param data The data.
+  * @param len Length of data.
+  * @return Pointer to the character after the encoding. */
+static char* jsonm_b64fmt( char* dest, unsigned char const* data, size_t len ) {
+    for( ; len >= JSONM_B64READ; len -= JSONM_B64STEP, data += JSONM_B64STEP, dest += JSONM_B64STEP / 3 * 4 )
+        jsonm_b64block( dest, data );
+    for( ; len >= 3; len -= 3, data += 3, dest += 4 ) {
+        unsigned long const x = (unsigned long)data[0] << 16 | (unsigned long)data[1] << 8 | data[2];
+        dest[0] = jsonm_b64digits[ x >> 18 ];
+        dest[1] = jsonm_b64digits[ x >> 12 & 0x3F ];
+        dest[2] = jsonm_b64digits[ x >> 6 & 0x3F ];
+        dest[3] = jsonm_b64digits[ x & 0x3F ];
+    }
+    if ( 0 == len )
+        return dest;
+    unsigned long const x = (unsigned long)data[0] << 16 | ( 2 == len ? (unsigned long)data[1] << 8 : 0 );
+    dest[0] = jsonm_b64digits[ x >> 18 ];
+    dest[1] = jsonm_b64digits[ x >> 12 & 0x3F ];
+    dest[2] = 2 == len ? jsonm_b64digits[ x >> 6 & 0x3F ] : '=';
+    dest[3] = '=';
+    return dest + 4;
+}
+
+/** Get the length of the base64 of some binary data. */
+static size_t jsonm_b64len( size_t len ) {
+    return ( len + 2 ) / 3 * 4;
+}
+
+/** Write binary data in lowercase hexadecimal. The room is not checked.
+  * @param dest Destination memory block with room for jsonm_hexlen( len ).
+  * @param data The data.
+  * @param len Length of data.
+  * @return Pointer to the character after the encoding. */
+static char* jsonm_hexfmt( char* dest, unsigned char const* data, size_t len ) {
+    for( ; len >= JSONM_HEXSTEP; len -= JSONM_HEXSTEP, data += JSONM_HEXSTEP, dest += 2 * JSONM_HEXSTEP )
+        jsonm_hexblock( dest, data );
+    for( ; 0 != len; --len, ++data, dest += 2 ) {
+        dest[0] = "0123456789abcdef"[ *data >> 4 ];
+        dest[1] = "0123456789abcdef"[ *data & 0x0F ];
+    }
+    return dest;
+}
+
+/** Get the length of the hexadecimal of some binary data. */
+static size_t jsonm_hexlen( size_t len ) {
+    return 2 * len;
+}
+
+/** An encoding of binary data in the text of a string. */
+typedef struct jsonm_binenc_s {
+    char* (*fmt)( char*, unsigned char const*, size_t ); /**< Writes it. */
+    size_t (*len)( size_t ); /**< Gets its exact length. */
+} jsonm_binenc_t;
+
+static jsonm_binenc_t const jsonm_base64 = { jsonm_b64fmt, jsonm_b64len };
+static jsonm_binenc_t const jsonm_hex = { jsonm_hexfmt, jsonm_hexlen };
+
+/** Bytes of data that are encoded at a time when the encoding does not fit.
+  * A multiple of 3, so only the last chunk of base64 has padding. */
+enum { jsonm_binchunk = 48 };
+
+/** Add a binary property encoded in a string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param k The name.
+  * @param data The data.
+  * @param len Length of data.
+  * @param enc The encoding.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+static char* jsonm_binprop( char* dest, jsonm_keyref_t const* k, void const* data, size_t len, jsonm_binenc_t const* enc, size_t* remLen ) {
+    STAT_BEGIN( JSON_STATS_BINARY, dest );
+    unsigned char const* src = data;
+    if ( k->size + enc->len( len ) + 3 <= *remLen ) {
+        char* p = jsonm_keycpy( dest, k );
+        *p++ = '\"';
+        p = enc->fmt( p, src, len );
+        *p++ = '\"';
+        *p++ = ',';
+        STAT_RETURN( jsonm_fastend( dest, p, remLen ) );
+    }
+    dest = jsonm_keytoa( dest, k, remLen );
+    dest = jsonm_chtoa( dest, '\"', remLen );
+    for( ; 0 != len && 0 != *remLen; ) {
+        size_t const n = len < jsonm_binchunk ? len : jsonm_binchunk;
+        char chunk[ 2 * jsonm_binchunk ];
+        dest = jsonm_memtoa( dest, chunk, enc->fmt( chunk, src, n ) - chunk, remLen );
+        src += n;
+        len -= n;
+    }
+    STAT_RETURN( jsonm_memtoa( dest, "\",", 2, remLen ) );
+}
+
+/* Add a binary property in base64 in a JSON string. */
+JSON_API char* json_base64( char* dest, char const* name, void const* data, size_t len, size_t* remLen ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_binprop( dest, &k, data, len, &jsonm_base64, remLen );
+}
+
+/* Add a binary property in base64 in a JSON string. */
+JSON_API char* json_base64_k( char* dest, jsonKey_t const* key, void const* data, size_t len, size_t* remLen ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_binprop( dest, &k, data, len, &jsonm_base64, remLen );
+}
+
+/* Add a binary property in hexadecimal in a JSON string. */
+JSON_API char* json_hex( char* dest, char const* name, void const* data, size_t len, size_t* remLen ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_binprop( dest, &k, data, len, &jsonm_hex, remLen );
+}
+
+/* Add a binary property in hexadecimal in a JSON string. */
+JSON_API char* json_hex_k( char* dest, jsonKey_t const* key, void const* data, size_t len, size_t* remLen ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_binprop( dest, &k, data, len, &jsonm_hex, remLen );
+}
+
+/* Used to finish the root JSON object. After call json_objClose(). */
+JSON_API char* json_end( char* dest, size_t* remLen ) {
+    STAT( jsonm_statdepth = 0 );
+    if ( ',' == dest[-1] ) {
+        dest[-1] = '\0';
+        --dest;
+        ++*remLen;
+    }
+    return dest;
+}
+
+/** The decimal representation of the numbers from 0 to 99. */
+static char const jsonm_digitpairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/** Get the number of decimal digits of an integer. */
+static int jsonm_numdigits( unsigned long long num ) {
+    int len = 1;
+    for( ;; num /= 10000, len += 4 ) {
+        if ( num < 10 )     return len;
+        if ( num < 100 )    return len + 1;
+        if ( num < 1000 )   return len + 2;
+        if ( num < 10000 )  return len + 3;
+    }
+}
+
+/* The digits are written two at a time from the end of the number to the
+   start, so its length is needed first. The room is not checked. */
+#define numfmt( func, type, utype )                                 \
+static char* func( char* dest, type val ) {                         \
+    int const isnegative = 0 > val;                                 \
+    utype num = isnegative ? 0u - (utype)val : (utype)val;          \
+    char* const end = dest + isnegative + jsonm_numdigits( num );   \
+    char* p = end;                                                  \
+    for( ; num >= 100; num /= 100 ) {                               \
+        char const* pair = jsonm_digitpairs + 2 * ( num % 100 );    \
+        *--p = pair[1];                                             \
+        *--p = pair[0];                                             \
+    }                                                               \
+    if ( num >= 10 ) {                                              \
+        *--p = jsonm_digitpairs[ 2 * num + 1 ];                     \
+        *--p = jsonm_digitpairs[ 2 * num ];                         \
+    }                                                               \
+    else                                                            \
+        *--p = '0' + num;                                           \
+    if ( isnegative )                                               \
+        *--p = '-';                                                 \
+    return end;                                                     \
+}
+
+/* The length of the text of an integer without writing it. */
+#define numlen( func, type, utype )                                 \
+static size_t func( type val ) {                                    \
+    int const isnegative = 0 > val;                                 \
+    utype const num = isnegative ? 0u - (utype)val : (utype)val;    \
+    return isnegative + jsonm_numdigits( num );                     \
+}
+
+/** Max length of the text of a number. */
+enum { jsonm_numbound = 32 };
+
+/* If the number does not fit, it is built in a temporary buffer and
+   truncated. */
+#define json_num( func, fmt, type, family )                                 \
+static inline char* func( char* dest, jsonm_keyref_t const* k, type value, size_t* remLen ) { \
+    STAT_BEGIN( family, dest );                                             \
+    if ( k->size + jsonm_numbound + 1 <= *remLen ) {                        \
+        char* p = fmt( jsonm_keycpy( dest, k ), value );                    \
+        *p++ = ',';                                                         \
+        STAT_RETURN( jsonm_fastend( dest, p, remLen ) );                    \
+    }                                                                       \
+    char buff[ jsonm_numbound ];                                            \
+    dest = jsonm_keytoa( dest, k, remLen );                                 \
+    dest = jsonm_memtoa( dest, buff, fmt( buff, value ) - buff, remLen );   \
+    STAT_RETURN( jsonm_chtoa( dest, ',', remLen ) );                        \
+}
+
+/* Each property function has a version for plain names and another for
+   encoded keys. */
+#define json_prop( func, prop, type )                                       \
+JSON_API char* func( char* dest, char const* name, type value, size_t* remLen ) { \
+    jsonm_keyref_t const k = jsonm_namekey( name );                         \
+    return prop( dest, &k, value, remLen );                                 \
+}                                                                           \
+                                                                            \
+JSON_API char* func##_k( char* dest, jsonKey_t const* key, type value, size_t* remLen ) { \
+    jsonm_keyref_t const k = jsonm_tokenkey( key );                         \
+    return prop( dest, &k, value, remLen );                                 \
+}
+
+#define ALL_TYPES \
+    X( int,      int,           unsigned int       ) \
+    X( long,     long,          unsigned long      ) \
+    X( uint,     unsigned int,  unsigned int       ) \
+    X( ulong,    unsigned long, unsigned long      ) \
+    X( verylong, long long,     unsigned long long ) \
+
+#define X( name, type, utype ) numfmt( jsonm_##name##fmt, type, utype )
+ALL_TYPES
+#undef X
+
+#define X( name, type, utype ) json_num( jsonm_##name##prop, jsonm_##name##fmt, type, JSON_STATS_INTEGER )
+ALL_TYPES
+#undef X
+
+#define X( name, type, utype ) json_prop( json_##name, jsonm_##name##prop, type )
+ALL_TYPES
+#undef X
+
+/* Doubles are converted with the Grisu2 algorithm by Florian Loitsch, in the
+   way of the implementation of Milo Yip. It finds the shortest digit string
+   in the rounding interval of the value, or one that is at most a digit
+   longer in rare cases, so the text always reads back to the same double. */
+
+/** Floating point number with a 64-bit significand and a binary exponent. */
+struct jsonm_diyfp {
+    uint64_t f;
+    int e;
+};
+
+enum {
+    jsonm_dpsignificandsize = 52,
+    jsonm_dpexponentbias    = 0x3FF + jsonm_dpsignificandsize,
+    jsonm_dpminexponent     = -jsonm_dpexponentbias
+};
+
+#define dphiddenbit ( (uint64_t)1 << jsonm_dpsignificandsize )
+
+/** Get the significand and the exponent of a positive finite double. */
+static struct jsonm_diyfp jsonm_todiyfp( uint64_t bits ) {
+    int const biased = (int)( bits >> jsonm_dpsignificandsize ) & 0x7FF;
+    uint64_t const significand = bits & ( dphiddenbit - 1 );
+    struct jsonm_diyfp rslt;
+    if ( 0 != biased ) {
+        rslt.f = significand + dphiddenbit;
+        rslt.e = biased - jsonm_dpexponentbias;
+    }
+    else {
+        rslt.f = significand;
+        rslt.e = jsonm_dpminexponent + 1;
+    }
+    return rslt;
+}
+
+/** Multiply two numbers keeping the 64 most significant bits rounded. */
+static struct jsonm_diyfp jsonm_diyfpmul( struct jsonm_diyfp x, struct jsonm_diyfp y ) {
+    uint64_t const m32 = 0xFFFFFFFFu;
+    uint64_t const a = x.f >> 32, b = x.f & m32;
+    uint64_t const c = y.f >> 32, d = y.f & m32;
+    uint64_t const ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = ( bd >> 32 ) + ( ad & m32 ) + ( bc & m32 );
+    tmp += 1u << 31;
+    struct jsonm_diyfp const rslt = { ac + ( ad >> 32 ) + ( bc >> 32 ) + ( tmp >> 32 ), x.e + y.e + 64 };
+    return rslt;
+}
+
+/** Shift a non-zero number so its most significant bit is set. */
+static struct jsonm_diyfp jsonm_normalize( struct jsonm_diyfp x ) {
+#if defined(__GNUC__) || defined(__clang__)
+    int const shift = __builtin_clzll( x.f );
+    x.f <<= shift;
+    x.e -= shift;
+#else
+    while( 0 == ( x.f & ( (uint64_t)1 << 63 ) ) ) {
+        x.f <<= 1;
+        --x.e;
+    }
+#endif
+    return x;
+}
+
+/** Normalized significands of the powers of ten from 1e-348 to 1e340, in steps of 1e8. */
+static uint64_t const jsonm_cachedpowersf[] = {
+    0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull,
+    0xcf42894a5dce35eaull, 0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull,
+    0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full, 0xbe5691ef416bd60cull,
+    0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+    0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull,
+    0xc21094364dfb5637ull, 0x9096ea6f3848984full, 0xd77485cb25823ac7ull,
+    0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull, 0xb23867fb2a35b28eull,
+    0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+    0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull,
+    0xb5b5ada8aaff80b8ull, 0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull,
+    0x964e858c91ba2655ull, 0xdff9772470297ebdull, 0xa6dfbd9fb8e5b88full,
+    0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+    0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull,
+    0xaa242499697392d3ull, 0xfd87b5f28300ca0eull, 0xbce5086492111aebull,
+    0x8cbccc096f5088ccull, 0xd1b71758e219652cull, 0x9c40000000000000ull,
+    0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+    0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull,
+    0x9f4f2726179a2245ull, 0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull,
+    0x83c7088e1aab65dbull, 0xc45d1df942711d9aull, 0x924d692ca61be758ull,
+    0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+    0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull,
+    0x952ab45cfa97a0b3ull, 0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull,
+    0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull, 0x88fcf317f22241e2ull,
+    0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+    0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull,
+    0x8bab8eefb6409c1aull, 0xd01fef10a657842cull, 0x9b10a4e5e9913129ull,
+    0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull, 0x80444b5e7aa7cf85ull,
+    0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+    0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull
+};
+
+/** Binary exponents of the cached powers of ten. */
+static short const jsonm_cachedpowerse[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007,  -980,
+     -954,  -927,  -901,  -874,  -847,  -821,  -794,  -768,  -741,  -715,
+     -688,  -661,  -635,  -608,  -582,  -555,  -529,  -502,  -475,  -449,
+     -422,  -396,  -369,  -343,  -316,  -289,  -263,  -236,  -210,  -183,
+     -157,  -130,  -103,   -77,   -50,   -24,     3,    30,    56,    83,
+      109,   136,   162,   189,   216,   242,   269,   295,   322,   348,
+      375,   402,   428,   455,   481,   508,   534,   561,   588,   614,
+      641,   667,   694,   720,   747,   774,   800,   827,   853,   880,
+      907,   933,   960,   986,  1013,  1039,  1066
+};
+
+/** Get a cached power of ten that brings a number with binary exponent e
+  * into the range where the digits are generated.
+  * @param e Binary exponent of the number to scale.
+  * @param k Set with the decimal exponent of the inverse of the power.
+  * @return The power of ten. */
+static struct jsonm_diyfp jsonm_cachedpower( int e, int* k ) {
+    double const dk = ( -61 - e ) * 0.30102999566398114 + 347;
+    int kk = (int)dk;
+    if ( dk - kk > 0.0 )
+        ++kk;
+    unsigned const index = (unsigned)( ( kk >> 3 ) + 1 );
+    *k = -( -348 + (int)( index << 3 ) );
+    struct jsonm_diyfp const rslt = { jsonm_cachedpowersf[ index ], jsonm_cachedpowerse[ index ] };
+    return rslt;
+}
+
+static uint64_t const jsonm_powersof10[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+    100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+/** Move the last digit towards the value while it stays in the interval. */
+static void jsonm_grisuround( char* digits, int len, uint64_t delta, uint64_t rest, uint64_t tenkappa, uint64_t wpw ) {
+    while( rest < wpw && delta - rest >= tenkappa &&
+           ( rest + tenkappa < wpw || wpw - rest > rest + tenkappa - wpw ) ) {
+        --digits[ len - 1 ];
+        rest += tenkappa;
+    }
+}
+
+/** Generate the shortest digits of the upper bound that stay in the interval.
+  * @param w Scaled value.
+  * @param mp Scaled upper bound of the rounding interval.
+  * @param delta Width of the scaled rounding interval.
+  * @param digits Destination of the digits, 18 characters at least.
+  * @param k Decimal exponent. It is updated with the dropped digits.
+  * @return The number of digits. */
+static int jsonm_digitgen( struct jsonm_diyfp w, struct jsonm_diyfp mp, uint64_t delta, char* digits, int* k ) {
+    int const shift = -mp.e;
+    uint64_t const one = (uint64_t)1 << shift;
+    uint64_t const wpw = mp.f - w.f;
+    uint32_t p1 = (uint32_t)( mp.f >> shift );
+    uint64_t p2 = mp.f & ( one - 1 );
+    int kappa = jsonm_numdigits( p1 );
+    int len = 0;
+    while( kappa > 0 ) {
+        uint32_t const div = (uint32_t)jsonm_powersof10[ kappa - 1 ];
+        uint32_t const d = p1 / div;
+        p1 %= div;
+        if ( 0 != d || 0 != len )
+            digits[ len++ ] = '0' + d;
+        --kappa;
+        uint64_t const rest = ( (uint64_t)p1 << shift ) + p2;
+        if ( rest <= delta ) {
+            *k += kappa;
+            jsonm_grisuround( digits, len, delta, rest, jsonm_powersof10[ kappa ] << shift, wpw );
+            return len;
+        }
+    }
+    for( ;; ) {
+        p2 *= 10;
+        delta *= 10;
+        char const d = (char)( p2 >> shift );
+        if ( 0 != d || 0 != len )
+            digits[ len++ ] = '0' + d;
+        p2 &= one - 1;
+        --kappa;
+        if ( p2 < delta ) {
+            *k += kappa;
+            int const index = -kappa;
+            jsonm_grisuround( digits, len, delta, p2, one, wpw * ( index < 20 ? jsonm_powersof10[ index ] : 0 ) );
+            return len;
+        }
+    }
+}
+
+/** Get the shortest digits of a positive finite double that read back to it.
+  * @param bits Bit pattern of the double.
+  * @param digits Destination of the digits, 18 characters at least.
+  * @param k Set with the decimal exponent: value = digits * 10^k.
+  * @return The number of digits. */
+static int jsonm_grisu2( uint64_t bits, char* digits, int* k ) {
+    struct jsonm_diyfp const v = jsonm_todiyfp( bits );
+    struct jsonm_diyfp const plus = { ( v.f << 1 ) + 1, v.e - 1 };
+    struct jsonm_diyfp const wp = jsonm_normalize( plus );
+    struct jsonm_diyfp wm = v.f == dphiddenbit
+                    ? (struct jsonm_diyfp){ ( v.f << 2 ) - 1, v.e - 2 }
+                    : (struct jsonm_diyfp){ ( v.f << 1 ) - 1, v.e - 1 };
+    wm.f <<= wm.e - wp.e;
+    wm.e = wp.e;
+    struct jsonm_diyfp const cmk = jsonm_cachedpower( wp.e, k );
+    struct jsonm_diyfp const w = jsonm_diyfpmul( jsonm_normalize( v ), cmk );
+    struct jsonm_diyfp mp = jsonm_diyfpmul( wp, cmk );
+    struct jsonm_diyfp mm = jsonm_diyfpmul( wm, cmk );
+    ++mm.f;
+    --mp.f;
+    return jsonm_digitgen( w, mp, mp.f - mm.f, digits, k );
+}
+
+/** Write the exponent of the scientific notation. */
+static char* jsonm_exptoa( char* dest, int exp ) {
+    *dest++ = 'e';
+    *dest++ = 0 > exp ? '-' : '+';
+    if ( 0 > exp )
+        exp = -exp;
+    if ( exp >= 100 ) {
+        *dest++ = '0' + exp / 100;
+        exp %= 100;
+        *dest++ = jsonm_digitpairs[ 2 * exp ];
+        *dest++ = jsonm_digitpairs[ 2 * exp + 1 ];
+    }
+    else if ( exp >= 10 ) {
+        *dest++ = jsonm_digitpairs[ 2 * exp ];
+        *dest++ = jsonm_digitpairs[ 2 * exp + 1 ];
+    }
+    else
+        *dest++ = '0' + exp;
+    return dest;
+}
+
+/** Write the digits of a double with the layout of JavaScript: plain decimal
+  * notation from 1e-6 to 1e21 and scientific notation outside.
+  * @param dest Destination with room for 25 characters.
+  * @param digits The significant digits.
+  * @param len Number of digits.
+  * @param k Decimal exponent: value = digits * 10^k.
+  * @return Pointer to the character after the number. */
+static char* jsonm_prettify( char* dest, char const* digits, int len, int k ) {
+    int const point = len + k;
+    if ( len <= point && point <= 21 ) {
+        memcpy( dest, digits, len );
+        memset( dest + len, '0', k );
+        return dest + point;
+    }
+    if ( 0 < point && point <= 21 ) {
+        memcpy( dest, digits, point );
+        dest[ point ] = '.';
+        memcpy( dest + point + 1, digits + point, len - point );
+        return dest + len + 1;
+    }
+    if ( -6 < point && point <= 0 ) {
+        dest[0] = '0';
+        dest[1] = '.';
+        memset( dest + 2, '0', -point );
+        memcpy( dest + 2 - point, digits, len );
+        return dest + 2 - point + len;
+    }
+    *dest++ = digits[0];
+    if ( 1 < len ) {
+        *dest++ = '.';
+        memcpy( dest, digits + 1, len - 1 );
+        dest += len - 1;
+    }
+    return jsonm_exptoa( dest, point - 1 );
+}
+
+#ifndef JSON_NONFINITE
+#define JSON_NONFINITE JSON_NONFINITE_NULL
+#endif
+
+/** Write the shortest decimal text of a double that reads back to the same
+  * double. It does not depend on the printf family or on the locale. NaN and
+  * infinities are written as null or as strings as JSON_NONFINITE selects.
+  * The room is not checked.
+  * @param dest Destination memory block with room for jsonm_numbound characters.
+  * @param val The value.
+  * @return Pointer to the character after the number. */
+static char* jsonm_doublefmt( char* dest, double val ) {
+    uint64_t bits;
+    memcpy( &bits, &val, sizeof bits );
+    if ( 0x7FF == ( ( bits >> jsonm_dpsignificandsize ) & 0x7FF ) ) {
+        char const* text = "null";
+#if JSON_NONFINITE == JSON_NONFINITE_STRING
+        text = 0 != ( bits & ( dphiddenbit - 1 ) ) ? "\"NaN\""
+             : bits >> 63                          ? "\"-Infinity\""
+             :                                       "\"Infinity\"";
+#endif
+        size_t const len = strlen( text );
+        memcpy( dest, text, len );
+        return dest + len;
+    }
+    if ( bits >> 63 )
+        *dest++ = '-';
+    bits &= ~( (uint64_t)1 << 63 );
+    if ( 0 == bits ) {
+        *dest++ = '0';
+        return dest;
+    }
+    char digits[ 18 ];
+    int k;
+    int const len = jsonm_grisu2( bits, digits, &k );
+    return jsonm_prettify( dest, digits, len, k );
+}
+
+json_num( jsonm_finiteprop, jsonm_doublefmt, double, JSON_STATS_REAL )
+
+/** Add a double precision number property.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param k The name.
+  * @param value Value of the property.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+static char* jsonm_doubleprop( char* dest, jsonm_keyref_t const* k, double value, size_t* remLen ) {
+#if JSON_NONFINITE == JSON_NONFINITE_ERROR
+    if ( value != value || value - value != 0 ) {
+        *remLen = 0;
+        *dest = '\0';
+        return dest;
+    }
+#endif
+    return jsonm_finiteprop( dest, k, value, remLen );
+}
+
+json_prop( json_double, jsonm_doubleprop, double )
+
+/** Check if a number can be written in the fast path of the arrays.
+  * @param value The number.
+  * @return Zero for NaN and infinities with JSON_NONFINITE_ERROR. */
+static int jsonm_writable( double value ) {
+#if JSON_NONFINITE == JSON_NONFINITE_ERROR
+    return value == value && value - value == 0;
+#else
+    (void)value;
+    return 1;
+#endif
+}
+
+/** Every integer can be written in the fast path of the arrays. */
+#define anyvalue( value ) 1
+
+/* The arrays are written in blocks of as many numbers as fit in the remaining
+   length in the worst case, with one check per block. Near the end of the
+   buffer, and for the values that the fast path can not write, the numbers
+   are written one by one as with the single functions. */
+#define json_arr( func, fmt, prop, ok, type )                                \
+JSON_API char* func( char* dest, char const* name, type const* values,      \
+                     size_t n, size_t stride, size_t* remLen ) {             \
+    STAT_BEGIN( JSON_STATS_ARRAY, dest );                                    \
+    jsonm_keyref_t const k = jsonm_namekey( name );                          \
+    dest = jsonm_openfrag( dest, &k, '[', remLen );                          \
+    char const* src = (char const*)values;                                   \
+    while( 0 != n ) {                                                        \
+        size_t blk = *remLen / ( jsonm_numbound + 1 );                       \
+        if ( blk > n )                                                       \
+            blk = n;                                                         \
+        char* p = dest;                                                      \
+        size_t i = 0;                                                        \
+        for( ; i < blk && ok( *(type const*)src ); ++i, src += stride ) {   \
+            p = fmt( p, *(type const*)src );                                 \
+            *p++ = ',';                                                      \
+        }                                                                    \
+        dest = jsonm_fastend( dest, p, remLen );                             \
+        n -= i;                                                              \
+        if ( i == blk && 0 != blk )                                          \
+            continue;                                                        \
+        if ( 0 == n )                                                        \
+            break;                                                           \
+        dest = prop( dest, &jsonm_nokey, *(type const*)src, remLen );        \
+        src += stride;                                                       \
+        --n;                                                                 \
+    }                                                                        \
+    STAT_RETURN( jsonm_closefrag( dest, ']', remLen ) );                     \
+}
+
+#define X( name, type, utype ) json_arr( json_##name##Stride, jsonm_##name##fmt, jsonm_##name##prop, anyvalue, type )
+ALL_TYPES
+#undef X
+
+json_arr( json_doubleStride, jsonm_doublefmt, jsonm_doubleprop, jsonm_writable, double )
+
+/* Add an array of strings in a JSON string. */
+JSON_API char* json_strStride( char* dest, char const* name, char const* const* values, size_t n, size_t stride, size_t* remLen ) {
+    STAT_BEGIN( JSON_STATS_ARRAY, dest );
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    dest = jsonm_openfrag( dest, &k, '[', remLen );
+    char const* src = (char const*)values;
+    for( ; 0 != n; --n, src += stride )
+        dest = jsonm_strprop( dest, &jsonm_nokey, *(char const* const*)src, (size_t)-1, escvalue, remLen );
+    STAT_RETURN( jsonm_closefrag( dest, ']', remLen ) );
+}
+
+/* The writer adds the comma before each value instead of after it, so it never
+   takes a byte back and the length that it counts after an overflow is exact. */
+
+/* Initialize a writer. */
+JSON_API void jsonw_init( jsonWriter_t* w, char* dest, size_t size ) {
+    w->start   = 0 == size ? NULL : dest;
+    w->dest    = w->start;
+    w->remLen  = NULL == w->start ? 0 : size - 1;
+    w->flushed = 0;
+    w->lost    = 0;
+    w->status  = NULL == dest ? JSON_MEASURE : 0;
+    w->comma   = 0;
+    w->depth   = 0;
+    w->sink    = NULL;
+    w->ctx     = NULL;
+}
+
+static size_t jsonm_prettyend( jsonWriter_t* w, size_t len );
+
+/* Finish the JSON under construction writing its null character. */
+JSON_API size_t jsonw_end( jsonWriter_t* w ) {
+    STAT( jsonm_statdepth = 0 );
+#ifndef NDEBUG
+    if ( 0 != w->depth )
+        w->status |= JSON_MISUSE;
+#endif
+    size_t const used = w->dest - w->start;
+    size_t const len = w->flushed + used;
+    if ( NULL == w->sink ) {
+        if ( NULL != w->dest )
+            *w->dest = '\0';
+    }
+    else if ( !( w->status & JSON_OVERFLOW ) && w->sink( w, 0 ) ) {
+        w->flushed += used;
+        w->start = w->dest;
+    }
+    else
+        w->status |= JSON_OVERFLOW;
+    return jsonm_prettyend( w, len );
+}
+
+/** Stop writing and count the length that did not fit.
+  * @param w The writer.
+  * @param len Length of the output that does not fit. */
+static void jsonm_woverflow( jsonWriter_t* w, size_t len ) {
+    STAT( ++jsonm_stats.truncations );
+    w->status |= JSON_OVERFLOW;
+    w->remLen = 0;
+    w->lost += len;
+}
+
+/** Finish a fragment written in a fast path.
+  * @param w The writer.
+  * @param end Pointer to the end of the fragment. */
+static void jsonm_wfastend( jsonWriter_t* w, char* end ) {
+    w->remLen -= end - w->dest;
+    w->dest = end;
+}
+
+/** Hand the current block to the sink to get a new one.
+  * @param w The writer.
+  * @param len Length of the output still to be written.
+  * @return Zero if there is no sink, it failed or after an overflow. */
+static int jsonm_wrefill( jsonWriter_t* w, size_t len ) {
+    if ( NULL == w->sink || ( w->status & JSON_OVERFLOW ) )
+        return 0;
+    size_t const used = w->dest - w->start;
+    if ( !w->sink( w, len ) )
+        return 0;
+    w->flushed += used;
+    return JSON_MINBLOCK <= w->remLen;
+}
+
+/** Add a memory block to the output. If it does not fit, it is split across
+  * the blocks of the sink or, without sink, it is only counted.
+  * @param w The writer.
+  * @param src Source memory block.
+  * @param len Length of the source. */
+static void jsonm_wput( jsonWriter_t* w, char const* src, size_t len ) {
+    while ( len > w->remLen ) {
+        if ( NULL == w->sink || ( w->status & JSON_OVERFLOW ) ) {
+            jsonm_woverflow( w, len );
+            return;
+        }
+        size_t const part = w->remLen;
+        if ( 0 != part )
+            memcpy( w->dest, src, part );
+        jsonm_wfastend( w, w->dest + part );
+        src += part;
+        len -= part;
+        if ( !jsonm_wrefill( w, len ) ) {
+            jsonm_woverflow( w, len );
+            return;
+        }
+    }
+    if ( 0 == len )
+        return;
+    memcpy( w->dest, src, len );
+    jsonm_wfastend( w, w->dest + len );
+}
+
+/** Add a string inserting escape characters. If it does not fit, it is
+  * split across the blocks of the sink or only counted.
+  * @param w The writer.
+  * @param src Source string.
+  * @param srclen Max length of source, (size_t)-1 for unlimit.
+  * @param flags Flags of the escape. See jsonm_esccpy(). Invalid UTF-8 with
+  *              jsonm_escstrict sets JSON_ERROR and ends the string. */
+static void jsonm_wesc( jsonWriter_t* w, char const* src, size_t srclen, int flags ) {
+    for( ;; ) {
+        if ( 0 != w->remLen )
+            w->dest = jsonm_esccpy( w->dest, &src, &srclen, flags, &w->remLen );
+        if ( 0 == srclen || ( !( flags & jsonm_escsized ) && '\0' == *src ) )
+            return;
+        if ( jsonm_escbad( src, srclen, flags ) ) {
+            w->status |= JSON_ERROR;
+            return;
+        }
+        if ( !jsonm_wrefill( w, srclen ) ) {
+            size_t const len = jsonm_esclen( src, srclen, flags );
+            if ( (size_t)-1 == len )
+                w->status |= JSON_ERROR;
+            else
+                jsonm_woverflow( w, len );
+            return;
+        }
+    }
+}
+
+/** Write the comma if needed and the name of a value. If they do not fit,
+  * they are split across the blocks of the sink or only counted.
+  * @param w The writer.
+  * @param k The name. */
+static void jsonm_wname( jsonWriter_t* w, jsonm_keyref_t const* k ) {
+    size_t const size = w->comma + k->size;
+    if ( size > w->remLen ) {
+        if ( NULL == w->sink ) {
+            jsonm_woverflow( w, size );
+            return;
+        }
+        jsonm_wput( w, ",", w->comma );
+        if ( NULL == k->text )
+            return;
+        STAT( jsonm_statname( k->size ) );
+        if ( !k->plain ) {
+            jsonm_wput( w, k->text, k->len );
+            return;
+        }
+        jsonm_wput( w, "\"", 1 );
+        jsonm_wesc( w, k->text, k->len, jsonm_escsized );
+        jsonm_wput( w, "\":", 2 );
+        return;
+    }
+    if ( 0 == size )
+        return;
+    char* p = w->dest;
+    *p = ',';
+    jsonm_wfastend( w, jsonm_keycpy( p + w->comma, k ) );
+}
+
+/** Write the comma if needed and the name of a value. The room is not checked.
+  * @param w The writer.
+  * @param k The name.
+  * @return Pointer to the next char. */
+static char* jsonm_wnamecpy( jsonWriter_t const* w, jsonm_keyref_t const* k ) {
+    char* p = w->dest;
+    *p = ',';
+    return jsonm_keycpy( p + w->comma, k );
+}
+
+/* Without NDEBUG the writer keeps a bit per nesting level to check the
+   structure of the JSON. With NDEBUG the checks are compiled out. */
+#ifdef NDEBUG
+#define jsonm_wcheck( w, named )
+#define jsonm_wpush( w, obj )
+#define jsonm_wpop( w, obj )
+#else
+
+/** Nesting depth up to which the structure is checked. */
+enum { jsonm_maxdepth = JSON_MAXDEPTH < JSON_NESTBITS ? JSON_MAXDEPTH : JSON_NESTBITS };
+
+/** Get the bit of a nesting level.
+  * @param w The writer.
+  * @param level Zero for the outermost object or array.
+  * @return One for an object. Zero for an array. */
+static int jsonm_wlevel( jsonWriter_t const* w, unsigned level ) {
+    return 1 & w->nest[ level / 8 ] >> level % 8;
+}
+
+/** Check that a value has a name inside an object and none elsewhere.
+  * @param w The writer.
+  * @param named One if the value has a name. */
+static void jsonm_wcheck( jsonWriter_t* w, int named ) {
+    if ( jsonm_maxdepth < w->depth )
+        return;
+    int const inobj = 0 != w->depth && jsonm_wlevel( w, w->depth - 1 );
+    if ( inobj != named )
+        w->status |= JSON_MISUSE;
+}
+
+/** Enter an object or an array.
+  * @param w The writer.
+  * @param obj One for an object. Zero for an array. */
+static void jsonm_wpush( jsonWriter_t* w, int obj ) {
+    if ( jsonm_maxdepth > w->depth ) {
+        /* The first level of each byte sets the whole byte, so no bit is
+           read before it is written. */
+        unsigned char* const byte = &w->nest[ w->depth / 8 ];
+        unsigned const shift = w->depth % 8;
+        unsigned const keep = 0 == shift ? 0 : *byte & ~( 1u << shift );
+        *byte = keep | (unsigned)obj << shift;
+    }
+    ++w->depth;
+}
+
+/** Leave an object or an array checking that it is the open one.
+  * @param w The writer.
+  * @param obj One for an object. Zero for an array. */
+static void jsonm_wpop( jsonWriter_t* w, int obj ) {
+    if ( 0 == w->depth ) {
+        w->status |= JSON_MISUSE;
+        return;
+    }
+    --w->depth;
+    if ( jsonm_maxdepth > w->depth && obj != jsonm_wlevel( w, w->depth ) )
+        w->status |= JSON_MISUSE;
+}
+
+#endif
+
+/** Open an object or an array.
+  * @param w The writer.
+  * @param k The name.
+  * @param ch The opening character. */
+static void jsonm_wopen( jsonWriter_t* w, jsonm_keyref_t const* k, char ch ) {
+    STAT_BEGIN( JSON_STATS_STRUCT, jsonm_statpos( w ) );
+    STAT( jsonm_statopen() );
+    jsonm_wcheck( w, NULL != k->text );
+    jsonm_wpush( w, '{' == ch );
+    if ( w->comma + k->size + 1 <= w->remLen ) {
+        char* p = jsonm_wnamecpy( w, k );
+        *p++ = ch;
+        jsonm_wfastend( w, p );
+    }
+    else {
+        jsonm_wname( w, k );
+        jsonm_wput( w, &ch, 1 );
+    }
+    w->comma = 0;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Open a JSON object. */
+JSON_API void jsonw_objOpen( jsonWriter_t* w, char const* name ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wopen( w, &k, '{' );
+}
+
+/* Open a JSON object. */
+JSON_API void jsonw_objOpen_k( jsonWriter_t* w, jsonKey_t const* key ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wopen( w, &k, '{' );
+}
+
+/* Close a JSON object. */
+JSON_API void jsonw_objClose( jsonWriter_t* w ) {
+    STAT_BEGIN( JSON_STATS_STRUCT, jsonm_statpos( w ) );
+    STAT( jsonm_statclose() );
+    jsonm_wpop( w, 1 );
+    jsonm_wput( w, "}", 1 );
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Open an array. */
+JSON_API void jsonw_arrOpen( jsonWriter_t* w, char const* name ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wopen( w, &k, '[' );
+}
+
+/* Open an array. */
+JSON_API void jsonw_arrOpen_k( jsonWriter_t* w, jsonKey_t const* key ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wopen( w, &k, '[' );
+}
+
+/* Close an array. */
+JSON_API void jsonw_arrClose( jsonWriter_t* w ) {
+    STAT_BEGIN( JSON_STATS_STRUCT, jsonm_statpos( w ) );
+    STAT( jsonm_statclose() );
+    jsonm_wpop( w, 0 );
+    jsonm_wput( w, "]", 1 );
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Defined with the arenas. */
+static int jsonm_wvector( jsonWriter_t const* w );
+static int jsonm_wref( jsonWriter_t* w, char const* value, size_t len );
+
+/** Add the text of a string value. In a vectored writer the runs of
+  * JSON_MINREF characters or more without escapes are referenced in place.
+  * @param w The writer.
+  * @param src Source string.
+  * @param srclen Max length of source, (size_t)-1 for unlimit.
+  * @param flags Flags of the escape. See jsonm_esccpy(). */
+static void jsonm_wvalue( jsonWriter_t* w, char const* src, size_t srclen, int flags ) {
+    if ( !jsonm_wvector( w ) ) {
+        jsonm_wesc( w, src, srclen, flags );
+        return;
+    }
+    srclen = jsonm_srcbound( src, srclen, srclen, flags );
+    for( ;; ) {
+        size_t const span = jsonm_cleanspan( src, srclen );
+        size_t special = 0;
+        if ( span != srclen && ( ( flags & jsonm_escsized ) || '\0' != src[ span ] ) ) {
+            char seq[ 12 ];
+            jsonm_escseq( seq, src + span, srclen - span, flags, &special );
+        }
+        if ( JSON_MINREF <= span && jsonm_wref( w, src, span ) )
+            jsonm_wesc( w, src + span, special, flags );
+        else
+            jsonm_wesc( w, src, span + special, flags );
+        if ( 0 == special || ( w->status & JSON_ERROR ) )
+            return;
+        src += span + special;
+        srclen -= span + special;
+    }
+}
+
+/** Add a text property.
+  * @param w The writer.
+  * @param k The name.
+  * @param value The value.
+  * @param len Max length of value, (size_t)-1 for unlimit.
+  * @param flags Flags of the escape. See jsonm_esccpy(). */
+static void jsonm_wstr( jsonWriter_t* w, jsonm_keyref_t const* k, char const* value, size_t len, int flags ) {
+    STAT_BEGIN( JSON_STATS_STRING, jsonm_statpos( w ) );
+    jsonm_wcheck( w, NULL != k->text );
+    if ( w->comma + k->size + 1 <= w->remLen ) {
+        char* p = jsonm_wnamecpy( w, k );
+        *p++ = '\"';
+        jsonm_wfastend( w, p );
+    }
+    else {
+        jsonm_wname( w, k );
+        jsonm_wput( w, "\"", 1 );
+    }
+    jsonm_wvalue( w, value, len, flags );
+    jsonm_wput( w, "\"", 1 );
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Add a text property. */
+JSON_API void jsonw_nstr( jsonWriter_t* w, char const* name, char const* value, int len ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wstr( w, &k, value, 0 > len ? (size_t)-1 : (size_t)len, escvalue );
+}
+
+/* Add a text property. */
+JSON_API void jsonw_nstr_k( jsonWriter_t* w, jsonKey_t const* key, char const* value, int len ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wstr( w, &k, value, 0 > len ? (size_t)-1 : (size_t)len, escvalue );
+}
+
+/* Add a text property with a known length. */
+JSON_API void jsonw_strLen( jsonWriter_t* w, char const* name, char const* value, size_t len ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wstr( w, &k, value, len, jsonm_escsized | escvalue );
+}
+
+/* Add a text property with a known length. */
+JSON_API void jsonw_strLen_k( jsonWriter_t* w, jsonKey_t const* key, char const* value, size_t len ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wstr( w, &k, value, len, jsonm_escsized | escvalue );
+}
+
+/** Add a primitive property whose text is known.
+  * @param w The writer.
+  * @param k The name.
+  * @param text The text of the value.
+  * @param len Length of the text. */
+static void jsonm_wprimitive( jsonWriter_t* w, jsonm_keyref_t const* k, char const* text, size_t len ) {
+    STAT_BEGIN( JSON_STATS_LITERAL, jsonm_statpos( w ) );
+    jsonm_wcheck( w, NULL != k->text );
+    if ( w->comma + k->size + len <= w->remLen ) {
+        char* p = jsonm_wnamecpy( w, k );
+        memcpy( p, text, len );
+        jsonm_wfastend( w, p + len );
+    }
+    else {
+        jsonm_wname( w, k );
+        jsonm_wput( w, text, len );
+    }
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Add a value that is already serialized. */
+JSON_API void jsonw_raw( jsonWriter_t* w, char const* name, char const* value, size_t len ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wprimitive( w, &k, value, len );
+}
+
+/* Add a value that is already serialized. */
+JSON_API void jsonw_raw_k( jsonWriter_t* w, jsonKey_t const* key, char const* value, size_t len ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wprimitive( w, &k, value, len );
+}
+
+/** Add a binary property encoded in a string. If it does not fit, it is
+  * encoded in chunks that are split across the blocks of the sink or only
+  * counted.
+  * @param w The writer.
+  * @param k The name.
+  * @param data The data.
+  * @param len Length of data.
+  * @param enc The encoding. */
+static void jsonm_wbin( jsonWriter_t* w, jsonm_keyref_t const* k, void const* data, size_t len, jsonm_binenc_t const* enc ) {
+    STAT_BEGIN( JSON_STATS_BINARY, jsonm_statpos( w ) );
+    jsonm_wcheck( w, NULL != k->text );
+    unsigned char const* src = data;
+    size_t const enclen = enc->len( len );
+    if ( w->comma + k->size + enclen + 2 <= w->remLen ) {
+        char* p = jsonm_wnamecpy( w, k );
+        *p++ = '\"';
+        p = enc->fmt( p, src, len );
+        *p++ = '\"';
+        jsonm_wfastend( w, p );
+    }
+    else {
+        jsonm_wname( w, k );
+        jsonm_wput( w, "\"", 1 );
+        if ( NULL == w->sink || ( w->status & JSON_OVERFLOW ) )
+            jsonm_woverflow( w, enclen );
+        else
+            for( ; 0 != len; ) {
+                size_t const n = len < jsonm_binchunk ? len : jsonm_binchunk;
+                char chunk[ 2 * jsonm_binchunk ];
+                jsonm_wput( w, chunk, enc->fmt( chunk, src, n ) - chunk );
+                src += n;
+                len -= n;
+            }
+        jsonm_wput( w, "\"", 1 );
+    }
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Add a binary property in base64. */
+JSON_API void jsonw_base64( jsonWriter_t* w, char const* name, void const* data, size_t len ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wbin( w, &k, data, len, &jsonm_base64 );
+}
+
+/* Add a binary property in base64. */
+JSON_API void jsonw_base64_k( jsonWriter_t* w, jsonKey_t const* key, void const* data, size_t len ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wbin( w, &k, data, len, &jsonm_base64 );
+}
+
+/* Add a binary property in hexadecimal. */
+JSON_API void jsonw_hex( jsonWriter_t* w, char const* name, void const* data, size_t len ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wbin( w, &k, data, len, &jsonm_hex );
+}
+
+/* Add a binary property in hexadecimal. */
+JSON_API void jsonw_hex_k( jsonWriter_t* w, jsonKey_t const* key, void const* data, size_t len ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wbin( w, &k, data, len, &jsonm_hex );
+}
+
+/* Add a boolean property. */
+JSON_API void jsonw_bool( jsonWriter_t* w, char const* name, int value ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    if ( value )
+        jsonm_wprimitive( w, &k, "true", 4 );
+    else
+        jsonm_wprimitive( w, &k, "false", 5 );
+}
+
+/* Add a boolean property. */
+JSON_API void jsonw_bool_k( jsonWriter_t* w, jsonKey_t const* key, int value ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    if ( value )
+        jsonm_wprimitive( w, &k, "true", 4 );
+    else
+        jsonm_wprimitive( w, &k, "false", 5 );
+}
+
+/* Add a null property. */
+JSON_API void jsonw_null( jsonWriter_t* w, char const* name ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wprimitive( w, &k, "null", 4 );
+}
+
+/* Add a null property. */
+JSON_API void jsonw_null_k( jsonWriter_t* w, jsonKey_t const* key ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    jsonm_wprimitive( w, &k, "null", 4 );
+}
+
+/* After an overflow, or in a writer that only measures, the length of the
+   number is got without writing it. */
+#define jsonw_num( func, fmt, lenfunc, type, family )                         \
+static void func( jsonWriter_t* w, jsonm_keyref_t const* k, type value ) {    \
+    STAT_BEGIN( family, jsonm_statpos( w ) );                                 \
+    jsonm_wcheck( w, NULL != k->text );                                       \
+    size_t const size = w->comma + k->size + jsonm_numbound;                  \
+    if ( size <= w->remLen )                                                  \
+        jsonm_wfastend( w, fmt( jsonm_wnamecpy( w, k ), value ) );            \
+    else if ( w->status & JSON_OVERFLOW )                                     \
+        jsonm_woverflow( w, size - jsonm_numbound + lenfunc( value ) );       \
+    else {                                                                    \
+        char buff[ jsonm_numbound ];                                          \
+        jsonm_wname( w, k );                                                  \
+        jsonm_wput( w, buff, fmt( buff, value ) - buff );                     \
+    }                                                                         \
+    w->comma = 1;                                                             \
+    STAT_END( jsonm_statpos( w ) );                                           \
+}
+
+#define jsonw_prop( func, prop, type )                                        \
+JSON_API void func( jsonWriter_t* w, char const* name, type value ) {         \
+    jsonm_keyref_t const k = jsonm_namekey( name );                           \
+    prop( w, &k, value );                                                     \
+}                                                                             \
+                                                                              \
+JSON_API void func##_k( jsonWriter_t* w, jsonKey_t const* key, type value ) { \
+    jsonm_keyref_t const k = jsonm_tokenkey( key );                           \
+    prop( w, &k, value );                                                     \
+}
+
+#define X( name, type, utype ) numlen( jsonm_##name##len, type, utype )
+ALL_TYPES
+#undef X
+
+#define X( name, type, utype ) jsonw_num( jsonm_w##name, jsonm_##name##fmt, jsonm_##name##len, type, JSON_STATS_INTEGER )
+ALL_TYPES
+#undef X
+
+#define X( name, type, utype ) jsonw_prop( jsonw_##name, jsonm_w##name, type )
+ALL_TYPES
+#undef X
+
+/** Get the length of the text of a double. */
+static size_t jsonm_doublelen( double val ) {
+    char buff[ jsonm_numbound ];
+    return jsonm_doublefmt( buff, val ) - buff;
+}
+
+jsonw_num( jsonm_wfinite, jsonm_doublefmt, jsonm_doublelen, double, JSON_STATS_REAL )
+
+/** Add a double precision number property.
+  * @param w The writer.
+  * @param k The name.
+  * @param value Value of the property. */
+static void jsonm_wdouble( jsonWriter_t* w, jsonm_keyref_t const* k, double value ) {
+#if JSON_NONFINITE == JSON_NONFINITE_ERROR
+    if ( value != value || value - value != 0 ) {
+        w->status |= JSON_ERROR;
+        return;
+    }
+#endif
+    jsonm_wfinite( w, k, value );
+}
+
+jsonw_prop( jsonw_double, jsonm_wdouble, double )
+
+/* The writer writes the arrays in blocks as json_arr does. */
+#define jsonw_arr( func, fmt, prop, ok, type )                               \
+JSON_API void func( jsonWriter_t* w, char const* name, type const* values, \
+                    size_t n, size_t stride ) {                              \
+    STAT_BEGIN( JSON_STATS_ARRAY, jsonm_statpos( w ) );                      \
+    jsonm_keyref_t const k = jsonm_namekey( name );                          \
+    jsonm_wopen( w, &k, '[' );                                               \
+    char const* src = (char const*)values;                                   \
+    while( 0 != n ) {                                                        \
+        size_t blk = w->remLen / ( jsonm_numbound + 1 );                     \
+        if ( blk > n )                                                       \
+            blk = n;                                                         \
+        char* p = w->dest;                                                   \
+        size_t i = 0;                                                        \
+        for( ; i < blk && ok( *(type const*)src ); ++i, src += stride ) {   \
+            *p = ',';                                                        \
+            p += w->comma;                                                   \
+            w->comma = 1;                                                    \
+            p = fmt( p, *(type const*)src );                                 \
+        }                                                                    \
+        if ( 0 != i )                                                        \
+            jsonm_wfastend( w, p );                                          \
+        n -= i;                                                              \
+        if ( i == blk && 0 != blk )                                          \
+            continue;                                                        \
+        if ( 0 == n )                                                        \
+            break;                                                           \
+        prop( w, &jsonm_nokey, *(type const*)src );                          \
+        src += stride;                                                       \
+        --n;                                                                 \
+    }                                                                        \
+    jsonw_arrClose( w );                                                     \
+    STAT_END( jsonm_statpos( w ) );                                          \
+}
+
+#define X( name, type, utype ) jsonw_arr( jsonw_##name##Stride, jsonm_##name##fmt, jsonm_w##name, anyvalue, type )
+ALL_TYPES
+#undef X
+
+jsonw_arr( jsonw_doubleStride, jsonm_doublefmt, jsonm_wdouble, jsonm_writable, double )
+
+/* Add an array of strings. */
+JSON_API void jsonw_strStride( jsonWriter_t* w, char const* name, char const* const* values, size_t n, size_t stride ) {
+    STAT_BEGIN( JSON_STATS_ARRAY, jsonm_statpos( w ) );
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wopen( w, &k, '[' );
+    char const* src = (char const*)values;
+    for( ; 0 != n; --n, src += stride )
+        jsonm_wstr( w, &jsonm_nokey, *(char const* const*)src, (size_t)-1, escvalue );
+    jsonw_arrClose( w );
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* The blocks of an arena grow with the JSON, so a long JSON takes a few
+   blocks and a short one does not waste memory. A block can also reference
+   memory of the caller instead of copying it: the references are stored at
+   the end of its data, from the last one down, and the output of the block
+   goes on after each of them. */
+
+/** Memory referenced from a position of the output of a block. */
+typedef struct jsonm_blockref_s {
+    char const* data;
+    size_t len;
+    size_t pos; /**< Position of the reference in the output of the block. */
+} jsonm_blockref_t;
+
+/** Get the end of the references of a block. The first one is just below. */
+static jsonm_blockref_t* jsonm_blockrefs( jsonBlock_t const* b ) {
+    return (jsonm_blockref_t*)json_blockData( b ) + b->size / sizeof( jsonm_blockref_t );
+}
+
+/* Initialize an empty arena. */
+JSON_API void json_arenaInit( jsonArena_t* a, size_t blockSize, jsonAlloc_t const* alloc ) {
+    a->head = NULL;
+    a->tail = NULL;
+    a->vector = 0;
+    a->blockSize = JSON_MINBLOCK > blockSize ? JSON_MINBLOCK : blockSize;
+    a->alloc = alloc;
+}
+
+/* Release the memory blocks of an arena. */
+JSON_API void json_arenaFree( jsonArena_t* a ) {
+    for( jsonBlock_t* b = a->head; NULL != b; ) {
+        jsonBlock_t* const next = b->next;
+        if ( NULL != a->alloc )
+            a->alloc->free( a->alloc->ctx, b );
+#ifndef JSON_NO_MALLOC
+        else
+            free( b );
+#endif
+        b = next;
+    }
+    a->head = NULL;
+    a->tail = NULL;
+}
+
+/** Get a new block for an arena.
+  * @param a The arena.
+  * @param size Size of the data of the block.
+  * @return The block or null if there is no memory. */
+static jsonBlock_t* jsonm_arenablock( jsonArena_t* a, size_t size ) {
+    jsonBlock_t* b = NULL;
+    if ( NULL != a->alloc )
+        b = a->alloc->alloc( a->alloc->ctx, sizeof *b + size );
+#ifndef JSON_NO_MALLOC
+    else
+        b = malloc( sizeof *b + size );
+#endif
+    if ( NULL == b )
+        return NULL;
+    b->next = NULL;
+    b->size = size;
+    b->refs = 0;
+    return b;
+}
+
+/** Sink of the writers on an arena. The next free block is reused if there is
+  * one. If not, a block as large as the output so far is appended. */
+static int jsonm_arenasink( jsonWriter_t* w, size_t len ) {
+    jsonArena_t* const a = w->ctx;
+    size_t const used = w->dest - w->start;
+    if ( NULL != a->tail )
+        a->tail->len = used;
+    if ( 0 == len )
+        return 1;
+    jsonBlock_t* next = NULL == a->tail ? a->head : a->tail->next;
+    if ( NULL == next ) {
+        size_t const total = w->flushed + used;
+        next = jsonm_arenablock( a, a->blockSize > total ? a->blockSize : total );
+        if ( NULL == next )
+            return 0;
+        if ( NULL == a->tail )
+            a->head = next;
+        else
+            a->tail->next = next;
+    }
+    a->tail = next;
+    next->len = 0;
+    next->refs = 0;
+    w->start = json_blockData( next );
+    w->dest = w->start;
+    w->remLen = next->size;
+    return 1;
+}
+
+/* Initialize a writer that writes in an arena. */
+JSON_API void jsonw_initArena( jsonWriter_t* w, jsonArena_t* a ) {
+    jsonw_init( w, NULL, 0 );
+    w->sink = jsonm_arenasink;
+    w->ctx = a;
+    a->vector = 0;
+    a->tail = a->head;
+    if ( NULL == a->head )
+        return;
+    a->head->len = 0;
+    a->head->refs = 0;
+    w->start = json_blockData( a->head );
+    w->dest = w->start;
+    w->remLen = a->head->size;
+}
+
+/** Walk the pieces of the JSON of an arena in order: the output of its
+  * blocks and the memory that they reference.
+  * @param a The arena.
+  * @param piece Function called with each piece that is not empty.
+  * @param ctx First argument of piece. */
+static void jsonm_arenawalk( jsonArena_t const* a, void (*piece)( void* ctx, char const* data, size_t len ), void* ctx ) {
+    for( jsonBlock_t const* b = a->head; NULL != a->tail; b = b->next ) {
+        char const* const data = json_blockData( b );
+        jsonm_blockref_t const* ref = jsonm_blockrefs( b );
+        size_t pos = 0;
+        for( size_t i = 0; i < b->refs; ++i ) {
+            --ref;
+            if ( pos != ref->pos )
+                piece( ctx, data + pos, ref->pos - pos );
+            piece( ctx, ref->data, ref->len );
+            pos = ref->pos;
+        }
+        if ( pos != b->len )
+            piece( ctx, data + pos, b->len - pos );
+        if ( b == a->tail )
+            break;
+    }
+}
+
+/** Add the length of a piece of an arena. */
+static void jsonm_piecelen( void* ctx, char const* data, size_t len ) {
+    (void)data;
+    *(size_t*)ctx += len;
+}
+
+/* Get the length of the JSON in an arena. */
+JSON_API size_t json_arenaLen( jsonArena_t const* a ) {
+    size_t len = 0;
+    jsonm_arenawalk( a, jsonm_piecelen, &len );
+    return len;
+}
+
+/** Copy a piece of a JSON at its position in a string. What does not fit in
+  * the string, with room for the null character, is not copied.
+  * @param dest The string.
+  * @param size Size of dest.
+  * @param pos Position of the piece.
+  * @param src The piece.
+  * @param len Length of the piece.
+  * @return The position after the piece. */
+static size_t jsonm_flatcpy( char* dest, size_t size, size_t pos, void const* src, size_t len ) {
+    if ( pos < size ) {
+        size_t const rem = size - 1 - pos;
+        memcpy( dest + pos, src, rem < len ? rem : len );
+    }
+    return pos + len;
+}
+
+/** A string that the pieces of an arena are copied in. */
+struct jsonm_flat {
+    char* dest;
+    size_t size;
+    size_t pos;
+};
+
+/** Copy a piece of an arena in a string. */
+static void jsonm_piececpy( void* ctx, char const* data, size_t len ) {
+    struct jsonm_flat* const f = ctx;
+    f->pos = jsonm_flatcpy( f->dest, f->size, f->pos, data, len );
+}
+
+/** Copy the JSON of an arena at its position in a string.
+  * @return The position after the JSON. */
+static size_t jsonm_arenacpy( jsonArena_t const* a, char* dest, size_t size, size_t pos ) {
+    struct jsonm_flat f = { dest, size, pos };
+    jsonm_arenawalk( a, jsonm_piececpy, &f );
+    return f.pos;
+}
+
+/** Finish a string copied by pieces with its null character.
+  * @return The length of the JSON. */
+static size_t jsonm_flatend( char* dest, size_t size, size_t len ) {
+    if ( 0 != size )
+        dest[ len < size ? len : size - 1 ] = '\0';
+    return len;
+}
+
+/* Copy the JSON of an arena in a null-terminated string. */
+JSON_API size_t json_arenaFlatten( jsonArena_t const* a, char* dest, size_t size ) {
+    return jsonm_flatend( dest, size, jsonm_arenacpy( a, dest, size, 0 ) );
+}
+
+/** An array of iovec that the pieces of an arena are set in. */
+struct jsonm_vec {
+    jsonIovec_t* iov;
+    int max;
+    int count;
+};
+
+/** Set an iovec if it is in the array.
+  * @return The number of iovec after it. */
+static int jsonm_joinvec( jsonIovec_t* iov, int max, int count, char const* data, size_t len ) {
+    if ( count < max ) {
+        iov[ count ].iov_base = (void*)data;
+        iov[ count ].iov_len = len;
+    }
+    return count + 1;
+}
+
+/** Set a piece of an arena in an array of iovec. */
+static void jsonm_piecevec( void* ctx, char const* data, size_t len ) {
+    struct jsonm_vec* const v = ctx;
+    v->count = jsonm_joinvec( v->iov, v->max, v->count, data, len );
+}
+
+/** Set the pieces of the JSON of an arena in an array of iovec.
+  * @return The number of iovec after them. */
+static int jsonm_arenavec( jsonArena_t const* a, jsonIovec_t* iov, int max, int count ) {
+    struct jsonm_vec v = { iov, max, count };
+    jsonm_arenawalk( a, jsonm_piecevec, &v );
+    return v.count;
+}
+
+/* Fill an array of iovec with the blocks of the JSON of an arena. */
+JSON_API int json_arenaIovec( jsonArena_t const* a, jsonIovec_t* iov, int max ) {
+    return jsonm_arenavec( a, iov, max, 0 );
+}
+
+/** Add a reference to memory in the current block of a writer on an arena.
+  * @param w The writer.
+  * @param value The memory.
+  * @param len Length of the memory.
+  * @return Zero if there is no room for the reference in the block. */
+static int jsonm_arenaref( jsonWriter_t* w, char const* value, size_t len ) {
+    jsonArena_t const* const a = w->ctx;
+    jsonBlock_t* const b = a->tail;
+    if ( NULL == b )
+        return 0;
+    size_t const used = w->dest - w->start;
+    size_t const slots = b->size / sizeof( jsonm_blockref_t );
+    if ( slots <= b->refs || ( slots - b->refs - 1 ) * sizeof( jsonm_blockref_t ) < used )
+        return 0;
+    jsonm_blockref_t* const ref = jsonm_blockrefs( b ) - b->refs - 1;
+    ref->data = value;
+    ref->len = len;
+    ref->pos = used;
+    ++b->refs;
+    w->remLen = (char*)ref - w->dest;
+    w->flushed += len;
+    return 1;
+}
+
+/** Reference memory in a writer on an arena instead of copying it.
+  * @param w The writer.
+  * @param value The memory.
+  * @param len Length of the memory.
+  * @return Zero if it is not referenced. */
+static int jsonm_wref( jsonWriter_t* w, char const* value, size_t len ) {
+    if ( w->status & JSON_OVERFLOW )
+        return 0;
+    return jsonm_arenaref( w, value, len ) || ( jsonm_wrefill( w, len ) && jsonm_arenaref( w, value, len ) );
+}
+
+/** Check if a writer references the long strings. */
+static int jsonm_wvector( jsonWriter_t const* w ) {
+    return jsonm_arenasink == w->sink && ( (jsonArena_t const*)w->ctx )->vector;
+}
+
+/* Add a value that is already serialized, referencing it in an arena. */
+JSON_API void jsonw_rawRef( jsonWriter_t* w, char const* name, char const* value, size_t len ) {
+    if ( jsonm_arenasink != w->sink || JSON_MINREF > len || ( w->status & JSON_OVERFLOW ) ) {
+        jsonw_raw( w, name, value, len );
+        return;
+    }
+    STAT_BEGIN( JSON_STATS_LITERAL, jsonm_statpos( w ) );
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wcheck( w, NULL != k.text );
+    jsonm_wname( w, &k );
+    if ( !jsonm_wref( w, value, len ) )
+        jsonm_wput( w, value, len );
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+}
+
+/* Initialize a writer that references the long strings in an arena. */
+JSON_API void jsonw_initIovec( jsonWriter_t* w, jsonArena_t* a ) {
+    jsonw_initArena( w, a );
+    a->vector = 1;
+}
+
+/* A part is written in an array that is open from the start, so the writer
+   checks that its elements have no names and that it is balanced. */
+
+/* Initialize a writer that writes a part of an array in an arena. */
+JSON_API void jsonw_initPart( jsonWriter_t* w, jsonArena_t* a ) {
+    jsonw_initArena( w, a );
+    jsonm_wpush( w, 0 );
+}
+
+/* Finish a part of an array. */
+JSON_API size_t jsonw_endPart( jsonWriter_t* w ) {
+    jsonm_wpop( w, 0 );
+    return jsonw_end( w );
+}
+
+/** The brackets and the commas of the joined parts. */
+static char const jsonm_joinchars[] = "[,]";
+
+/* Get the length of the array of the parts. */
+JSON_API size_t json_joinLen( jsonArena_t const* parts, size_t n ) {
+    size_t len = 2;
+    int comma = 0;
+    for( size_t i = 0; i < n; ++i ) {
+        size_t const partlen = json_arenaLen( &parts[ i ] );
+        if ( 0 == partlen )
+            continue;
+        len += comma + partlen;
+        comma = 1;
+    }
+    return len;
+}
+
+/* Copy the array of the parts in a null-terminated string. */
+JSON_API size_t json_joinFlatten( jsonArena_t const* parts, size_t n, char* dest, size_t size ) {
+    size_t pos = jsonm_flatcpy( dest, size, 0, jsonm_joinchars, 1 );
+    int comma = 0;
+    for( size_t i = 0; i < n; ++i ) {
+        if ( 0 == json_arenaLen( &parts[ i ] ) )
+            continue;
+        pos = jsonm_flatcpy( dest, size, pos, jsonm_joinchars + 1, comma );
+        pos = jsonm_arenacpy( &parts[ i ], dest, size, pos );
+        comma = 1;
+    }
+    pos = jsonm_flatcpy( dest, size, pos, jsonm_joinchars + 2, 1 );
+    return jsonm_flatend( dest, size, pos );
+}
+
+/* Fill an array of iovec with the array of the parts. */
+JSON_API int json_joinIovec( jsonArena_t const* parts, size_t n, jsonIovec_t* iov, int max ) {
+    int count = jsonm_joinvec( iov, max, 0, jsonm_joinchars, 1 );
+    int comma = 0;
+    for( size_t i = 0; i < n; ++i ) {
+        if ( 0 == json_arenaLen( &parts[ i ] ) )
+            continue;
+        if ( comma )
+            count = jsonm_joinvec( iov, max, count, jsonm_joinchars + 1, 1 );
+        count = jsonm_arenavec( &parts[ i ], iov, max, count );
+        comma = 1;
+    }
+    return jsonm_joinvec( iov, max, count, jsonm_joinchars + 2, 1 );
+}
+
+/* A fragment is a JSON value written once in a buffer of the caller and
+   spliced as it is until the caller changes the epoch or marks it dirty. */
+
+/* Initialize an empty fragment. */
+JSON_API void json_fragmentInit( jsonFragment_t* f, char* buff, size_t size ) {
+    f->buff = buff;
+    f->size = size;
+    f->len = 0;
+    f->epoch = 0;
+}
+
+/* Initialize a writer that writes the value of a fragment. */
+JSON_API void jsonw_initFragment( jsonWriter_t* w, jsonFragment_t* f ) {
+    f->len = 0;
+    jsonw_init( w, f->buff, f->size );
+}
+
+/* Finish the value of a fragment. */
+JSON_API int json_fragmentEnd( jsonFragment_t* f, jsonWriter_t* w, unsigned long epoch ) {
+    size_t const len = jsonw_end( w );
+    if ( 0 != jsonw_status( w ) || 0 == len )
+        return 0;
+    f->len = len;
+    f->epoch = epoch;
+    return 1;
+}
+
+/* Add the value of a fragment in a JSON string. */
+JSON_API char* json_fragment( char* dest, char const* name, jsonFragment_t const* f, size_t* remLen ) {
+    if ( 0 == f->len ) {
+        *remLen = 0;
+        *dest = '\0';
+        return dest;
+    }
+    return json_raw( dest, name, f->buff, f->len, remLen );
+}
+
+/* Add the value of a fragment. */
+JSON_API void jsonw_fragment( jsonWriter_t* w, char const* name, jsonFragment_t const* f ) {
+    if ( 0 == f->len )
+        w->status |= JSON_ERROR;
+    else
+        jsonw_rawRef( w, name, f->buff, f->len );
+}
+
+/* A fixed-width number takes the same room whatever its value, so it is
+   rewritten in place without moving the rest of the JSON. */
+
+/** Write the text of a number right-aligned in a fixed width, padded with
+  * spaces on the left.
+  * @param dest Destination memory block with room for width characters.
+  * @param width The width.
+  * @param text The text of the number.
+  * @param len Length of text.
+  * @return Zero if the text does not fit. Then dest is not written. */
+static int jsonm_padfmt( char* dest, size_t width, char const* text, size_t len ) {
+    if ( len > width )
+        return 0;
+    memset( dest, ' ', width - len );
+    memcpy( dest + width - len, text, len );
+    return 1;
+}
+
+/** Powers of five of the decimals of the fixed-width reals. */
+static uint32_t const jsonm_decimalfives[ JSON_FIXED_MAXDECIMALS + 1 ] = {
+    1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125
+};
+
+/** Round the magnitude of a finite double times a power of ten to an integer,
+  * half away from zero. The product is exact: the significand times the power
+  * of five takes 74 bits at most, in two halves, and the power of two is a
+  * shift. In doubles 0.49999999999999994 + 0.5 rounds up to 1 and 2.675 * 100
+  * is only near the product.
+  * @param val The value. Finite.
+  * @param decimals Power of ten, up to JSON_FIXED_MAXDECIMALS.
+  * @param num Set with the rounded magnitude.
+  * @return Zero if the magnitude does not fit in a long long. */
+static int jsonm_decimalround( double val, int decimals, unsigned long long* num ) {
+    uint64_t bits;
+    memcpy( &bits, &val, sizeof bits );
+    struct jsonm_diyfp const v = jsonm_todiyfp( bits & ~( (uint64_t)1 << 63 ) );
+    uint64_t const five = jsonm_decimalfives[ decimals ];
+    uint64_t const low = ( v.f & 0xFFFFFFFFu ) * five;
+    uint64_t const mid = ( v.f >> 32 ) * five;
+    uint64_t lo = low + ( mid << 32 );
+    uint64_t hi = ( mid >> 32 ) + ( lo < low );
+    int const e = v.e + decimals;
+    if ( 0 <= e ) {
+        if ( 0 != hi || 63 <= e || 0 != lo >> ( 63 - e ) )
+            return 0;
+        *num = lo << e;
+        return 1;
+    }
+    /* Keep one bit after the point: it is the rounding bit. */
+    int const shift = -e - 1;
+    if ( 128 <= shift )
+        lo = hi = 0;
+    else if ( 64 <= shift ) {
+        lo = hi >> ( shift - 64 );
+        hi = 0;
+    }
+    else if ( 0 < shift ) {
+        lo = lo >> shift | hi << ( 64 - shift );
+        hi >>= shift;
+    }
+    uint64_t const rounded = ( lo >> 1 ) + ( lo & 1 );
+    if ( 0 != hi || 0 != rounded >> 63 )
+        return 0;
+    *num = rounded;
+    return 1;
+}
+
+/** Write a double with a fixed number of decimals, rounded half away from
+  * zero from its exact value, so only the ties of the binary value are
+  * rounded up. NaN and infinities are written as JSON_NONFINITE selects.
+  * The room is not checked.
+  * @param dest Destination memory block with room for jsonm_numbound characters.
+  * @param val The value.
+  * @param decimals Digits after the point, up to JSON_FIXED_MAXDECIMALS.
+  * @return Pointer to the character after the number or null if the scaled
+  *         value does not fit in a long long, or it is not finite with
+  *         JSON_NONFINITE_ERROR. */
+static char* jsonm_decimalfmt( char* dest, double val, int decimals ) {
+    if ( val != val || val - val != 0 ) {
+#if JSON_NONFINITE == JSON_NONFINITE_ERROR
+        return NULL;
+#else
+        return jsonm_doublefmt( dest, val );
+#endif
+    }
+    unsigned long long mag;
+    if ( !jsonm_decimalround( val, decimals, &mag ) )
+        return NULL;
+    int const negative = 0 > val && 0 != mag;
+    char buff[ jsonm_numbound ];
+    char* p = buff + sizeof buff;
+    for( int i = 0; i < decimals; ++i, mag /= 10 )
+        *--p = '0' + mag % 10;
+    if ( 0 < decimals )
+        *--p = '.';
+    do
+        *--p = '0' + mag % 10;
+    while( 0 != ( mag /= 10 ) );
+    if ( negative )
+        *--p = '-';
+    size_t const len = buff + sizeof buff - p;
+    memcpy( dest, p, len );
+    return dest + len;
+}
+
+/** Add a number of a fixed width and set its handle.
+  * @param w The writer.
+  * @param k The name.
+  * @param text The text of the number.
+  * @param len Length of text. Zero if it could not be formatted.
+  * @param width The width.
+  * @param decimals The decimals of a real or -1.
+  * @param f The handle.
+  * @return Zero and JSON_ERROR if the text does not fit in the width. */
+static int jsonm_wfixed( jsonWriter_t* w, jsonm_keyref_t const* k, char const* text, size_t len, unsigned width, int decimals, jsonFixed_t* f ) {
+    char buff[ jsonm_numbound ];
+    if ( 0 == len || jsonm_numbound < width || !jsonm_padfmt( buff, width, text, len ) ) {
+        w->status |= JSON_ERROR;
+        return 0;
+    }
+    STAT_BEGIN( 0 > decimals ? JSON_STATS_INTEGER : JSON_STATS_REAL, jsonm_statpos( w ) );
+    jsonm_wcheck( w, NULL != k->text );
+    jsonm_wname( w, k );
+    f->offset = w->flushed + ( w->dest - w->start ) + w->lost;
+    f->width = width;
+    f->decimals = decimals;
+    jsonm_wput( w, buff, width );
+    w->comma = 1;
+    STAT_END( jsonm_statpos( w ) );
+    return 1;
+}
+
+/** Add an integer of a fixed width.
+  * @param w The writer.
+  * @param k The name.
+  * @param value The value.
+  * @param width The width.
+  * @param f The handle.
+  * @return Zero and JSON_ERROR if it does not fit. */
+static int jsonm_wfixedint( jsonWriter_t* w, jsonm_keyref_t const* k, long long value, unsigned width, jsonFixed_t* f ) {
+    char buff[ jsonm_numbound ];
+    return jsonm_wfixed( w, k, buff, jsonm_verylongfmt( buff, value ) - buff, width, -1, f );
+}
+
+/** Add a real of a fixed width.
+  * @param w The writer.
+  * @param k The name.
+  * @param value The value.
+  * @param width The width.
+  * @param decimals The decimals.
+  * @param f The handle.
+  * @return Zero and JSON_ERROR if the decimals are wrong or it does not fit. */
+static int jsonm_wfixeddouble( jsonWriter_t* w, jsonm_keyref_t const* k, double value, unsigned width, int decimals, jsonFixed_t* f ) {
+    char buff[ jsonm_numbound ];
+    char const* end = NULL;
+    if ( 0 <= decimals && JSON_FIXED_MAXDECIMALS >= decimals )
+        end = jsonm_decimalfmt( buff, value, decimals );
+    return jsonm_wfixed( w, k, buff, NULL != end ? end - buff : 0, width, decimals, f );
+}
+
+/* Add an integer of a fixed width. */
+JSON_API int jsonw_fixedInt( jsonWriter_t* w, char const* name, long long value, unsigned width, jsonFixed_t* f ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_wfixedint( w, &k, value, width, f );
+}
+
+/* Add a real of a fixed width. */
+JSON_API int jsonw_fixedDouble( jsonWriter_t* w, char const* name, double value, unsigned width, int decimals, jsonFixed_t* f ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    return jsonm_wfixeddouble( w, &k, value, width, decimals, f );
+}
+
+/* Add an integer of a fixed width with a key. */
+JSON_API int jsonw_fixedInt_k( jsonWriter_t* w, jsonKey_t const* key, long long value, unsigned width, jsonFixed_t* f ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_wfixedint( w, &k, value, width, f );
+}
+
+/* Add a real of a fixed width with a key. */
+JSON_API int jsonw_fixedDouble_k( jsonWriter_t* w, jsonKey_t const* key, double value, unsigned width, int decimals, jsonFixed_t* f ) {
+    jsonm_keyref_t const k = jsonm_tokenkey( key );
+    return jsonm_wfixeddouble( w, &k, value, width, decimals, f );
+}
+
+/* Rewrite a fixed-width number with an integer. */
+JSON_API int json_patchInt( char* json, jsonFixed_t const* f, long long value ) {
+    if ( 0 < f->decimals )
+        return json_patchDouble( json, f, (double)value );
+    char buff[ jsonm_numbound ];
+    return jsonm_padfmt( json + f->offset, f->width, buff, jsonm_verylongfmt( buff, value ) - buff );
+}
+
+/* Rewrite a fixed-width number with a real. */
+JSON_API int json_patchDouble( char* json, jsonFixed_t const* f, double value ) {
+    char buff[ jsonm_numbound ];
+    char const* const end = jsonm_decimalfmt( buff, value, 0 < f->decimals ? f->decimals : 0 );
+    return NULL != end && jsonm_padfmt( json + f->offset, f->width, buff, end - buff );
+}
+
+/* A template is a JSON written once with slots in place of some values. The
+   text between the slots is copied as it is and only the values are
+   formatted. The fixed slots keep their value in the text itself. */
+
+/* Initialize an empty template. */
+JSON_API void json_templateInit( jsonTemplate_t* t, char* text, size_t size, jsonSlot_t* slots, int max ) {
+    t->text = text;
+    t->size = size;
+    t->len = 0;
+    t->slots = slots;
+    t->max = max;
+    t->count = 0;
+}
+
+/* Initialize a writer that writes the text of a template. */
+JSON_API void jsonw_initTemplate( jsonWriter_t* w, jsonTemplate_t* t ) {
+    t->len = 0;
+    t->count = 0;
+    jsonw_init( w, t->text, t->size );
+}
+
+/** Add a slot to a template under construction.
+  * @param w The writer initialized with jsonw_initTemplate().
+  * @param t The template.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param type The type of the slot.
+  * @param width The width of a fixed slot, up to jsonm_numbound, or zero.
+  * @return The index of the slot or -1 if the slots are exhausted. */
+static int jsonm_tplslot( jsonWriter_t* w, jsonTemplate_t* t, char const* name, int type, size_t width ) {
+    if ( t->count == t->max ) {
+        w->status |= JSON_ERROR;
+        return -1;
+    }
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wcheck( w, NULL != k.text );
+    jsonm_wname( w, &k );
+    jsonSlot_t* const s = &t->slots[ t->count ];
+    s->offset = w->dest - t->text;
+    s->width = width;
+    s->type = type;
+    static char const zero[ jsonm_numbound + 1 ] = "                               0";
+    jsonm_wput( w, zero + jsonm_numbound - width, width );
+    w->comma = 1;
+    return t->count++;
+}
+
+/* Add a slot that takes a value each time the template is written. */
+JSON_API int jsonw_slot( jsonWriter_t* w, jsonTemplate_t* t, char const* name, int type ) {
+    if ( JSON_SLOT_INT > type || JSON_SLOT_STR < type ) {
+        w->status |= JSON_ERROR;
+        return -1;
+    }
+    return jsonm_tplslot( w, t, name, type, 0 );
+}
+
+/* Add a slot with an integer of a fixed width that is patched in place. */
+JSON_API int jsonw_fixedSlot( jsonWriter_t* w, jsonTemplate_t* t, char const* name, unsigned width ) {
+    if ( 0 == width || jsonm_numbound < width ) {
+        w->status |= JSON_ERROR;
+        return -1;
+    }
+    return jsonm_tplslot( w, t, name, JSON_SLOT_FIXED, width );
+}
+
+/* Finish the text of a template. */
+JSON_API int json_templateEnd( jsonTemplate_t* t, jsonWriter_t* w ) {
+    size_t const len = jsonw_end( w );
+    if ( 0 != jsonw_status( w ) || 0 == len )
+        return 0;
+    t->len = len;
+    return 1;
+}
+
+/* Write the integer of a fixed slot in the text of a template. */
+JSON_API int json_templatePatch( jsonTemplate_t* t, int slot, long long value ) {
+    if ( 0 > slot || t->count <= slot || JSON_SLOT_FIXED != t->slots[ slot ].type )
+        return 0;
+    char buff[ jsonm_numbound ];
+    jsonSlot_t const* const s = &t->slots[ slot ];
+    return jsonm_padfmt( t->text + s->offset, s->width, buff, jsonm_verylongfmt( buff, value ) - buff );
+}
+
+/** Write the value of a slot that is not a string. The room is not checked.
+  * @param dest Destination memory block with room for jsonm_numbound characters.
+  * @param s The slot.
+  * @param v The value.
+  * @return Pointer to the character after the value. */
+static char* jsonm_slotfmt( char* dest, jsonSlot_t const* s, jsonValue_t const* v ) {
+    switch( s->type ) {
+        case JSON_SLOT_INT:  return jsonm_verylongfmt( dest, v->integer );
+        case JSON_SLOT_BOOL: return json_boolFmt( dest, v->boolean );
+        default:             return jsonm_doublefmt( dest, v->real );
+    }
+}
+
+/** Add the value of a slot of a template.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param s The slot.
+  * @param v The value.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+static char* jsonm_slottoa( char* dest, jsonSlot_t const* s, jsonValue_t const* v, size_t* remLen ) {
+    if ( JSON_SLOT_STR == s->type ) {
+        dest = jsonm_chtoa( dest, '\"', remLen );
+        dest = jsonm_atoesc( dest, v->str, (size_t)-1, escvalue, remLen );
+        return jsonm_chtoa( dest, '\"', remLen );
+    }
+    if ( JSON_SLOT_DOUBLE == s->type && !jsonm_writable( v->real ) ) {
+        *remLen = 0;
+        *dest = '\0';
+        return dest;
+    }
+    if ( jsonm_numbound <= *remLen )
+        return jsonm_fastend( dest, jsonm_slotfmt( dest, s, v ), remLen );
+    char buff[ jsonm_numbound ];
+    return jsonm_memtoa( dest, buff, jsonm_slotfmt( buff, s, v ) - buff, remLen );
+}
+
+/* Add a template with the values of its slots in a JSON string. */
+JSON_API char* json_template( char* dest, char const* name, jsonTemplate_t const* t, jsonValue_t const* values, size_t* remLen ) {
+    if ( 0 == t->len ) {
+        *remLen = 0;
+        *dest = '\0';
+        return dest;
+    }
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    dest = jsonm_keytoa( dest, &k, remLen );
+    size_t done = 0;
+    for( int i = 0; i < t->count && 0 != *remLen; ++i ) {
+        jsonSlot_t const* const s = &t->slots[ i ];
+        if ( JSON_SLOT_FIXED == s->type )
+            continue;
+        dest = jsonm_memtoa( dest, t->text + done, s->offset - done, remLen );
+        dest = jsonm_slottoa( dest, s, &values[ i ], remLen );
+        done = s->offset;
+    }
+    dest = jsonm_memtoa( dest, t->text + done, t->len - done, remLen );
+    return jsonm_chtoa( dest, ',', remLen );
+}
+
+/** Add the value of a slot of a template.
+  * @param w The writer.
+  * @param s The slot.
+  * @param v The value. */
+static void jsonm_wslot( jsonWriter_t* w, jsonSlot_t const* s, jsonValue_t const* v ) {
+    if ( JSON_SLOT_STR == s->type ) {
+        jsonm_wput( w, "\"", 1 );
+        jsonm_wvalue( w, v->str, (size_t)-1, escvalue );
+        jsonm_wput( w, "\"", 1 );
+    }
+    else if ( JSON_SLOT_DOUBLE == s->type && !jsonm_writable( v->real ) )
+        w->status |= JSON_ERROR;
+    else if ( jsonm_numbound <= w->remLen )
+        jsonm_wfastend( w, jsonm_slotfmt( w->dest, s, v ) );
+    else {
+        char buff[ jsonm_numbound ];
+        jsonm_wput( w, buff, jsonm_slotfmt( buff, s, v ) - buff );
+    }
+}
+
+/* Add a template with the values of its slots. */
+JSON_API void jsonw_template( jsonWriter_t* w, char const* name, jsonTemplate_t const* t, jsonValue_t const* values ) {
+    if ( 0 == t->len ) {
+        w->status |= JSON_ERROR;
+        return;
+    }
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    jsonm_wcheck( w, NULL != k.text );
+    jsonm_wname( w, &k );
+    size_t done = 0;
+    for( int i = 0; i < t->count; ++i ) {
+        jsonSlot_t const* const s = &t->slots[ i ];
+        if ( JSON_SLOT_FIXED == s->type )
+            continue;
+        jsonm_wput( w, t->text + done, s->offset - done );
+        jsonm_wslot( w, s, &values[ i ] );
+        done = s->offset;
+    }
+    jsonm_wput( w, t->text + done, t->len - done );
+    w->comma = 1;
+}
+
+/** Sink of the writers on a stream. The block is flushed and written again. */
+static int jsonm_streamsink( jsonWriter_t* w, size_t len ) {
+    jsonStream_t const* const s = w->ctx;
+    size_t const used = w->dest - w->start;
+    if ( 0 != used && !s->flush( s->ctx, w->start, used ) )
+        return 0;
+    w->dest = w->start;
+    w->remLen = 0 == len ? 0 : s->size;
+    return 1;
+}
+
+/* Initialize a writer that writes in a stream. */
+JSON_API void jsonw_initStream( jsonWriter_t* w, jsonStream_t* s, char* buff, size_t size, jsonFlush_t flush, void* ctx ) {
+    s->flush = flush;
+    s->ctx = ctx;
+    s->buff = buff;
+    s->size = JSON_MINBLOCK > size ? 0 : size;
+    jsonw_init( w, NULL, 0 );
+    w->sink = jsonm_streamsink;
+    w->ctx = s;
+    w->start = buff;
+    w->dest = buff;
+    w->remLen = s->size;
+}
+
+/* The reformatter copies the strings in spans found by the same scanner as
+   the escapes and drops or adds the white space between the tokens. Its
+   state is kept between chunks, so the JSON can be given in any pieces. */
+
+/** Classes of the characters out of the strings for the reformatter. */
+enum { jsonm_fmtscalar, jsonm_fmtspace, jsonm_fmtquote, jsonm_fmtopen, jsonm_fmtclose, jsonm_fmtcomma, jsonm_fmtcolon };
+
+/** Class of each character out of the strings. */
+static unsigned char const jsonm_fmttab[ 256 ] = {
+    [' '] = jsonm_fmtspace, ['\t'] = jsonm_fmtspace, ['\n'] = jsonm_fmtspace, ['\r'] = jsonm_fmtspace,
+    ['\"'] = jsonm_fmtquote, ['{'] = jsonm_fmtopen, ['['] = jsonm_fmtopen, ['}'] = jsonm_fmtclose,
+    [']'] = jsonm_fmtclose, [','] = jsonm_fmtcomma, [':'] = jsonm_fmtcolon
+};
+
+/** Flags of the state of a reformatter. */
+enum {
+    jsonm_fmtstring = 1, /**< In a string. */
+    jsonm_fmtescape = 2, /**< In a string after a backslash. */
+    jsonm_fmtbreak  = 4  /**< After an opening bracket. A line break is due unless
+                              the object or the array is empty. */
+};
+
+/* Initialize a reformatter. */
+JSON_API void json_formatInit( jsonFormat_t* f, unsigned indent, char const* newline ) {
+    f->newline = newline;
+    f->nl = NULL == newline ? 0 : strlen( newline );
+    f->indent = indent;
+    f->depth = 0;
+    f->state = 0;
+}
+
+/** Add a character. If it does not fit, it goes to the sink or is counted.
+  * @param w The writer.
+  * @param ch The character. */
+static void jsonm_wchar( jsonWriter_t* w, char ch ) {
+    if ( 0 != w->remLen ) {
+        *w->dest++ = ch;
+        --w->remLen;
+    }
+    else
+        jsonm_wput( w, &ch, 1 );
+}
+
+/** Write a line break and the indentation of the current depth.
+  * @param w The writer.
+  * @param f The reformatter. Nothing is written if it minifies. */
+static void jsonm_wbreak( jsonWriter_t* w, jsonFormat_t const* f ) {
+    size_t const nl = f->nl;
+    if ( 0 == nl )
+        return;
+    size_t const n = (size_t)f->depth * f->indent;
+    if ( nl + n <= w->remLen ) {
+        memcpy( w->dest, f->newline, nl );
+        memset( w->dest + nl, ' ', n );
+        jsonm_wfastend( w, w->dest + nl + n );
+        return;
+    }
+    static char const spaces[] = "                                                                ";
+    jsonm_wput( w, f->newline, nl );
+    for( size_t rest = n; 0 != rest; ) {
+        size_t const len = rest < sizeof spaces - 1 ? rest : sizeof spaces - 1;
+        jsonm_wput( w, spaces, len );
+        rest -= len;
+    }
+}
+
+/** Copy the part of a string in a chunk of the JSON.
+  * @param w The writer.
+  * @param f The reformatter in a string.
+  * @param src The chunk after the opening quote or the previous chunk.
+  * @param end The end of the chunk.
+  * @return Pointer to the character after the closing quote or end. */
+static char const* jsonm_fmtstr( jsonWriter_t* w, jsonFormat_t* f, char const* src, char const* end ) {
+    char const* p = src;
+    if ( f->state & jsonm_fmtescape ) {
+        f->state &= ~jsonm_fmtescape;
+        ++p;
+    }
+    while( p != end ) {
+        p += jsonm_cleanspan( p, end - p );
+        if ( p == end )
+            break;
+        if ( '\"' == *p ) {
+            f->state &= ~jsonm_fmtstring;
+            ++p;
+            break;
+        }
+        if ( '\\' == *p && ++p == end ) {
+            f->state |= jsonm_fmtescape;
+            break;
+        }
+        ++p;
+    }
+    jsonm_wput( w, src, p - src );
+    return p;
+}
+
+#if !defined(JSON_NO_SIMD) && ( defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) )
+
+/** Width of the blocks of the strings that the reformatter scans at once. */
+#define FMT_WIDTH 16
+
+/** Get the length of the prefix of a block without quotes and backslashes.
+  * @param src A block of FMT_WIDTH characters, unaligned.
+  * @return The length of the prefix. FMT_WIDTH if there is no one. */
+static size_t jsonm_quotespan( char const* src ) {
+    __m128i const data = _mm_loadu_si128( (__m128i const*)src );
+    __m128i const quot = _mm_cmpeq_epi8( data, _mm_set1_epi8( '\"' ) );
+    __m128i const bsla = _mm_cmpeq_epi8( data, _mm_set1_epi8( '\\' ) );
+    unsigned int const mask = (unsigned int)_mm_movemask_epi8( _mm_or_si128( quot, bsla ) );
+    return 0 == mask ? FMT_WIDTH : jsonm_firstbit( mask );
+}
+
+#elif !defined(JSON_NO_SIMD) && defined(__ARM_NEON)
+
+/** Width of the blocks of the strings that the reformatter scans at once. */
+#define FMT_WIDTH 16
+
+/** Get the length of the prefix of a block without quotes and backslashes.
+  * @param src A block of FMT_WIDTH characters, unaligned.
+  * @return The length of the prefix. FMT_WIDTH if there is no one. */
+static size_t jsonm_quotespan( char const* src ) {
+    uint8x16_t const data = vld1q_u8( (uint8_t const*)src );
+    uint8x16_t const stop = vorrq_u8( vceqq_u8( data, vdupq_n_u8( '\"' ) ), vceqq_u8( data, vdupq_n_u8( '\\' ) ) );
+    /* Narrow to four bits per byte: the first set nibble is the first stop. */
+    uint8x8_t const nibbles = vshrn_n_u16( vreinterpretq_u16_u8( stop ), 4 );
+    uint64_t const bits = vget_lane_u64( vreinterpret_u64_u8( nibbles ), 0 );
+    size_t n = 0;
+    while( n < FMT_WIDTH && 0 == ( ( bits >> ( 4 * n ) ) & 0xF ) )
+        ++n;
+    return n;
+}
+
+#endif
+
+/** Reformat the token or the piece of a token at the start of a chunk
+  * through the functions of the writer, which split the output across the
+  * blocks of the sink or count it. It is used near the end of the room.
+  * @param w The writer.
+  * @param f The reformatter.
+  * @param src The chunk.
+  * @param end The end of the chunk.
+  * @return Pointer to the rest of the chunk. */
+static char const* jsonm_fmttoken( jsonWriter_t* w, jsonFormat_t* f, char const* src, char const* end ) {
+    if ( f->state & jsonm_fmtstring )
+        return jsonm_fmtstr( w, f, src, end );
+    int const type = jsonm_fmttab[ (unsigned char)*src ];
+    if ( jsonm_fmtspace == type )
+        return src + 1;
+    if ( jsonm_fmtclose == type ) {
+        if ( 0 != f->depth )
+            --f->depth;
+        if ( !( f->state & jsonm_fmtbreak ) )
+            jsonm_wbreak( w, f );
+        f->state &= ~jsonm_fmtbreak;
+        jsonm_wchar( w, *src );
+        return src + 1;
+    }
+    if ( jsonm_fmtcomma == type ) {
+        jsonm_wchar( w, *src );
+        jsonm_wbreak( w, f );
+        return src + 1;
+    }
+    if ( jsonm_fmtcolon == type ) {
+        jsonm_wchar( w, *src );
+        if ( 0 != f->nl )
+            jsonm_wchar( w, ' ' );
+        return src + 1;
+    }
+    if ( f->state & jsonm_fmtbreak ) {
+        f->state &= ~jsonm_fmtbreak;
+        jsonm_wbreak( w, f );
+    }
+    if ( jsonm_fmtopen == type ) {
+        ++f->depth;
+        f->state |= jsonm_fmtbreak;
+    }
+    else if ( jsonm_fmtquote == type )
+        f->state |= jsonm_fmtstring;
+    else {
+        char const* p = src + 1;
+        while( p != end && jsonm_fmtscalar == jsonm_fmttab[ (unsigned char)*p ] )
+            ++p;
+        jsonm_wput( w, src, p - src );
+        return p;
+    }
+    jsonm_wchar( w, *src );
+    return src + 1;
+}
+
+#ifdef FMT_WIDTH
+#define FMTROOM FMT_WIDTH
+#else
+/** Room for the characters of the tight loop of jsonw_format() besides the
+  * line break and the indentation: a colon and a space. */
+#define FMTROOM 2
+#endif
+
+/** Write a line break and an indentation. The room is not checked.
+  * @param dest Destination memory block.
+  * @param newline The line break.
+  * @param nl Length of the line break.
+  * @param indent Number of spaces.
+  * @return Pointer to the character after the indentation. */
+static char* jsonm_breakcpy( char* dest, char const* newline, size_t nl, size_t indent ) {
+    for( size_t i = 0; i < nl; ++i )
+        *dest++ = newline[ i ];
+    memset( dest, ' ', indent );
+    return dest + indent;
+}
+
+/* Add a chunk of a JSON reformatted. While there is room for the worst case
+   of a character, a line break and its indentation, the characters are
+   handled in a tight loop without any other check, and with SIMD the
+   strings are copied a block at a time up to the next quote or backslash. */
+JSON_API void jsonw_format( jsonWriter_t* w, jsonFormat_t* f, char const* src, size_t len ) {
+    char const* const end = src + len;
+    size_t const nl = f->nl;
+    size_t const step = 0 == nl ? 0 : f->indent;
+    while( src != end ) {
+        size_t const need = FMTROOM + nl + f->depth * step;
+        if ( w->remLen < need ) {
+            src = jsonm_fmttoken( w, f, src, end );
+            continue;
+        }
+        char* p = w->dest;
+        char* const stop = p + ( w->remLen - need );
+        unsigned depth = f->depth;
+        int state = f->state;
+        size_t indent = depth * step;
+        while( src != end && p <= stop ) {
+            if ( state & jsonm_fmtstring ) {
+#ifdef FMT_WIDTH
+                if ( !( state & jsonm_fmtescape ) && end - src >= FMT_WIDTH ) {
+                    size_t const n = jsonm_quotespan( src );
+                    memcpy( p, src, FMT_WIDTH );
+                    p += n;
+                    src += n;
+                    if ( FMT_WIDTH == n )
+                        continue;
+                }
+#endif
+                char const ch = *src++;
+                *p++ = ch;
+                if ( state & jsonm_fmtescape )
+                    state &= ~jsonm_fmtescape;
+                else if ( '\\' == ch )
+                    state |= jsonm_fmtescape;
+                else if ( '\"' == ch )
+                    state &= ~jsonm_fmtstring;
+                continue;
+            }
+            char const ch = *src++;
+            int const type = jsonm_fmttab[ (unsigned char)ch ];
+            if ( jsonm_fmtspace == type )
+                continue;
+            if ( jsonm_fmtclose == type ) {
+                if ( 0 != depth ) {
+                    --depth;
+                    indent -= step;
+                }
+                if ( !( state & jsonm_fmtbreak ) )
+                    p = jsonm_breakcpy( p, f->newline, nl, indent );
+                state &= ~jsonm_fmtbreak;
+                *p++ = ch;
+                continue;
+            }
+            if ( jsonm_fmtcomma == type ) {
+                *p++ = ch;
+                p = jsonm_breakcpy( p, f->newline, nl, indent );
+                continue;
+            }
+            if ( jsonm_fmtcolon == type ) {
+                *p++ = ch;
+                if ( 0 != nl )
+                    *p++ = ' ';
+                continue;
+            }
+            if ( state & jsonm_fmtbreak ) {
+                state &= ~jsonm_fmtbreak;
+                p = jsonm_breakcpy( p, f->newline, nl, indent );
+            }
+            *p++ = ch;
+            if ( jsonm_fmtopen == type ) {
+                ++depth;
+                state |= jsonm_fmtbreak;
+                break;
+            }
+            if ( jsonm_fmtquote == type )
+                state |= jsonm_fmtstring;
+        }
+        f->depth = depth;
+        f->state = state;
+        jsonm_wfastend( w, p );
+    }
+}
+
+/* Add a chunk of a JSON reformatted in a string. */
+JSON_API char* json_format( char* dest, jsonFormat_t* f, char const* src, size_t len, size_t* remLen ) {
+    jsonWriter_t w;
+    jsonw_init( &w, dest, *remLen + 1 );
+    jsonw_format( &w, f, src, len );
+    jsonw_end( &w );
+    *remLen = w.remLen;
+    return w.dest;
+}
+
+/** Sink of the pretty writers. The block is reformatted in the output. */
+static int jsonm_prettysink( jsonWriter_t* w, size_t len ) {
+    jsonPretty_t* const p = w->ctx;
+    jsonw_format( p->out, &p->format, w->start, w->dest - w->start );
+    w->dest = w->start;
+    w->remLen = 0 == len ? 0 : sizeof p->block;
+    if ( 0 == len )
+        jsonw_end( p->out );
+    return 1;
+}
+
+/** Get the length of the JSON at the end of a writer. A pretty writer ends
+  * with the length of its output and takes the status of its output writer.
+  * @param w The writer. Its sink has taken the last output.
+  * @param len The length of the JSON of the writer.
+  * @return The length of the output. */
+static size_t jsonm_prettyend( jsonWriter_t* w, size_t len ) {
+    if ( jsonm_prettysink != w->sink )
+        return len;
+    jsonWriter_t const* const out = ( (jsonPretty_t const*)w->ctx )->out;
+    w->status |= jsonw_status( out );
+    return out->flushed + (size_t)( out->dest - out->start );
+}
+
+/* Initialize a writer whose JSON is reformatted in another writer. */
+JSON_API void jsonw_initPretty( jsonWriter_t* w, jsonPretty_t* p, jsonWriter_t* out, unsigned indent, char const* newline ) {
+    json_formatInit( &p->format, indent, newline );
+    p->out = out;
+    jsonw_init( w, NULL, 0 );
+    w->sink = jsonm_prettysink;
+    w->ctx = p;
+    w->start = p->block;
+    w->dest = p->block;
+    w->remLen = sizeof p->block;
+}
+
+/* The schema serializers of json-maker.h write the fields with these
+   functions after they check the room for the whole struct once. */
+
+#define X( name, type, utype )                               \
+JSON_API char* json_##name##Fmt( char* dest, type value ) {  \
+    return jsonm_##name##fmt( dest, value );                 \
+}
+ALL_TYPES
+#undef X
+
+/* Write a double. The room is not checked. */
+JSON_API char* json_doubleFmt( char* dest, double value ) {
+    return jsonm_doublefmt( dest, value );
+}
+
+/* Write a boolean. The room is not checked. */
+JSON_API char* json_boolFmt( char* dest, int value ) {
+    if ( value ) {
+        memcpy( dest, "true", 4 );
+        return dest + 4;
+    }
+    memcpy( dest, "false", 5 );
+    return dest + 5;
+}
+
+/* Write a string between quotes with backslash escapes. */
+JSON_API char* json_strFmt( char* dest, char const* value ) {
+    size_t srclen = (size_t)-1;
+    size_t remLen = (size_t)-1;
+    *dest++ = '\"';
+    dest = jsonm_esccpy( dest, &value, &srclen, 0, &remLen );
+    *dest++ = '\"';
+    return dest;
+}
+
+/* Write the name of a property if a fragment fits after it. */
+JSON_API char* json_reserve( char* dest, char const* name, size_t size, size_t const* remLen ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    if ( k.size + size > *remLen )
+        return NULL;
+    return jsonm_keycpy( dest, &k );
+}
+
+/* Write the comma and the name of a value if a fragment fits after them. */
+JSON_API char* jsonw_reserve( jsonWriter_t* w, char const* name, size_t size ) {
+    jsonm_keyref_t const k = jsonm_namekey( name );
+    if ( w->comma + k.size + size > w->remLen )
+        return NULL;
+    jsonm_wcheck( w, NULL != name );
+    return jsonm_wnamecpy( w, &k );
+}
+
+/* Finish a value written after jsonw_reserve(). */
+JSON_API void jsonw_commit( jsonWriter_t* w, char* end ) {
+    jsonm_wfastend( w, end );
+    w->comma = 1;
+}
+
+#ifdef JSON_STATS
+
+/* Sample the cycles of the calls of this thread. */
+JSON_API void json_statsSample( unsigned period ) {
+    jsonm_statperiod = period;
+    jsonm_statcount = period;
+}
+
+/* Get the counters of this thread. */
+JSON_API jsonStats_t const* json_statsThread( void ) {
+    return &jsonm_stats;
+}
+
+#else
+
+JSON_API void json_statsSample( unsigned period ) {
+    (void)period;
+}
+
+JSON_API jsonStats_t const* json_statsThread( void ) {
+    static jsonStats_t const none;
+    return &none;
+}
+
+#endif
+
+/* Add counters to others. */
+JSON_API void json_statsMerge( jsonStats_t* total, jsonStats_t const* stats ) {
+    for( int i = 0; i < JSON_STATS_FAMILIES; ++i ) {
+        total->family[i].calls   += stats->family[i].calls;
+        total->family[i].bytes   += stats->family[i].bytes;
+        total->family[i].cycles  += stats->family[i].cycles;
+        total->family[i].samples += stats->family[i].samples;
+    }
+    total->names       += stats->names;
+    total->nameBytes   += stats->nameBytes;
+    total->escapeBytes += stats->escapeBytes;
+    total->truncations += stats->truncations;
+    if ( total->maxDepth < stats->maxDepth )
+        total->maxDepth = stats->maxDepth;
+}
+
+/* Add the counters of this thread to others and reset them. */
+JSON_API void json_statsCollect( jsonStats_t* total ) {
+    json_statsMerge( total, json_statsThread() );
+#ifdef JSON_STATS
+    memset( &jsonm_stats, 0, sizeof jsonm_stats );
+    jsonm_statdepth = 0;
+#endif
+}
+
+/* In a header-only build this file is part of the translation unit of the
+   user, so its internal macros end here. The internal functions, variables
+   and types have the jsonm_ prefix for the same reason. */
+#undef JSON_TLS
+#undef STAT_BEGIN
+#undef STAT_END
+#undef STAT_RETURN
+#undef STAT
+#undef NONASCII
+#undef NONASCII16
+#undef escvalue
+#undef SCAN_WIDTH
+#undef UTF8_WIDTH
+#undef namespecials
+#undef numfmt
+#undef numlen
+#undef json_num
+#undef json_prop
+#undef json_arr
+#undef jsonw_num
+#undef jsonw_prop
+#undef jsonw_arr
+#undef ALL_TYPES
+#undef dphiddenbit
+#undef anyvalue
+#undef jsonm_wcheck
+#undef jsonm_wpush
+#undef jsonm_wpop
+#undef FMT_WIDTH
+#undef FMTROOM
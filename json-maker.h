@@ -24,6 +24,10 @@
 */
 
 #include <stddef.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#endif
 
 #ifndef MAKE_JSON_H
 #define	MAKE_JSON_H
@@ -32,6 +36,20 @@
 extern "C" {
 #endif
 
+/** Linkage of the functions of the library. By default they are external,
+  * defined in json-maker.c. With JSON_MAKER_STATIC they are static, and each
+  * translation unit that defines JSON_MAKER_IMPLEMENTATION before including
+  * this header gets its own copy that the compiler can inline. */
+#ifndef JSON_API
+#ifndef JSON_MAKER_STATIC
+#define JSON_API
+#elif defined(__GNUC__) || defined(__clang__)
+#define JSON_API static __attribute__((unused))
+#else
+#define JSON_API static
+#endif
+#endif
+
 /** @defgroup makejoson Make JSON.
   * @{ */
 
@@ -40,41 +58,52 @@ extern "C" {
   * @param name Pointer to null-terminated string or null for unnamed.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_objOpen( char* dest, char const* name, size_t* remLen );
+JSON_API char* json_objOpen( char* dest, char const* name, size_t* remLen );
 
 /** Close a JSON object in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_objClose( char* dest, size_t* remLen );
+JSON_API char* json_objClose( char* dest, size_t* remLen );
 
 /** Used to finish the root JSON object. After call json_objClose().
   * @param dest Pointer to the end of JSON under construction.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_end( char* dest, size_t* remLen );
+JSON_API char* json_end( char* dest, size_t* remLen );
 
 /** Open an array in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
   * @param name Pointer to null-terminated string or null for unnamed.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_arrOpen( char* dest, char const* name, size_t* remLen );
+JSON_API char* json_arrOpen( char* dest, char const* name, size_t* remLen );
 
 /** Close an array in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_arrClose( char* dest, size_t* remLen );
+JSON_API char* json_arrClose( char* dest, size_t* remLen );
+
+/** Policies to write the bytes of the strings that are not ASCII, in the
+  * values and in the names. Define JSON_UTF8 with one of them when the library
+  * is compiled. The default is JSON_UTF8_PASS. The other ones check the UTF-8
+  * in the same pass that looks for the characters to escape. */
+#define JSON_UTF8_PASS    0 /**< Copied as they are, without any check. */
+#define JSON_UTF8_REPLACE 1 /**< Valid UTF-8 is copied. Each byte of invalid UTF-8 is written as U+FFFD. */
+#define JSON_UTF8_ERROR   2 /**< Valid UTF-8 is copied. Invalid UTF-8 in a value truncates the JSON: *remLen is set to zero. In names it is replaced. */
+#define JSON_UTF8_ASCII   3 /**< Written as \uXXXX escapes, with surrogate pairs beyond U+FFFF. Invalid UTF-8 is written as \uFFFD. */
+
 /** Add a text property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
   * @param name Pointer to null-terminated string or null for unnamed.
   * @param value A valid null-terminated string with the value.
   *              Backslash escapes will be added for special characters.
+  *              The bytes that are not ASCII are written as JSON_UTF8 selects.
   * @param len Max length of value. < 0 for unlimit.  
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */  
-char* json_nstr( char* dest, char const* name, char const* value, int len, size_t* remLen );
+JSON_API char* json_nstr( char* dest, char const* name, char const* value, int len, size_t* remLen );
 
 /** Add a text property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
@@ -87,20 +116,32 @@ static inline char* json_str( char* dest, char const* name, char const* value, s
     return json_nstr( dest, name, value, -1, remLen );  
 }
 
+/** Add a text property with a known length in a JSON string. The value is
+  * not scanned for a null character: the null characters in it are written
+  * as \u0000.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The value. Backslash escapes will be added for special
+  *              characters.
+  * @param len Length of value.
+  * @param remLen Pointer to remaining length of dest
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_strLen( char* dest, char const* name, char const* value, size_t len, size_t* remLen );
+
 /** Add a boolean property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
   * @param name Pointer to null-terminated string or null for unnamed.
   * @param value Zero for false. Non zero for true.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_bool( char* dest, char const* name, int value, size_t* remLen );
+JSON_API char* json_bool( char* dest, char const* name, int value, size_t* remLen );
 
 /** Add a null property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
   * @param name Pointer to null-terminated string or null for unnamed.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_null( char* dest, char const* name, size_t* remLen );
+JSON_API char* json_null( char* dest, char const* name, size_t* remLen );
 
 /** Add an integer property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
@@ -108,7 +149,7 @@ char* json_null( char* dest, char const* name, size_t* remLen );
   * @param value Value of the property.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_int( char* dest, char const* name, int value, size_t* remLen );
+JSON_API char* json_int( char* dest, char const* name, int value, size_t* remLen );
 
 /** Add an unsigned integer property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
@@ -116,7 +157,7 @@ char* json_int( char* dest, char const* name, int value, size_t* remLen );
   * @param value Value of the property.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_uint( char* dest, char const* name, unsigned int value, size_t* remLen );
+JSON_API char* json_uint( char* dest, char const* name, unsigned int value, size_t* remLen );
 
 /** Add a long integer property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
@@ -124,7 +165,7 @@ char* json_uint( char* dest, char const* name, unsigned int value, size_t* remLe
   * @param value Value of the property.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_long( char* dest, char const* name, long int value, size_t* remLen );
+JSON_API char* json_long( char* dest, char const* name, long int value, size_t* remLen );
 
 /** Add an unsigned long integer property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
@@ -132,7 +173,7 @@ char* json_long( char* dest, char const* name, long int value, size_t* remLen );
   * @param value Value of the property.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_ulong( char* dest, char const* name, unsigned long int value, size_t* remLen );
+JSON_API char* json_ulong( char* dest, char const* name, unsigned long int value, size_t* remLen );
 
 /** Add a long long integer property in a JSON string.
   * @param dest Pointer to the end of JSON under construction.
@@ -140,15 +181,1604 @@ char* json_ulong( char* dest, char const* name, unsigned long int value, size_t*
   * @param value Value of the property.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_verylong( char* dest, char const* name, long long int value, size_t* remLen );
+JSON_API char* json_verylong( char* dest, char const* name, long long int value, size_t* remLen );
+
+/** Policies to write the double values that JSON can not represent: NaN and
+  * infinities. Define JSON_NONFINITE with one of them when the library is
+  * compiled. The default is JSON_NONFINITE_NULL. */
+#define JSON_NONFINITE_NULL   0 /**< Written as null. */
+#define JSON_NONFINITE_ERROR  1 /**< Nothing is written and *remLen is set to zero. */
+#define JSON_NONFINITE_STRING 2 /**< Written as "NaN", "Infinity" or "-Infinity". */
 
 /** Add a double precision number property in a JSON string.
+  * The number is written with the shortest text that is read back as the
+  * same double. NaN and infinities are written as JSON_NONFINITE selects.
   * @param dest Pointer to the end of JSON under construction.
   * @param name Pointer to null-terminated string or null for unnamed.
   * @param value Value of the property.
   * @param remLen Pointer to remaining length of dest
   * @return Pointer to the new end of JSON under construction. */
-char* json_double( char* dest, char const* name, double value, size_t* remLen );
+JSON_API char* json_double( char* dest, char const* name, double value, size_t* remLen );
+
+/** Add a value that is already serialized in a JSON string, such as an
+  * object written before. It is copied as it is, without any check.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The text of a valid JSON value.
+  * @param len Length of the text.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_raw( char* dest, char const* name, char const* value, size_t len, size_t* remLen );
+
+/** Add a binary property in base64 with padding, RFC 4648, in a JSON string.
+  * The data is encoded straight into dest, 4 characters for each 3 bytes.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param data The data.
+  * @param len Length of the data in bytes.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_base64( char* dest, char const* name, void const* data, size_t len, size_t* remLen );
+
+/** Add a binary property in lowercase hexadecimal in a JSON string. The data
+  * is encoded straight into dest, 2 digits for each byte.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param data The data.
+  * @param len Length of the data in bytes.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_hex( char* dest, char const* name, void const* data, size_t len, size_t* remLen );
+
+/** @ } */
+
+/** @defgroup jsonwriter JSON writer.
+  * The functions of a writer keep the end of the JSON under construction and
+  * its remaining length in a jsonWriter_t. When the output does not fit, the
+  * writer stops writing and keeps counting the length that the whole JSON
+  * needs, so a retry can allocate it exactly.
+  * @{ */
+
+/** Status flags of a writer. */
+enum {
+    JSON_OVERFLOW = 1, /**< The output did not fit. See jsonw_needed(). */
+    JSON_ERROR    = 2, /**< A value could not be written. See JSON_NONFINITE
+                            and JSON_UTF8. */
+    JSON_MISUSE   = 4, /**< Unbalanced close, value without a name in an
+                            object or with a name elsewhere, or unclosed
+                            JSON at the end. Only checked without NDEBUG. */
+    JSON_MEASURE  = 8  /**< Internal: the writer only measures. It is not
+                            returned by jsonw_status(). */
+};
+
+/** Number of levels of the bit-stack of a writer. It is fixed, so the layout
+  * of jsonWriter_t does not depend on the build options. */
+#define JSON_NESTBITS 64
+
+#ifndef JSON_MAXDEPTH
+/** Nesting depth up to which the structure of the JSON is checked. Values
+  * above JSON_NESTBITS are clamped to it. */
+#define JSON_MAXDEPTH 64
+#endif
+
+/** Minimum length of the blocks that a sink gives to a writer. */
+#define JSON_MINBLOCK 16
+
+typedef struct jsonWriter_s jsonWriter_t;
+
+/** Sink of a writer. It is called when the current block is full to take the
+  * output from start to dest and to set a new block in start, dest and remLen
+  * with room for JSON_MINBLOCK bytes at least. It is called by jsonw_end()
+  * with zero length to take the last output.
+  * @param w The writer.
+  * @param len Length of the output still to be written, (size_t)-1 if it is
+  *            unknown, or zero at the end.
+  * @return Zero if it failed. Then the writer must not be modified. */
+typedef int (*jsonSink_t)( jsonWriter_t* w, size_t len );
+
+/** State of a JSON under construction. Use it through the jsonw functions. */
+struct jsonWriter_s {
+    char*  start;   /**< Start of the current memory block. */
+    char*  dest;    /**< Pointer to the end of JSON under construction. */
+    size_t remLen;  /**< Remaining length of dest. Zero after an overflow. */
+    size_t flushed; /**< Length of the output taken by the sink. */
+    size_t lost;    /**< Length of the output that did not fit. */
+    int    status;  /**< Status flags. */
+    int    comma;   /**< One if the next value needs a leading comma. */
+    unsigned depth; /**< Nesting depth. Only kept without NDEBUG. */
+    unsigned char nest[ JSON_NESTBITS / 8 ]; /**< A bit per level,
+                       one for objects and zero for arrays. */
+    jsonSink_t sink; /**< Sink of the output or null for a fixed block. */
+    void*  ctx;     /**< State of the sink. */
+};
+
+/** Initialize a writer.
+  * @param w The writer.
+  * @param dest Destination memory block. If it is null the writer only
+  *             measures, see jsonw_measure().
+  * @param size Size of dest including the null character.
+  *             If it is zero dest is not written at all. */
+JSON_API void jsonw_init( jsonWriter_t* w, char* dest, size_t size );
+
+/** Initialize a writer that writes nothing and only measures the length of
+  * the JSON. The escapes of the strings are counted and the numbers are not
+  * formatted, except the doubles. After the JSON is built, jsonw_needed()
+  * returns the exact size to allocate. The json_ functions have no measure
+  * mode: measure with the jsonw_ function of each one.
+  * @param w The writer. */
+static inline void jsonw_measure( jsonWriter_t* w ) {
+    jsonw_init( w, NULL, 0 );
+}
+
+/** Finish the JSON under construction writing its null character.
+  * With a sink the null character is not written and the last output is
+  * handed to the sink.
+  * @param w The writer.
+  * @return The length of the JSON. For a pretty writer, the length of its
+  *         output, see jsonw_initPretty(). */
+JSON_API size_t jsonw_end( jsonWriter_t* w );
+
+/** Get the status flags of a writer. A writer that only measures has no
+  * output to overflow, so JSON_OVERFLOW is never set in its status.
+  * @param w The writer.
+  * @return Zero if every value has been written. */
+static inline int jsonw_status( jsonWriter_t const* w ) {
+    /* Internally it counts the whole JSON as the length that did not fit. */
+    int const measure = NULL == w->sink && ( w->status & JSON_MEASURE );
+    return w->status & ~JSON_MEASURE & ~( measure ? JSON_OVERFLOW : 0 );
+}
+
+/** Get the size that the destination memory block needs to hold the whole
+  * JSON under construction including its null character.
+  * @param w The writer.
+  * @return The size in bytes. */
+static inline size_t jsonw_needed( jsonWriter_t const* w ) {
+    return w->flushed + (size_t)( w->dest - w->start ) + w->lost + 1;
+}
+
+/** Open a JSON object.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed. */
+JSON_API void jsonw_objOpen( jsonWriter_t* w, char const* name );
+
+/** Close a JSON object.
+  * @param w The writer. */
+JSON_API void jsonw_objClose( jsonWriter_t* w );
+
+/** Open an array.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed. */
+JSON_API void jsonw_arrOpen( jsonWriter_t* w, char const* name );
+
+/** Close an array.
+  * @param w The writer. */
+JSON_API void jsonw_arrClose( jsonWriter_t* w );
+
+/** Add a text property. With JSON_UTF8_ERROR, invalid UTF-8 sets JSON_ERROR
+  * and ends the string.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value A valid null-terminated string with the value.
+  *              Backslash escapes will be added for special characters.
+  * @param len Max length of value. < 0 for unlimit. */
+JSON_API void jsonw_nstr( jsonWriter_t* w, char const* name, char const* value, int len );
+
+/** Add a text property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value A valid null-terminated string with the value.
+  *              Backslash escapes will be added for special characters. */
+static inline void jsonw_str( jsonWriter_t* w, char const* name, char const* value ) {
+    jsonw_nstr( w, name, value, -1 );
+}
+
+/** Add a text property with a known length. The value is not scanned for
+  * a null character: the null characters in it are written as \u0000.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The value. Backslash escapes will be added for special
+  *              characters.
+  * @param len Length of value. */
+JSON_API void jsonw_strLen( jsonWriter_t* w, char const* name, char const* value, size_t len );
+
+/** Add a boolean property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Zero for false. Non zero for true. */
+JSON_API void jsonw_bool( jsonWriter_t* w, char const* name, int value );
+
+/** Add a null property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed. */
+JSON_API void jsonw_null( jsonWriter_t* w, char const* name );
+
+/** Add an integer property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Value of the property. */
+JSON_API void jsonw_int( jsonWriter_t* w, char const* name, int value );
+
+/** Add an unsigned integer property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Value of the property. */
+JSON_API void jsonw_uint( jsonWriter_t* w, char const* name, unsigned int value );
+
+/** Add a long integer property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Value of the property. */
+JSON_API void jsonw_long( jsonWriter_t* w, char const* name, long int value );
+
+/** Add an unsigned long integer property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Value of the property. */
+JSON_API void jsonw_ulong( jsonWriter_t* w, char const* name, unsigned long int value );
+
+/** Add a long long integer property.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Value of the property. */
+JSON_API void jsonw_verylong( jsonWriter_t* w, char const* name, long long int value );
+
+/** Add a double precision number property.
+  * With JSON_NONFINITE_ERROR, NaN and infinities set JSON_ERROR and are not
+  * written.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value Value of the property. */
+JSON_API void jsonw_double( jsonWriter_t* w, char const* name, double value );
+
+/** Add a value that is already serialized, such as an object written before.
+  * It is copied as it is, without any check.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The text of a valid JSON value.
+  * @param len Length of the text. */
+JSON_API void jsonw_raw( jsonWriter_t* w, char const* name, char const* value, size_t len );
+
+/** Add a binary property in base64 with padding, RFC 4648. The length of the
+  * encoding is known before it is written, so it is checked only once.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param data The data.
+  * @param len Length of the data in bytes. */
+JSON_API void jsonw_base64( jsonWriter_t* w, char const* name, void const* data, size_t len );
+
+/** Add a binary property in lowercase hexadecimal.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param data The data.
+  * @param len Length of the data in bytes. */
+JSON_API void jsonw_hex( jsonWriter_t* w, char const* name, void const* data, size_t len );
+
+/** @ } */
+
+/** @defgroup keys Encoded keys.
+  * A key is a property name encoded once with its quotes, escapes and colon,
+  * as "temp":, so the functions that get it write the name with one copy of a
+  * known length. The plain names of the other functions are scanned and
+  * escaped in each call. The keys are read-only after they are initialized,
+  * so they can be shared by any number of threads.
+  * @{ */
+
+/** A property name encoded as it is written. */
+typedef struct jsonKey_s {
+    char const* text; /**< The quoted and escaped name and the colon. */
+    size_t len;       /**< Length of text. */
+} jsonKey_t;
+
+/** Initializer of a key from a string literal without special characters.
+  * For example: static jsonKey_t const temp = JSON_KEY( "temp" ); */
+#define JSON_KEY( name ) { "\"" name "\":", sizeof "\"" name "\":" - 1 }
+
+/** Encode a property name as a key.
+  * @param key The key.
+  * @param name A valid null-terminated string.
+  * @param dest Memory block for the text of the key. It must live as long
+  *             as the key. It is not null-terminated.
+  * @param size Size of dest. 6 * strlen( name ) + 3 is enough for any name.
+  * @return The length of dest used or zero if it does not fit. */
+JSON_API size_t json_keyInit( jsonKey_t* key, char const* name, char* dest, size_t size );
+
+/** Encode a property name with a known length as a key. The name is not
+  * scanned for a null character: the null characters in it are written as
+  * \u0000. Keys are how the functions take names with a known length.
+  * @param key The key.
+  * @param name The name.
+  * @param len Length of name.
+  * @param dest Memory block for the text of the key. It must live as long
+  *             as the key. It is not null-terminated.
+  * @param size Size of dest. 6 * len + 3 is enough for any name.
+  * @return The length of dest used or zero if it does not fit. */
+JSON_API size_t json_keyInitLen( jsonKey_t* key, char const* name, size_t len, char* dest, size_t size );
+
+/** Open a JSON object in a JSON string. See json_objOpen().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_objOpen_k( char* dest, jsonKey_t const* key, size_t* remLen );
+
+/** Open an array in a JSON string. See json_arrOpen().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_arrOpen_k( char* dest, jsonKey_t const* key, size_t* remLen );
+
+/** Add a text property in a JSON string. See json_nstr().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_nstr_k( char* dest, jsonKey_t const* key, char const* value, int len, size_t* remLen );
+
+/** Add a text property in a JSON string. See json_str().
+  * @param key The name or null for unnamed. */
+static inline char* json_str_k( char* dest, jsonKey_t const* key, char const* value, size_t* remLen ) {
+    return json_nstr_k( dest, key, value, -1, remLen );
+}
+
+/** Add a text property with a known length in a JSON string. See json_strLen().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_strLen_k( char* dest, jsonKey_t const* key, char const* value, size_t len, size_t* remLen );
+
+/** Add a boolean property in a JSON string. See json_bool().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_bool_k( char* dest, jsonKey_t const* key, int value, size_t* remLen );
+
+/** Add a null property in a JSON string. See json_null().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_null_k( char* dest, jsonKey_t const* key, size_t* remLen );
+
+/** Add an integer property in a JSON string. See json_int().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_int_k( char* dest, jsonKey_t const* key, int value, size_t* remLen );
+
+/** Add an unsigned integer property in a JSON string. See json_uint().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_uint_k( char* dest, jsonKey_t const* key, unsigned int value, size_t* remLen );
+
+/** Add a long integer property in a JSON string. See json_long().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_long_k( char* dest, jsonKey_t const* key, long int value, size_t* remLen );
+
+/** Add an unsigned long integer property in a JSON string. See json_ulong().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_ulong_k( char* dest, jsonKey_t const* key, unsigned long int value, size_t* remLen );
+
+/** Add a long long integer property in a JSON string. See json_verylong().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_verylong_k( char* dest, jsonKey_t const* key, long long int value, size_t* remLen );
+
+/** Add a double precision number property in a JSON string. See json_double().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_double_k( char* dest, jsonKey_t const* key, double value, size_t* remLen );
+
+/** Add a value that is already serialized in a JSON string. See json_raw().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_raw_k( char* dest, jsonKey_t const* key, char const* value, size_t len, size_t* remLen );
+
+/** Add a binary property in base64 in a JSON string. See json_base64().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_base64_k( char* dest, jsonKey_t const* key, void const* data, size_t len, size_t* remLen );
+
+/** Add a binary property in hexadecimal in a JSON string. See json_hex().
+  * @param key The name or null for unnamed. */
+JSON_API char* json_hex_k( char* dest, jsonKey_t const* key, void const* data, size_t len, size_t* remLen );
+
+/** Open a JSON object. See jsonw_objOpen().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_objOpen_k( jsonWriter_t* w, jsonKey_t const* key );
+
+/** Open an array. See jsonw_arrOpen().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_arrOpen_k( jsonWriter_t* w, jsonKey_t const* key );
+
+/** Add a text property. See jsonw_nstr().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_nstr_k( jsonWriter_t* w, jsonKey_t const* key, char const* value, int len );
+
+/** Add a text property. See jsonw_str().
+  * @param key The name or null for unnamed. */
+static inline void jsonw_str_k( jsonWriter_t* w, jsonKey_t const* key, char const* value ) {
+    jsonw_nstr_k( w, key, value, -1 );
+}
+
+/** Add a text property with a known length. See jsonw_strLen().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_strLen_k( jsonWriter_t* w, jsonKey_t const* key, char const* value, size_t len );
+
+/** Add a boolean property. See jsonw_bool().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_bool_k( jsonWriter_t* w, jsonKey_t const* key, int value );
+
+/** Add a null property. See jsonw_null().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_null_k( jsonWriter_t* w, jsonKey_t const* key );
+
+/** Add an integer property. See jsonw_int().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_int_k( jsonWriter_t* w, jsonKey_t const* key, int value );
+
+/** Add an unsigned integer property. See jsonw_uint().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_uint_k( jsonWriter_t* w, jsonKey_t const* key, unsigned int value );
+
+/** Add a long integer property. See jsonw_long().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_long_k( jsonWriter_t* w, jsonKey_t const* key, long int value );
+
+/** Add an unsigned long integer property. See jsonw_ulong().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_ulong_k( jsonWriter_t* w, jsonKey_t const* key, unsigned long int value );
+
+/** Add a long long integer property. See jsonw_verylong().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_verylong_k( jsonWriter_t* w, jsonKey_t const* key, long long int value );
+
+/** Add a double precision number property. See jsonw_double().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_double_k( jsonWriter_t* w, jsonKey_t const* key, double value );
+
+/** Add a value that is already serialized. See jsonw_raw().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_raw_k( jsonWriter_t* w, jsonKey_t const* key, char const* value, size_t len );
+
+/** Add a binary property in base64. See jsonw_base64().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_base64_k( jsonWriter_t* w, jsonKey_t const* key, void const* data, size_t len );
+
+/** Add a binary property in hexadecimal. See jsonw_hex().
+  * @param key The name or null for unnamed. */
+JSON_API void jsonw_hex_k( jsonWriter_t* w, jsonKey_t const* key, void const* data, size_t len );
+
+/** @ } */
+
+/** @defgroup arrays Arrays.
+  * The array functions write a whole vector of values as an array property,
+  * checking the room once for each block of values instead of once for each
+  * value. The Stride versions read a member of an array of structs: values
+  * points to the member of the first struct and stride is the distance in
+  * bytes from one struct to the next, usually the size of the struct.
+  * The result is the same as the one of the single functions in a loop.
+  * @{ */
+
+/** Add an array of integers in a JSON string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_intStride( char* dest, char const* name, int const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of integers in a JSON string. See json_intStride(). */
+static inline char* json_intArray( char* dest, char const* name, int const* values, size_t n, size_t* remLen ) {
+    return json_intStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of unsigned integers in a JSON string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_uintStride( char* dest, char const* name, unsigned int const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of unsigned integers in a JSON string. See json_uintStride(). */
+static inline char* json_uintArray( char* dest, char const* name, unsigned int const* values, size_t n, size_t* remLen ) {
+    return json_uintStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of long integers in a JSON string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_longStride( char* dest, char const* name, long int const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of long integers in a JSON string. See json_longStride(). */
+static inline char* json_longArray( char* dest, char const* name, long int const* values, size_t n, size_t* remLen ) {
+    return json_longStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of unsigned long integers in a JSON string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_ulongStride( char* dest, char const* name, unsigned long int const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of unsigned long integers in a JSON string. See json_ulongStride(). */
+static inline char* json_ulongArray( char* dest, char const* name, unsigned long int const* values, size_t n, size_t* remLen ) {
+    return json_ulongStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of long long integers in a JSON string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_verylongStride( char* dest, char const* name, long long int const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of long long integers in a JSON string. See json_verylongStride(). */
+static inline char* json_verylongArray( char* dest, char const* name, long long int const* values, size_t n, size_t* remLen ) {
+    return json_verylongStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of double precision numbers in a JSON string.
+  * With JSON_NONFINITE_ERROR, a NaN or an infinity truncates the JSON as
+  * json_double() does.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_doubleStride( char* dest, char const* name, double const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of double precision numbers in a JSON string. See json_doubleStride(). */
+static inline char* json_doubleArray( char* dest, char const* name, double const* values, size_t n, size_t* remLen ) {
+    return json_doubleStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of strings in a JSON string.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values Pointer to the first null-terminated string.
+  * @param n Number of strings.
+  * @param stride Distance in bytes between two string pointers.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_strStride( char* dest, char const* name, char const* const* values, size_t n, size_t stride, size_t* remLen );
+
+/** Add an array of strings in a JSON string. See json_strStride(). */
+static inline char* json_strArray( char* dest, char const* name, char const* const* values, size_t n, size_t* remLen ) {
+    return json_strStride( dest, name, values, n, sizeof *values, remLen );
+}
+
+/** Add an array of integers.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values. */
+JSON_API void jsonw_intStride( jsonWriter_t* w, char const* name, int const* values, size_t n, size_t stride );
+
+/** Add an array of integers. See jsonw_intStride(). */
+static inline void jsonw_intArray( jsonWriter_t* w, char const* name, int const* values, size_t n ) {
+    jsonw_intStride( w, name, values, n, sizeof *values );
+}
+
+/** Add an array of unsigned integers.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values. */
+JSON_API void jsonw_uintStride( jsonWriter_t* w, char const* name, unsigned int const* values, size_t n, size_t stride );
+
+/** Add an array of unsigned integers. See jsonw_uintStride(). */
+static inline void jsonw_uintArray( jsonWriter_t* w, char const* name, unsigned int const* values, size_t n ) {
+    jsonw_uintStride( w, name, values, n, sizeof *values );
+}
+
+/** Add an array of long integers.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values. */
+JSON_API void jsonw_longStride( jsonWriter_t* w, char const* name, long int const* values, size_t n, size_t stride );
+
+/** Add an array of long integers. See jsonw_longStride(). */
+static inline void jsonw_longArray( jsonWriter_t* w, char const* name, long int const* values, size_t n ) {
+    jsonw_longStride( w, name, values, n, sizeof *values );
+}
+
+/** Add an array of unsigned long integers.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values. */
+JSON_API void jsonw_ulongStride( jsonWriter_t* w, char const* name, unsigned long int const* values, size_t n, size_t stride );
+
+/** Add an array of unsigned long integers. See jsonw_ulongStride(). */
+static inline void jsonw_ulongArray( jsonWriter_t* w, char const* name, unsigned long int const* values, size_t n ) {
+    jsonw_ulongStride( w, name, values, n, sizeof *values );
+}
+
+/** Add an array of long long integers.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values. */
+JSON_API void jsonw_verylongStride( jsonWriter_t* w, char const* name, long long int const* values, size_t n, size_t stride );
+
+/** Add an array of long long integers. See jsonw_verylongStride(). */
+static inline void jsonw_verylongArray( jsonWriter_t* w, char const* name, long long int const* values, size_t n ) {
+    jsonw_verylongStride( w, name, values, n, sizeof *values );
+}
+
+/** Add an array of double precision numbers.
+  * With JSON_NONFINITE_ERROR, NaN and infinities set JSON_ERROR and are not
+  * written.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values The first value.
+  * @param n Number of values.
+  * @param stride Distance in bytes between two values. */
+JSON_API void jsonw_doubleStride( jsonWriter_t* w, char const* name, double const* values, size_t n, size_t stride );
+
+/** Add an array of double precision numbers. See jsonw_doubleStride(). */
+static inline void jsonw_doubleArray( jsonWriter_t* w, char const* name, double const* values, size_t n ) {
+    jsonw_doubleStride( w, name, values, n, sizeof *values );
+}
+
+/** Add an array of strings.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param values Pointer to the first null-terminated string.
+  * @param n Number of strings.
+  * @param stride Distance in bytes between two string pointers. */
+JSON_API void jsonw_strStride( jsonWriter_t* w, char const* name, char const* const* values, size_t n, size_t stride );
+
+/** Add an array of strings. See jsonw_strStride(). */
+static inline void jsonw_strArray( jsonWriter_t* w, char const* name, char const* const* values, size_t n ) {
+    jsonw_strStride( w, name, values, n, sizeof *values );
+}
+
+/** @ } */
+
+/** @defgroup schema Schema serializers.
+  * A struct is described once by a macro with its fields and JSON_SCHEMA()
+  * generates the functions that write it. The names and the punctuation of
+  * each field are merged at compile time into a single literal and the
+  * worst-case length of the JSON is known, so when it fits the whole struct
+  * is written without checking the room field by field.
+  *
+  * The macro calls X( kind, name, arg ) for each field. The kinds are:
+  *   int, uint, long, ulong, verylong, double and bool with arg 0,
+  *   str for a null-terminated string that is not null, with arg 0,
+  *   obj for a struct with its own schema, with the schema name as arg,
+  *   array for an array of one of the first kinds, with (kind, length) as arg.
+  *
+  * @code
+  * #define WEATHER( X ) X( int, temp, 0 ) X( int, hum, 0 )
+  * JSON_SCHEMA( weather, struct weather, WEATHER )
+  * @endcode
+  * It defines, with the schema_ prefix so that no schema name clashes with
+  * the functions of the library:
+  *   json_schema_weather_max: enum with the worst-case length without the
+  *     characters of the strings.
+  *   size_t json_schema_weather_bound( struct weather const* src ):
+  *     Worst-case length.
+  *   char* json_schema_weather_fmt( char* dest, struct weather const* src ):
+  *     Write the JSON object without checking the room.
+  *   char* json_schema_weather( char* dest, char const* name,
+  *                              struct weather const* src, size_t* remLen ):
+  *     Add the object property like json_int() does.
+  *   void jsonw_schema_weather( jsonWriter_t* w, char const* name,
+  *                              struct weather const* src ):
+  *     Add the object property like jsonw_int() does.
+  * @{ */
+
+/** Write an integer. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value The value.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_intFmt( char* dest, int value );
+
+/** Write an unsigned integer. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value The value.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_uintFmt( char* dest, unsigned int value );
+
+/** Write a long integer. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value The value.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_longFmt( char* dest, long int value );
+
+/** Write an unsigned long integer. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value The value.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_ulongFmt( char* dest, unsigned long int value );
+
+/** Write a long long integer. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value The value.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_verylongFmt( char* dest, long long int value );
+
+/** Write a double. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value The value.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_doubleFmt( char* dest, double value );
+
+/** Write a boolean. The room is not checked.
+  * @param dest Destination memory block.
+  * @param value Zero for false. Non zero for true.
+  * @return Pointer to the character after the value. */
+JSON_API char* json_boolFmt( char* dest, int value );
+
+/** Write a string between quotes with backslash escapes. The room is not
+  * checked, see json_strBound(). Even with JSON_UTF8_ERROR, invalid UTF-8 is
+  * written as U+FFFD so that the fragment stays whole.
+  * @param dest Destination memory block.
+  * @param value A valid null-terminated string.
+  * @return Pointer to the character after the closing quote. */
+JSON_API char* json_strFmt( char* dest, char const* value );
+
+/** Get the worst-case length that json_strFmt() writes.
+  * @param value A valid null-terminated string.
+  * @return The length in bytes. */
+static inline size_t json_strBound( char const* value ) {
+    return 2 + 6 * strlen( value );
+}
+
+/** Write the name of a property if a fragment of a known worst-case length
+  * fits after it. The remaining length is not updated.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param size Worst-case length of the fragment after the name.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the end of the name or null if it does not fit. */
+JSON_API char* json_reserve( char* dest, char const* name, size_t size, size_t const* remLen );
+
+/** Write the comma and the name of a value if a fragment of a known
+  * worst-case length fits after them. Then the fragment has to be written
+  * and finished with jsonw_commit().
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param size Worst-case length of the fragment after the name.
+  * @return Pointer to the end of the name or null if it does not fit. */
+JSON_API char* jsonw_reserve( jsonWriter_t* w, char const* name, size_t size );
+
+/** Finish a value written after jsonw_reserve().
+  * @param w The writer.
+  * @param end Pointer to the end of the value. */
+JSON_API void jsonw_commit( jsonWriter_t* w, char* end );
+
+/* Worst-case lengths of the kinds of fields. The integers have at most 2.41
+   decimal digits per byte, plus a sign. */
+#define JSONS_MAX_int( arg )      ( sizeof( int ) * 302 / 125 + 2 )
+#define JSONS_MAX_uint( arg )     ( sizeof( unsigned int ) * 302 / 125 + 2 )
+#define JSONS_MAX_long( arg )     ( sizeof( long ) * 302 / 125 + 2 )
+#define JSONS_MAX_ulong( arg )    ( sizeof( unsigned long ) * 302 / 125 + 2 )
+#define JSONS_MAX_verylong( arg ) ( sizeof( long long ) * 302 / 125 + 2 )
+#define JSONS_MAX_double( arg )   25
+#define JSONS_MAX_bool( arg )     5
+#define JSONS_MAX_str( arg )      2
+#define JSONS_MAX_obj( arg )      json_schema_##arg##_max
+#define JSONS_MAX_array( arg )    JSONS_MAXARR_ arg
+#define JSONS_MAXARR_( kind, len ) ( 2 + (len) * ( JSONS_MAX_##kind( 0 ) + 1 ) )
+
+/* Runtime worst-case lengths of the values of the fields. */
+#define JSONS_LEN_int( name, arg )      JSONS_MAX_int( arg )
+#define JSONS_LEN_uint( name, arg )     JSONS_MAX_uint( arg )
+#define JSONS_LEN_long( name, arg )     JSONS_MAX_long( arg )
+#define JSONS_LEN_ulong( name, arg )    JSONS_MAX_ulong( arg )
+#define JSONS_LEN_verylong( name, arg ) JSONS_MAX_verylong( arg )
+#define JSONS_LEN_double( name, arg )   JSONS_MAX_double( arg )
+#define JSONS_LEN_bool( name, arg )     JSONS_MAX_bool( arg )
+#define JSONS_LEN_str( name, arg )      json_strBound( src->name )
+#define JSONS_LEN_obj( name, arg )      json_schema_##arg##_bound( &src->name )
+#define JSONS_LEN_array( name, arg )    JSONS_MAX_array( arg )
+
+/* The name of a field with its leading comma, as a literal. */
+#define JSONS_KEY_( name ) ",\"" #name "\":"
+#define JSONS_PUT_( p, lit ) ( memcpy( p, lit, sizeof lit - 1 ), p + sizeof lit - 1 )
+#define JSONS_APPLY_( m, args ) m args
+#define JSONS_UNPACK_( kind, len ) kind, len
+
+#define JSONS_MAXFIELD_( kind, name, arg ) \
+    + ( sizeof JSONS_KEY_( name ) - 1 ) + JSONS_MAX_##kind( arg )
+#define JSONS_LENFIELD_( kind, name, arg ) \
+    + ( sizeof JSONS_KEY_( name ) - 1 ) + JSONS_LEN_##kind( name, arg )
+
+/* Unchecked writing of the fields. */
+#define JSONS_FMT_int( name, arg )      JSONS_FMTNUM_( int, name )
+#define JSONS_FMT_uint( name, arg )     JSONS_FMTNUM_( uint, name )
+#define JSONS_FMT_long( name, arg )     JSONS_FMTNUM_( long, name )
+#define JSONS_FMT_ulong( name, arg )    JSONS_FMTNUM_( ulong, name )
+#define JSONS_FMT_verylong( name, arg ) JSONS_FMTNUM_( verylong, name )
+#define JSONS_FMT_double( name, arg )   JSONS_FMTNUM_( double, name )
+#define JSONS_FMT_bool( name, arg )     JSONS_FMTNUM_( bool, name )
+#define JSONS_FMT_str( name, arg )      JSONS_FMTNUM_( str, name )
+#define JSONS_FMT_obj( name, arg )                             \
+    p = JSONS_PUT_( p, JSONS_KEY_( name ) );                   \
+    p = json_schema_##arg##_fmt( p, &src->name );
+#define JSONS_FMT_array( name, arg ) \
+    JSONS_APPLY_( JSONS_FMTARR_, ( name, JSONS_UNPACK_ arg ) )
+#define JSONS_FMTNUM_( kind, name ) \
+    p = json_##kind##Fmt( JSONS_PUT_( p, JSONS_KEY_( name ) ), src->name );
+#define JSONS_FMTARR_( name, kind, len )                       \
+    p = JSONS_PUT_( p, JSONS_KEY_( name ) "[" );               \
+    for( size_t i = 0; i < (len); ++i ) {                      \
+        p = json_##kind##Fmt( p, src->name[ i ] );             \
+        *p++ = ',';                                            \
+    }                                                          \
+    if ( 0 < (len) )                                           \
+        --p;                                                   \
+    *p++ = ']';
+#define JSONS_FMTFIELD_( kind, name, arg ) JSONS_FMT_##kind( name, arg )
+
+/* Check of the doubles. The unchecked writing is skipped for NaN and
+   infinities, so they are written as JSON_NONFINITE selects in the library. */
+#define JSONS_ISFINITE_int( value )      1
+#define JSONS_ISFINITE_uint( value )     1
+#define JSONS_ISFINITE_long( value )     1
+#define JSONS_ISFINITE_ulong( value )    1
+#define JSONS_ISFINITE_verylong( value ) 1
+#define JSONS_ISFINITE_double( value )   ( (value) == (value) && (value) - (value) == 0 )
+#define JSONS_ISFINITE_bool( value )     1
+#define JSONS_ISFINITE_str( value )      1
+#define JSONS_FINITE_obj( name, arg ) \
+    if ( !json_schema_##arg##_finite( &src->name ) ) return 0;
+#define JSONS_FINITE_array( name, arg ) \
+    JSONS_APPLY_( JSONS_FINITEARR_, ( name, JSONS_UNPACK_ arg ) )
+#define JSONS_FINITEARR_( name, kind, len )                    \
+    for( size_t i = 0; i < (len); ++i )                        \
+        if ( !JSONS_ISFINITE_##kind( src->name[ i ] ) ) return 0;
+#define JSONS_FINITEFIELD_( kind, name, arg ) JSONS_FINITE_##kind( name, arg )
+#define JSONS_FINITE_int( name, arg )
+#define JSONS_FINITE_uint( name, arg )
+#define JSONS_FINITE_long( name, arg )
+#define JSONS_FINITE_ulong( name, arg )
+#define JSONS_FINITE_verylong( name, arg )
+#define JSONS_FINITE_double( name, arg ) \
+    if ( !JSONS_ISFINITE_double( src->name ) ) return 0;
+#define JSONS_FINITE_bool( name, arg )
+#define JSONS_FINITE_str( name, arg )
+
+/* Field by field writing with the checked functions, in the way of the
+   classic functions with C or in the way of the writer with W. */
+#define JSONS_CCALL_( kind, name, value ) dest = json_##kind( dest, name, value, remLen );
+#define JSONS_WCALL_( kind, name, value ) jsonw_##kind( dest, name, value );
+#define JSONS_SLOW_int( m, name, arg )      JSONS_##m##CALL_( int, #name, src->name )
+#define JSONS_SLOW_uint( m, name, arg )     JSONS_##m##CALL_( uint, #name, src->name )
+#define JSONS_SLOW_long( m, name, arg )     JSONS_##m##CALL_( long, #name, src->name )
+#define JSONS_SLOW_ulong( m, name, arg )    JSONS_##m##CALL_( ulong, #name, src->name )
+#define JSONS_SLOW_verylong( m, name, arg ) JSONS_##m##CALL_( verylong, #name, src->name )
+#define JSONS_SLOW_double( m, name, arg )   JSONS_##m##CALL_( double, #name, src->name )
+#define JSONS_SLOW_bool( m, name, arg )     JSONS_##m##CALL_( bool, #name, src->name )
+#define JSONS_SLOW_str( m, name, arg )      JSONS_##m##CALL_( str, #name, src->name )
+#define JSONS_SLOW_obj( m, name, arg ) \
+    JSONS_##m##CALL_( schema_##arg, #name, &src->name )
+#define JSONS_SLOW_array( m, name, arg ) \
+    JSONS_APPLY_( JSONS_SLOWARR_, ( m, name, JSONS_UNPACK_ arg ) )
+#define JSONS_SLOWARR_( m, name, kind, len )                  \
+    JSONS_##m##OPEN_( #name );                                \
+    for( size_t i = 0; i < (len); ++i ) {                     \
+        JSONS_##m##CALL_( kind, NULL, src->name[ i ] )        \
+    }                                                         \
+    JSONS_##m##CLOSE_();
+#define JSONS_COPEN_( name ) dest = json_arrOpen( dest, name, remLen )
+#define JSONS_WOPEN_( name ) jsonw_arrOpen( dest, name )
+#define JSONS_CCLOSE_() dest = json_arrClose( dest, remLen )
+#define JSONS_WCLOSE_() jsonw_arrClose( dest )
+#define JSONS_SLOWFIELD_( kind, name, arg ) JSONS_SLOW_##kind( C, name, arg )
+#define JSONS_WSLOWFIELD_( kind, name, arg ) JSONS_SLOW_##kind( W, name, arg )
+
+/** Define the serializers of a struct. See the schema group.
+  * @param schema Name of the schema.
+  * @param type Type of the struct.
+  * @param FIELDS Macro that calls its argument for each field. */
+#define JSON_SCHEMA( schema, type, FIELDS )                                    \
+enum { json_schema_##schema##_max = 2 FIELDS( JSONS_MAXFIELD_ ) };             \
+                                                                               \
+static inline size_t json_schema_##schema##_bound( type const* src ) {         \
+    (void)src;                                                                 \
+    return 2 FIELDS( JSONS_LENFIELD_ );                                        \
+}                                                                              \
+                                                                               \
+static inline int json_schema_##schema##_finite( type const* src ) {          \
+    (void)src;                                                                 \
+    FIELDS( JSONS_FINITEFIELD_ )                                               \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+static inline char* json_schema_##schema##_fmt( char* p, type const* src ) {   \
+    char* const start = p;                                                     \
+    FIELDS( JSONS_FMTFIELD_ )                                                  \
+    if ( p == start )                                                          \
+        *p++ = '{';                                                            \
+    else                                                                       \
+        *start = '{';                                                          \
+    *p++ = '}';                                                                \
+    return p;                                                                  \
+}                                                                              \
+                                                                               \
+static inline char* json_schema_##schema( char* dest, char const* name,        \
+                                          type const* src, size_t* remLen ) {  \
+    if ( json_schema_##schema##_finite( src ) ) {                              \
+        size_t const len = json_schema_##schema##_bound( src ) + 1;            \
+        char* p = json_reserve( dest, name, len, remLen );                     \
+        if ( NULL != p ) {                                                     \
+            p = json_schema_##schema##_fmt( p, src );                          \
+            *p++ = ',';                                                        \
+            *p = '\0';                                                         \
+            *remLen -= p - dest;                                               \
+            return p;                                                          \
+        }                                                                      \
+    }                                                                          \
+    dest = json_objOpen( dest, name, remLen );                                 \
+    FIELDS( JSONS_SLOWFIELD_ )                                                 \
+    return json_objClose( dest, remLen );                                      \
+}                                                                              \
+                                                                               \
+static inline void jsonw_schema_##schema( jsonWriter_t* dest,                 \
+                                          char const* name,                    \
+                                          type const* src ) {                  \
+    if ( json_schema_##schema##_finite( src ) ) {                              \
+        size_t const len = json_schema_##schema##_bound( src );                \
+        char* p = jsonw_reserve( dest, name, len );                            \
+        if ( NULL != p ) {                                                     \
+            jsonw_commit( dest, json_schema_##schema##_fmt( p, src ) );        \
+            return;                                                            \
+        }                                                                      \
+    }                                                                          \
+    jsonw_objOpen( dest, name );                                               \
+    FIELDS( JSONS_WSLOWFIELD_ )                                                \
+    jsonw_objClose( dest );                                                    \
+}
+
+/** @ } */
+
+/** @defgroup arena Arena of memory blocks.
+  * A writer on an arena never runs out of room. The output is written in a
+  * chain of memory blocks that is extended without moving what was written,
+  * and that can be copied in one memory block or handed to writev().
+  * The blocks are kept between JSONs, so after the first ones are allocated
+  * the next JSONs of similar length do not allocate memory.
+  * @{ */
+
+/** Memory allocator of an arena. */
+typedef struct jsonAlloc_s {
+    void* (*alloc)( void* ctx, size_t size ); /**< Null if no memory. */
+    void  (*free)( void* ctx, void* ptr );
+    void* ctx;                                /**< First argument of both. */
+} jsonAlloc_t;
+
+/** Memory block of an arena. Its data is just after it. The block can also
+  * reference memory out of the arena, see jsonw_rawRef(). json_arenaIovec()
+  * and json_arenaFlatten() take it into account. */
+typedef struct jsonBlock_s {
+    struct jsonBlock_s* next; /**< Next block or null. */
+    size_t len;               /**< Length of the output in the block. */
+    size_t size;              /**< Size of the data of the block. */
+    size_t refs;              /**< Number of references to other memory. */
+} jsonBlock_t;
+
+/** Chain of memory blocks. The blocks from head to tail hold the last JSON
+  * and the blocks after tail are free. */
+typedef struct jsonArena_s {
+    jsonBlock_t* head;        /**< First block or null. */
+    jsonBlock_t* tail;        /**< Last block of the JSON or null. */
+    size_t blockSize;         /**< Minimum size of the new blocks. */
+    jsonAlloc_t const* alloc; /**< Allocator or null for malloc and free. */
+    int vector;               /**< Set by jsonw_initIovec(). */
+} jsonArena_t;
+
+#if defined(__unix__) || defined(__APPLE__)
+typedef struct iovec jsonIovec_t;
+#else
+typedef struct jsonIovec_s {
+    void*  iov_base;
+    size_t iov_len;
+} jsonIovec_t;
+#endif
+
+/** Initialize an empty arena.
+  * @param a The arena.
+  * @param blockSize Minimum size of the new blocks.
+  * @param alloc Allocator or null for malloc and free. With JSON_NO_MALLOC
+  *              defined it is mandatory. */
+JSON_API void json_arenaInit( jsonArena_t* a, size_t blockSize, jsonAlloc_t const* alloc );
+
+/** Release the memory blocks of an arena.
+  * @param a The arena. */
+JSON_API void json_arenaFree( jsonArena_t* a );
+
+/** Initialize a writer that writes in an arena. The previous JSON of the
+  * arena is discarded and its blocks are reused. The writer only overflows
+  * if the allocator fails.
+  * @param w The writer.
+  * @param a The arena. */
+JSON_API void jsonw_initArena( jsonWriter_t* w, jsonArena_t* a );
+
+/** Get the data of a memory block of an arena.
+  * @param b The block.
+  * @return Pointer to the data. */
+static inline char* json_blockData( jsonBlock_t const* b ) {
+    return (char*)( b + 1 );
+}
+
+/** Get the length of the JSON in an arena.
+  * @param a The arena.
+  * @return The length in bytes. */
+JSON_API size_t json_arenaLen( jsonArena_t const* a );
+
+/** Copy the JSON of an arena in a null-terminated string.
+  * @param a The arena.
+  * @param dest Destination memory block.
+  * @param size Size of dest. If it is short the JSON is truncated.
+  * @return The length of the JSON. */
+JSON_API size_t json_arenaFlatten( jsonArena_t const* a, char* dest, size_t size );
+
+/** Fill an array of iovec with the blocks of the JSON of an arena and the
+  * memory that they reference.
+  * @param a The arena.
+  * @param iov Destination array.
+  * @param max Length of iov.
+  * @return The number of pieces of the JSON. If it is greater than max
+  *         only max iovec are set. */
+JSON_API int json_arenaIovec( jsonArena_t const* a, jsonIovec_t* iov, int max );
+
+#ifndef JSON_MINREF
+/** Minimum length of the values that jsonw_rawRef() references. The shorter
+  * ones are copied, which is cheaper than a new iovec. */
+#define JSON_MINREF 256
+#endif
+
+/** Add a value that is already serialized, like jsonw_raw(). In a writer on
+  * an arena a value of JSON_MINREF bytes or more is not copied: the arena
+  * references it, and json_arenaIovec() points to it. Then the value must be
+  * kept, and not changed, until the JSON of the arena is used. In other
+  * writers the value is copied.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The text of the value.
+  * @param len Length of the text. */
+JSON_API void jsonw_rawRef( jsonWriter_t* w, char const* name, char const* value, size_t len );
+
+/** Initialize a writer that writes in an arena in vectored mode. It is as
+  * jsonw_initArena() but the runs of JSON_MINREF characters or more without
+  * escapes in the string values are not copied: the arena references them,
+  * and json_arenaIovec() points to them. The arena only keeps the
+  * punctuation, the names and the short or escaped text. The strings must
+  * be kept, and not changed, until the JSON of the arena is used.
+  * @param w The writer.
+  * @param a The arena. */
+JSON_API void jsonw_initIovec( jsonWriter_t* w, jsonArena_t* a );
+
+/** @ } */
+
+/** @defgroup parts Parts of a big array.
+  * A big array can be written by several threads. The caller splits it in
+  * ranges of elements and each thread writes its range with the usual jsonw
+  * functions, with a writer on its own arena initialized by jsonw_initPart().
+  * The elements of a part are written as in an array, without names and
+  * without the brackets. Then the parts are joined in order, with the commas
+  * between them, by json_joinIovec() without copying them, or by
+  * json_joinFlatten() in one pass. The library does not start threads and
+  * nothing is shared while the parts are written, so no lock is needed.
+  * @{ */
+
+/** Initialize a writer that writes a part of an array in an arena.
+  * @param w The writer.
+  * @param a The arena of the part. */
+JSON_API void jsonw_initPart( jsonWriter_t* w, jsonArena_t* a );
+
+/** Finish a part of an array.
+  * @param w The writer.
+  * @return The length of the part. */
+JSON_API size_t jsonw_endPart( jsonWriter_t* w );
+
+/** Get the length of the array of the parts.
+  * @param parts The arenas of the parts in order.
+  * @param n Number of parts.
+  * @return The length in bytes. */
+JSON_API size_t json_joinLen( jsonArena_t const* parts, size_t n );
+
+/** Copy the array of the parts in a null-terminated string.
+  * @param parts The arenas of the parts in order.
+  * @param n Number of parts.
+  * @param dest Destination memory block.
+  * @param size Size of dest. If it is short the JSON is truncated.
+  * @return The length of the JSON. */
+JSON_API size_t json_joinFlatten( jsonArena_t const* parts, size_t n, char* dest, size_t size );
+
+/** Fill an array of iovec with the array of the parts. The brackets and the
+  * commas point to static memory and the elements to the blocks of the
+  * arenas, so nothing is copied.
+  * @param parts The arenas of the parts in order.
+  * @param n Number of parts.
+  * @param iov Destination array.
+  * @param max Length of iov.
+  * @return The number of iovec of the JSON. If it is greater than max
+  *         only max are set. */
+JSON_API int json_joinIovec( jsonArena_t const* parts, size_t n, jsonIovec_t* iov, int max );
+
+/** @ } */
+
+/** @defgroup fragment Cached fragments.
+  * A fragment keeps a JSON value that rarely changes, such as the metadata
+  * of a device, serialized in a buffer, so that it is spliced in each JSON
+  * instead of being written again. It is written again only when the epoch
+  * of its source changes or when it is marked dirty.
+  * @code
+  * if ( json_fragmentStale( &f, device->version ) ) {
+  *     jsonw_initFragment( &fw, &f );
+  *     jsonw_device( &fw, NULL, device );
+  *     json_fragmentEnd( &f, &fw, device->version );
+  * }
+  * jsonw_fragment( &w, "device", &f );
+  * @endcode
+  * @{ */
+
+/** A JSON value serialized for an epoch of its source. */
+typedef struct jsonFragment_s {
+    char* buff;          /**< Buffer of the value. */
+    size_t size;         /**< Size of buff. */
+    size_t len;          /**< Length of the value or zero if it is dirty. */
+    unsigned long epoch; /**< Epoch of the source of the value. */
+} jsonFragment_t;
+
+/** Initialize a dirty fragment.
+  * @param f The fragment.
+  * @param buff Buffer of the value.
+  * @param size Size of buff. */
+JSON_API void json_fragmentInit( jsonFragment_t* f, char* buff, size_t size );
+
+/** Mark a fragment as dirty, so that it has to be written again.
+  * @param f The fragment. */
+static inline void json_fragmentDirty( jsonFragment_t* f ) {
+    f->len = 0;
+}
+
+/** Check if a fragment has to be written again.
+  * @param f The fragment.
+  * @param epoch The current epoch of its source.
+  * @return Non-zero if it is dirty or it was written for another epoch. */
+static inline int json_fragmentStale( jsonFragment_t const* f, unsigned long epoch ) {
+    return 0 == f->len || epoch != f->epoch;
+}
+
+/** Initialize a writer that writes the value of a fragment. The value is
+  * written as a root value, without a name. The fragment is dirty until
+  * json_fragmentEnd() is called.
+  * @param w The writer.
+  * @param f The fragment. */
+JSON_API void jsonw_initFragment( jsonWriter_t* w, jsonFragment_t* f );
+
+/** Finish the value of a fragment.
+  * @param f The fragment.
+  * @param w The writer initialized with jsonw_initFragment().
+  * @param epoch The epoch of the source of the value.
+  * @return Zero if the value is empty or the writer failed, e.g. the buffer
+  *         is short. Then the fragment stays dirty. */
+JSON_API int json_fragmentEnd( jsonFragment_t* f, jsonWriter_t* w, unsigned long epoch );
+
+/** Add the value of a fragment in a JSON string. If the fragment is dirty
+  * the JSON is truncated.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param f The fragment.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_fragment( char* dest, char const* name, jsonFragment_t const* f, size_t* remLen );
+
+/** Add the value of a fragment with jsonw_rawRef(), so in a writer on an
+  * arena a long value is referenced and the fragment must not be written
+  * again until the JSON of the arena is used. If the fragment is dirty it
+  * sets JSON_ERROR.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param f The fragment. */
+JSON_API void jsonw_fragment( jsonWriter_t* w, char const* name, jsonFragment_t const* f );
+
+/** @ } */
+
+/** @defgroup fixed Fixed-width numbers.
+  * A number of a fixed width takes the same room whatever its value, so it
+  * can be rewritten in place in the JSON already written without moving any
+  * other character. JSON does not allow leading zeros, so the numbers are
+  * padded with spaces on the left, and the reals are written with a fixed
+  * number of decimals padded with zeros on the right.
+  * @code
+  * jsonw_init( &w, buff, sizeof buff );
+  * jsonw_objOpen( &w, NULL );
+  * jsonw_str( &w, "device", "meter-7" );
+  * jsonw_fixedInt( &w, "seq", 0, 10, &seq );
+  * jsonw_fixedDouble( &w, "temp", 0, 8, 2, &temp );
+  * jsonw_objClose( &w );
+  * size_t const len = jsonw_end( &w );
+  * for( ;; ) {
+  *     json_patchInt( buff, &seq, n );
+  *     json_patchDouble( buff, &temp, t );
+  *     send( buff, len );
+  * }
+  * @endcode
+  * @{ */
+
+/** Max width of a fixed-width number. */
+#define JSON_FIXED_MAXWIDTH 32
+
+/** Max number of decimals of a fixed-width real. */
+#define JSON_FIXED_MAXDECIMALS 9
+
+/** Handle of a number of a fixed width in a JSON. */
+typedef struct jsonFixed_s {
+    size_t   offset;   /**< Offset of the first character from the start of the JSON. */
+    unsigned width;    /**< Number of characters, with the padding. */
+    int      decimals; /**< Digits after the point of a real, -1 for an integer. */
+} jsonFixed_t;
+
+/** Add an integer property of a fixed width.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The first value.
+  * @param width Number of characters of the value, 1 to JSON_FIXED_MAXWIDTH.
+  * @param f The handle of the value. Its offset counts from the start of
+  *          the output of the writer, the flushed blocks of a stream or an
+  *          arena included.
+  * @return Zero and JSON_ERROR if the width is wrong or the value does not
+  *         fit in it. Then nothing is written. */
+JSON_API int jsonw_fixedInt( jsonWriter_t* w, char const* name, long long value, unsigned width, jsonFixed_t* f );
+
+/** Add a real property of a fixed width and a fixed number of decimals. The
+  * exact value of the double is rounded half away from zero, so 2.675, which
+  * is a bit less, is written as 2.67 with two decimals, as printf does. NaN
+  * and infinities are written as JSON_NONFINITE selects.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param value The first value.
+  * @param width Number of characters of the value, 1 to JSON_FIXED_MAXWIDTH.
+  * @param decimals Digits after the point, 0 to JSON_FIXED_MAXDECIMALS.
+  * @param f The handle of the value. See jsonw_fixedInt().
+  * @return Zero and JSON_ERROR if the width or the decimals are wrong, or
+  *         the value does not fit. Then nothing is written. */
+JSON_API int jsonw_fixedDouble( jsonWriter_t* w, char const* name, double value, unsigned width, int decimals, jsonFixed_t* f );
+
+/** Add an integer property of a fixed width with a key. See jsonw_fixedInt(). */
+JSON_API int jsonw_fixedInt_k( jsonWriter_t* w, jsonKey_t const* key, long long value, unsigned width, jsonFixed_t* f );
+
+/** Add a real property of a fixed width with a key. See jsonw_fixedDouble(). */
+JSON_API int jsonw_fixedDouble_k( jsonWriter_t* w, jsonKey_t const* key, double value, unsigned width, int decimals, jsonFixed_t* f );
+
+/** Rewrite a fixed-width number in place with an integer.
+  * @param json The JSON that holds the number.
+  * @param f The handle of the number.
+  * @param value The new value. For a real it is written with its decimals.
+  * @return Zero if the value does not fit. Then the JSON is not changed. */
+JSON_API int json_patchInt( char* json, jsonFixed_t const* f, long long value );
+
+/** Rewrite a fixed-width number in place with a real, rounded to the
+  * decimals of the number. For an integer it is rounded to an integer.
+  * @param json The JSON that holds the number.
+  * @param f The handle of the number.
+  * @param value The new value.
+  * @return Zero if the value does not fit, or it is NaN or infinite with
+  *         JSON_NONFINITE_ERROR. Then the JSON is not changed. */
+JSON_API int json_patchDouble( char* json, jsonFixed_t const* f, double value );
+
+/** @ } */
+
+/** @defgroup template Templates.
+  * A template is a JSON value of a fixed shape written once with slots in
+  * place of some values. Each time it is written the text between the slots
+  * is copied as it is and only the values of the slots are formatted.
+  * @code
+  * jsonw_initTemplate( &tw, &t );
+  * jsonw_objOpen( &tw, NULL );
+  * jsonw_str( &tw, "device", "meter-7" );
+  * int const temp = jsonw_slot( &tw, &t, "temp", JSON_SLOT_DOUBLE );
+  * int const seq = jsonw_fixedSlot( &tw, &t, "seq", 10 );
+  * jsonw_objClose( &tw );
+  * json_templateEnd( &t, &tw );
+  * ...
+  * jsonValue_t values[ 2 ];
+  * values[ temp ].real = 21.5;
+  * json_templatePatch( &t, seq, n );
+  * p = json_template( p, "status", &t, values, &rem );
+  * @endcode
+  * @{ */
+
+/** Types of the slots of a template. */
+enum {
+    JSON_SLOT_INT,    /**< A long long in jsonValue_t.integer. */
+    JSON_SLOT_DOUBLE, /**< A double in jsonValue_t.real. */
+    JSON_SLOT_BOOL,   /**< A boolean in jsonValue_t.boolean. */
+    JSON_SLOT_STR,    /**< A null-terminated string in jsonValue_t.str. */
+    JSON_SLOT_FIXED   /**< An integer kept in the text. See jsonw_fixedSlot(). */
+};
+
+/** Value of a slot of a template. */
+typedef union jsonValue_u {
+    long long   integer; /**< For JSON_SLOT_INT. */
+    double      real;    /**< For JSON_SLOT_DOUBLE. */
+    int         boolean; /**< For JSON_SLOT_BOOL. */
+    char const* str;     /**< For JSON_SLOT_STR. */
+} jsonValue_t;
+
+/** A slot of a template. */
+typedef struct jsonSlot_s {
+    size_t offset; /**< Offset of the value in the text of the template. */
+    size_t width;  /**< Width of the value in the text, zero if it is not fixed. */
+    int    type;   /**< Type of the value. */
+} jsonSlot_t;
+
+/** A JSON value with slots. */
+typedef struct jsonTemplate_s {
+    char*       text;  /**< The text, without the values of the slots
+                            except the fixed ones. */
+    size_t      size;  /**< Size of text. */
+    size_t      len;   /**< Length of the text or zero if it is unfinished. */
+    jsonSlot_t* slots; /**< The slots in the order of the text. */
+    int         max;   /**< Number of elements of slots. */
+    int         count; /**< Number of slots in the template. */
+} jsonTemplate_t;
+
+/** Initialize an unfinished template.
+  * @param t The template.
+  * @param text Buffer of the text.
+  * @param size Size of text.
+  * @param slots Array of slots.
+  * @param max Number of elements of slots. */
+JSON_API void json_templateInit( jsonTemplate_t* t, char* text, size_t size, jsonSlot_t* slots, int max );
+
+/** Initialize a writer that writes the text of a template with the jsonw
+  * functions. The text is written as a root value, without a name. The
+  * template is unfinished until json_templateEnd() is called.
+  * @param w The writer.
+  * @param t The template. */
+JSON_API void jsonw_initTemplate( jsonWriter_t* w, jsonTemplate_t* t );
+
+/** Add a slot in the text of a template. Nothing is written in its place.
+  * @param w The writer initialized with jsonw_initTemplate() for t.
+  * @param t The template.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param type JSON_SLOT_INT, JSON_SLOT_DOUBLE, JSON_SLOT_BOOL or JSON_SLOT_STR.
+  * @return The index of the slot in the values of json_template() or -1 and
+  *         JSON_ERROR if the slots are exhausted or the type is wrong. */
+JSON_API int jsonw_slot( jsonWriter_t* w, jsonTemplate_t* t, char const* name, int type );
+
+/** Add a slot of an integer of a fixed width. It is written in the text as
+  * zero, padded with spaces on the left, and its value is only changed with
+  * json_templatePatch(), so the text does not move and a template without
+  * other slots is the whole JSON.
+  * @param w The writer initialized with jsonw_initTemplate() for t.
+  * @param t The template.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param width Number of characters of the value, from 1 to 32.
+  * @return The index of the slot or -1 and JSON_ERROR if the slots are
+  *         exhausted or the width is wrong. */
+JSON_API int jsonw_fixedSlot( jsonWriter_t* w, jsonTemplate_t* t, char const* name, unsigned width );
+
+/** Finish the text of a template.
+  * @param t The template.
+  * @param w The writer initialized with jsonw_initTemplate().
+  * @return Zero if the text is empty or the writer failed, e.g. the buffer
+  *         or the slots are short. Then the template stays unfinished. */
+JSON_API int json_templateEnd( jsonTemplate_t* t, jsonWriter_t* w );
+
+/** Write the value of a fixed slot in place in the text of a template,
+  * padded with spaces on the left. No other character moves.
+  * @param t The template.
+  * @param slot The index of a slot added with jsonw_fixedSlot().
+  * @param value The value.
+  * @return Zero if the slot is not fixed or the value does not fit in its
+  *         width. Then the text is not changed. */
+JSON_API int json_templatePatch( jsonTemplate_t* t, int slot, long long value );
+
+/** Add a template in a JSON string with the values of its slots. The text
+  * between the slots is copied in one go. If the template is unfinished, or
+  * a double is NaN or infinite with JSON_NONFINITE_ERROR, the JSON is
+  * truncated.
+  * @param dest Pointer to the end of JSON under construction.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param t The template.
+  * @param values The values indexed as the slots. The values of the fixed
+  *               slots are not read.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of JSON under construction. */
+JSON_API char* json_template( char* dest, char const* name, jsonTemplate_t const* t, jsonValue_t const* values, size_t* remLen );
+
+/** Add a template with the values of its slots. If the template is
+  * unfinished, or a value can not be written, it sets JSON_ERROR.
+  * @param w The writer.
+  * @param name Pointer to null-terminated string or null for unnamed.
+  * @param t The template.
+  * @param values The values indexed as the slots. The values of the fixed
+  *               slots are not read. */
+JSON_API void jsonw_template( jsonWriter_t* w, char const* name, jsonTemplate_t const* t, jsonValue_t const* values );
+
+/** @ } */
+
+/** @defgroup stream Stream.
+  * A writer on a stream writes in a fixed memory block and hands it to a
+  * callback each time it is full, so a JSON of any length is written to a
+  * file or a socket in constant memory.
+  * @{ */
+
+/** Callback that takes the output of a stream.
+  * @param ctx The context of the stream.
+  * @param data The output.
+  * @param len Length of the output.
+  * @return Zero if it failed. Then the writer stops as on an overflow. */
+typedef int (*jsonFlush_t)( void* ctx, char const* data, size_t len );
+
+/** State of a stream. */
+typedef struct jsonStream_s {
+    jsonFlush_t flush; /**< Callback. */
+    void*  ctx;        /**< First argument of the callback. */
+    char*  buff;       /**< Memory block of the writer. */
+    size_t size;       /**< Size of buff. */
+} jsonStream_t;
+
+/** Initialize a writer that writes in a stream.
+  * @param w The writer.
+  * @param s The stream. It must live as long as the writer.
+  * @param buff Memory block where the output is written before it is
+  *             flushed. It is not null-terminated.
+  * @param size Size of buff. JSON_MINBLOCK at least.
+  * @param flush Callback that takes the output.
+  * @param ctx First argument of the callback. */
+JSON_API void jsonw_initStream( jsonWriter_t* w, jsonStream_t* s, char* buff, size_t size, jsonFlush_t flush, void* ctx );
+
+/** @ } */
+
+/** @defgroup format Reformatter.
+  * The reformatter pretty-prints or minifies a JSON in one pass, in chunks
+  * of any length and without memory of its own, so a JSON written before
+  * or one that is still being written can be reformatted on the fly. A
+  * pretty writer reformats its output block by block as it fills it.
+  * @code
+  * jsonWriter_t out, w;
+  * jsonPretty_t pretty;
+  * jsonw_init( &out, buff, sizeof buff );
+  * jsonw_initPretty( &w, &pretty, &out, 2, "\n" );
+  * jsonw_objOpen( &w, NULL );
+  * ...
+  * jsonw_objClose( &w );
+  * jsonw_end( &w ); // Also ends out
+  * @endcode
+  * @{ */
+
+/** State of a reformatter between chunks. */
+typedef struct jsonFormat_s {
+    char const* newline; /**< Line break, or null to minify. */
+    size_t      nl;      /**< Length of the line break, zero to minify. */
+    unsigned    indent;  /**< Spaces of indentation for each nesting level. */
+    unsigned    depth;   /**< Nesting depth. */
+    int         state;   /**< Where the last chunk ended. */
+} jsonFormat_t;
+
+/** Initialize a reformatter.
+  * @param f The reformatter.
+  * @param indent Spaces of indentation for each nesting level.
+  * @param newline Line break, such as "\n" or "\r\n". If it is null or
+  *                empty the JSON is minified: all the white space is
+  *                removed. */
+JSON_API void json_formatInit( jsonFormat_t* f, unsigned indent, char const* newline );
+
+/** Add a chunk of a JSON reformatted in a writer. The chunks are the pieces
+  * of a valid JSON in order, split anywhere. Each value in an object or an
+  * array starts in a new line and each colon is followed by a space. The
+  * writer is used as a byte sink and its structure is not checked.
+  * @param w The writer.
+  * @param f The reformatter.
+  * @param src The chunk.
+  * @param len Length of the chunk. */
+JSON_API void jsonw_format( jsonWriter_t* w, jsonFormat_t* f, char const* src, size_t len );
+
+/** Add a chunk of a JSON reformatted in a string. See jsonw_format().
+  * @param dest Pointer to the end of the string under construction.
+  * @param f The reformatter.
+  * @param src The chunk.
+  * @param len Length of the chunk.
+  * @param remLen Pointer to remaining length of dest.
+  * @return Pointer to the new end of the string under construction. */
+JSON_API char* json_format( char* dest, jsonFormat_t* f, char const* src, size_t len, size_t* remLen );
+
+#ifndef JSON_PRETTYBLOCK
+/** Size of the block where a pretty writer writes before it reformats. */
+#define JSON_PRETTYBLOCK 256
+#endif
+
+/** State of a pretty writer. */
+typedef struct jsonPretty_s {
+    jsonFormat_t  format; /**< The reformatter. */
+    jsonWriter_t* out;    /**< The writer of the output. */
+    char block[ JSON_PRETTYBLOCK ]; /**< Block of the compact JSON. */
+} jsonPretty_t;
+
+/** Initialize a writer whose JSON is reformatted in another writer. It is
+  * written compact in a block and the block is reformatted each time it is
+  * full, so the compact writer pays nothing for the mode. jsonw_end() ends
+  * both writers and returns the length of the output of out. Then the
+  * status of out is added to the one of the writer.
+  * @param w The writer.
+  * @param p The state. It must live as long as the writer.
+  * @param out The writer of the output, such as a writer on a buffer, an
+  *            arena or a stream, or one that only measures.
+  * @param indent Spaces of indentation for each nesting level.
+  * @param newline Line break, or null or empty to minify. */
+JSON_API void jsonw_initPretty( jsonWriter_t* w, jsonPretty_t* p, jsonWriter_t* out, unsigned indent, char const* newline );
+
+/** @ } */
+
+/** @defgroup stats Instrumentation.
+  * When the library is compiled with JSON_STATS defined, each thread counts
+  * its calls by family of functions, the bytes that they write, the bytes
+  * that the escapes add, the writes that do not fit and the nesting depth.
+  * The cycles of one call in a given period can be sampled too. Without
+  * JSON_STATS nothing is counted, the functions below are still there and
+  * the counters stay at zero, so the same code builds in both ways.
+  * @code
+  * json_statsSample( 64 );           // In each thread
+  * ...
+  * jsonStats_t total = { 0 };
+  * json_statsCollect( &total );      // In each thread, under a lock
+  * @endcode
+  * @{ */
+
+/** Families of functions that are counted apart. */
+enum {
+    JSON_STATS_STRUCT,  /**< Open and close objects and arrays. */
+    JSON_STATS_STRING,  /**< Strings. */
+    JSON_STATS_INTEGER, /**< Integers of any width. */
+    JSON_STATS_REAL,    /**< Doubles. */
+    JSON_STATS_LITERAL, /**< Booleans, nulls and values already serialized. */
+    JSON_STATS_BINARY,  /**< Base64 and hexadecimal. */
+    JSON_STATS_ARRAY,   /**< Arrays of numbers or strings in one call. */
+    JSON_STATS_FAMILIES
+};
+
+/** Counters of a family of functions. A call made by another counted call,
+  * such as the open and close of an array in one call, adds to the calls
+  * of its family, and its bytes and cycles go to the outer call. */
+typedef struct jsonFamilyStats_s {
+    unsigned long long calls;   /**< Calls. */
+    unsigned long long bytes;   /**< Bytes written, the names included. */
+    unsigned long long cycles;  /**< Time stamp cycles of the sampled calls. */
+    unsigned long long samples; /**< Calls whose cycles were sampled. */
+} jsonFamilyStats_t;
+
+/** Counters of a thread or of several merged. */
+typedef struct jsonStats_s {
+    jsonFamilyStats_t family[ JSON_STATS_FAMILIES ]; /**< Indexed by family. */
+    unsigned long long names;       /**< Names written. */
+    unsigned long long nameBytes;   /**< Bytes of the names with quotes and colon. */
+    unsigned long long escapeBytes; /**< Bytes that escapes add to strings and names. */
+    unsigned long long truncations; /**< Writes cut short or dropped because they did not fit. */
+    unsigned maxDepth;              /**< Max nesting depth of objects and arrays. */
+} jsonStats_t;
+
+/** Sample the cycles of the calls of the thread that calls it.
+  * @param period One call of each period is timed, or none if zero, the
+  *               default. The time stamp counter is read on x86 and on
+  *               AArch64. Elsewhere no cycles are sampled. */
+JSON_API void json_statsSample( unsigned period );
+
+/** Get the counters of the thread that calls it. Other threads may merge them
+  * while it does not write, and they live as long as the thread.
+  * @return The counters. */
+JSON_API jsonStats_t const* json_statsThread( void );
+
+/** Add counters to others. The max depth is the max of both.
+  * @param total The counters to add to.
+  * @param stats The counters to add. */
+JSON_API void json_statsMerge( jsonStats_t* total, jsonStats_t const* stats );
+
+/** Add the counters of the thread that calls it to others and reset them.
+  * @param total The counters to add to. Its access must be synchronized if
+  *              several threads collect into it. */
+JSON_API void json_statsCollect( jsonStats_t* total );
 
 /** @ } */
 
@@ -158,3 +1788,9 @@ char* json_double( char* dest, char const* name, double value, size_t* remLen );
 
 #endif	/* MAKE_JSON_H */
 
+/* Header-only build: the translation unit that defines JSON_MAKER_IMPLEMENTATION
+   includes the definitions too. It must be compiled as C. */
+#if defined(JSON_MAKER_IMPLEMENTATION) && !defined(JSON_MAKER_C)
+#include "json-maker.c"
+#endif
+
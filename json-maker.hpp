@@ -0,0 +1,583 @@
+
+/*
+<https://github.com/rafagafe/tiny-json>
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+*/
+
+#ifndef MAKE_JSON_HPP
+#define	MAKE_JSON_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "json-maker.h"
+
+/** @file
+  * C++17 interface of the writer. Everything is inline and resolved at
+  * compile time: each value goes to the jsonw function of its exact type, the
+  * keys are encoded by the compiler and the scopes are closed by destructors,
+  * so a serializer written with it compiles to the same chain of calls that
+  * would be written by hand in C. */
+
+namespace jsonmaker {
+
+/** @defgroup cppkeys Keys encoded at compile time.
+  * @{ */
+
+/** Encode a property name as the text of a key: the name between quotes,
+  * with the escapes that the C library writes, and the colon. The bytes that
+  * are not ASCII are copied as JSON_UTF8_PASS does. Use json_keyInit() for
+  * names that the other policies must check.
+  * @param dest Destination of the text.
+  * @param size Size of dest.
+  * @param name The name.
+  * @param len Length of name.
+  * @return The length of the text.
+  * @throw std::length_error If the text does not fit in dest. In a constant
+  *        expression it is a compile error. */
+constexpr std::size_t encodeKey( char* dest, std::size_t size, char const* name, std::size_t len ) {
+    char const hex[] = "0123456789ABCDEF";
+    std::size_t n = 0;
+    auto put = [&]( char ch ) {
+        if ( n == size )
+            throw std::length_error( "jsonmaker: key too long" );
+        dest[ n++ ] = ch;
+    };
+    put( '\"' );
+    for( std::size_t i = 0; i < len; ++i ) {
+        unsigned char const ch = static_cast<unsigned char>( name[ i ] );
+        char esc = 0;
+        switch( ch ) {
+            case '\"': esc = '\"'; break;
+            case '\\': esc = '\\'; break;
+            case '/':  esc = '/';  break;
+            case '\b': esc = 'b';  break;
+            case '\t': esc = 't';  break;
+            case '\n': esc = 'n';  break;
+            case '\f': esc = 'f';  break;
+            case '\r': esc = 'r';  break;
+            default:   esc = ch < ' ' ? 'u' : 0; break;
+        }
+        if ( !esc )
+            put( name[ i ] );
+        else {
+            put( '\\' );
+            put( esc );
+            if ( esc == 'u' ) {
+                put( '0' );
+                put( '0' );
+                put( hex[ ch >> 4 ] );
+                put( hex[ ch & 0xF ] );
+            }
+        }
+    }
+    put( '\"' );
+    put( ':' );
+    return n;
+}
+
+/** A key that holds its own text. It is a jsonKey_t for the writers, so a
+  * static constexpr key is a constant address as a JSON_KEY() is in C.
+  * @tparam N Capacity of the text. */
+template< std::size_t N >
+class Key {
+public:
+
+    /** Encode a name. See encodeKey().
+      * @param name The name.
+      * @param len Length of name. */
+    constexpr Key( char const* name, std::size_t len ):
+        text_{}, key_{ text_, encodeKey( text_, N, name, len ) } { }
+
+    /** The copy points to its own text. */
+    constexpr Key( Key const& other ): text_{}, key_{ text_, other.key_.len } {
+        for( std::size_t i = 0; i < N; ++i )
+            text_[ i ] = other.text_[ i ];
+    }
+
+    Key& operator=( Key const& ) = delete;
+
+    /** Get the key for the C functions. */
+    constexpr operator jsonKey_t const&() const noexcept { return key_; }
+
+    /** Get the encoded text. */
+    constexpr std::string_view text() const noexcept { return { text_, key_.len }; }
+
+private:
+    char text_[ N ];
+    jsonKey_t key_;
+};
+
+/** Encode a name literal as a key. For example:
+  * static constexpr auto temp = jsonmaker::key( "temp" );
+  * @param name The name.
+  * @return The key, with room for a name with every byte escaped. */
+template< std::size_t N >
+constexpr Key< 6 * N > key( char const (&name)[ N ] ) {
+    return Key< 6 * N >( name, N - 1 );
+}
+
+namespace detail {
+
+/** The name of a key literal as a null-terminated array. */
+template< char... cs >
+struct KeyName {
+    static constexpr char name[] = { cs..., '\0' };
+};
+
+/** One key per name literal, encoded at compile time. */
+template< char... cs >
+inline constexpr Key< 6 * sizeof...( cs ) + 3 > keyOf{ KeyName< cs... >::name, sizeof...( cs ) };
+
+} // namespace detail
+
+namespace literals {
+
+#if defined( __GNUC__ )
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#if defined( __clang__ )
+#pragma GCC diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+
+/** Key literal, as "temp"_jk. Each name is encoded once at compile time in a
+  * static key, so the call passes a constant address. */
+template< class Char, Char... cs >
+constexpr jsonKey_t const& operator""_jk() noexcept {
+    static_assert( std::is_same_v< Char, char >, "Key literals are narrow strings" );
+    return detail::keyOf< cs... >;
+}
+
+#pragma GCC diagnostic pop
+
+#else
+
+/** Key literal, as "temp"_jk. The key lives until the end of the full
+  * expression. Declare it static constexpr to encode it at compile time. */
+constexpr Key< 256 > operator""_jk( char const* name, std::size_t len ) {
+    return Key< 256 >( name, len );
+}
+
+#endif
+
+} // namespace literals
+
+/** @ } */
+
+class JsonWriter;
+
+namespace detail {
+
+template< class T >
+inline constexpr bool dependentFalse = false;
+
+template< class T >
+struct isOptional: std::false_type { };
+
+template< class T >
+struct isOptional< std::optional< T > >: std::true_type { };
+
+template< class T >
+inline constexpr bool isCharacter = std::is_same_v< T, char >
+                                 || std::is_same_v< T, wchar_t >
+                                 || std::is_same_v< T, char16_t >
+                                 || std::is_same_v< T, char32_t >;
+
+/** True if the values of a type have jsonFields() found by ADL. */
+template< class T, class = void >
+struct hasFields: std::false_type { };
+
+template< class T >
+struct hasFields< T, std::void_t< decltype( jsonFields( std::declval< JsonWriter& >(),
+                                                        std::declval< T const& >() ) ) > >:
+    std::true_type { };
+
+template< class T, class = void >
+struct isRange: std::false_type { };
+
+template< class T >
+struct isRange< T, std::void_t< decltype( std::begin( std::declval< T const& >() ) ),
+                                decltype( std::end( std::declval< T const& >() ) ) > >:
+    std::true_type { };
+
+template< class T, class = void >
+struct isContiguous: std::false_type { };
+
+template< class T >
+struct isContiguous< T, std::void_t< decltype( std::data( std::declval< T const& >() ) ),
+                                     decltype( std::size( std::declval< T const& >() ) ) > >:
+    std::true_type { };
+
+/* The jsonw functions of each type of value, with a name or with a key. */
+
+#define JSON_MAKER_PUT( type, func )                                            \
+inline void put( jsonWriter_t* w, char const* name, type value ) noexcept {     \
+    jsonw_##func( w, name, value );                                             \
+}                                                                               \
+inline void put( jsonWriter_t* w, jsonKey_t const& key, type value ) noexcept { \
+    jsonw_##func##_k( w, &key, value );                                         \
+}
+
+JSON_MAKER_PUT( int, int )
+JSON_MAKER_PUT( unsigned int, uint )
+JSON_MAKER_PUT( long int, long )
+JSON_MAKER_PUT( unsigned long int, ulong )
+JSON_MAKER_PUT( long long int, verylong )
+JSON_MAKER_PUT( double, double )
+
+#undef JSON_MAKER_PUT
+
+inline void putBool( jsonWriter_t* w, char const* name, bool value ) noexcept {
+    jsonw_bool( w, name, value );
+}
+
+inline void putBool( jsonWriter_t* w, jsonKey_t const& key, bool value ) noexcept {
+    jsonw_bool_k( w, &key, value );
+}
+
+inline void putNull( jsonWriter_t* w, char const* name ) noexcept {
+    jsonw_null( w, name );
+}
+
+inline void putNull( jsonWriter_t* w, jsonKey_t const& key ) noexcept {
+    jsonw_null_k( w, &key );
+}
+
+inline void putStr( jsonWriter_t* w, char const* name, std::string_view value ) noexcept {
+    jsonw_strLen( w, name, value.data(), value.size() );
+}
+
+inline void putStr( jsonWriter_t* w, jsonKey_t const& key, std::string_view value ) noexcept {
+    jsonw_strLen_k( w, &key, value.data(), value.size() );
+}
+
+inline void putRaw( jsonWriter_t* w, char const* name, char const* value, std::size_t len ) noexcept {
+    jsonw_raw( w, name, value, len );
+}
+
+inline void putRaw( jsonWriter_t* w, jsonKey_t const& key, char const* value, std::size_t len ) noexcept {
+    jsonw_raw_k( w, &key, value, len );
+}
+
+inline void objOpen( jsonWriter_t* w, char const* name ) noexcept {
+    jsonw_objOpen( w, name );
+}
+
+inline void objOpen( jsonWriter_t* w, jsonKey_t const& key ) noexcept {
+    jsonw_objOpen_k( w, &key );
+}
+
+inline void arrOpen( jsonWriter_t* w, char const* name ) noexcept {
+    jsonw_arrOpen( w, name );
+}
+
+inline void arrOpen( jsonWriter_t* w, jsonKey_t const& key ) noexcept {
+    jsonw_arrOpen_k( w, &key );
+}
+
+/* The jsonw array functions of the types that have one. */
+
+inline void putArray( jsonWriter_t* w, char const* name, int const* v, std::size_t n ) noexcept {
+    jsonw_intArray( w, name, v, n );
+}
+
+inline void putArray( jsonWriter_t* w, char const* name, unsigned int const* v, std::size_t n ) noexcept {
+    jsonw_uintArray( w, name, v, n );
+}
+
+inline void putArray( jsonWriter_t* w, char const* name, long int const* v, std::size_t n ) noexcept {
+    jsonw_longArray( w, name, v, n );
+}
+
+inline void putArray( jsonWriter_t* w, char const* name, unsigned long int const* v, std::size_t n ) noexcept {
+    jsonw_ulongArray( w, name, v, n );
+}
+
+inline void putArray( jsonWriter_t* w, char const* name, long long int const* v, std::size_t n ) noexcept {
+    jsonw_verylongArray( w, name, v, n );
+}
+
+inline void putArray( jsonWriter_t* w, char const* name, double const* v, std::size_t n ) noexcept {
+    jsonw_doubleArray( w, name, v, n );
+}
+
+template< class T >
+inline constexpr bool hasArray = std::is_same_v< T, int >
+                              || std::is_same_v< T, unsigned int >
+                              || std::is_same_v< T, long int >
+                              || std::is_same_v< T, unsigned long int >
+                              || std::is_same_v< T, long long int >
+                              || std::is_same_v< T, double >;
+
+} // namespace detail
+
+/** @defgroup cppwriter Writer.
+  * @{ */
+
+/** A value with its name or key, to be written with operator<<. */
+template< class Name, class T >
+struct Named {
+    Name name;
+    T const& value;
+};
+
+/** Pair a value with a name for operator<<.
+  * @param name Null-terminated string.
+  * @param value The value. */
+template< class T >
+constexpr Named< char const*, T > named( char const* name, T const& value ) noexcept {
+    return { name, value };
+}
+
+/** Pair a value with a key for operator<<.
+  * @param key The key.
+  * @param value The value. */
+template< class T >
+constexpr Named< jsonKey_t const&, T > named( jsonKey_t const& key, T const& value ) noexcept {
+    return { key, value };
+}
+
+/** JSON writer. Each value is written by the jsonw function of its type:
+  * - bool, std::nullptr_t and std::nullopt.
+  * - Integers, by size: int, long or long long, and their unsigned types.
+  *   Plain characters are not numbers and they are rejected.
+  * - Floating point, as double.
+  * - Enumerations, as their underlying type.
+  * - Strings: std::string, std::string_view and character arrays and
+  *   pointers. A null pointer is written as null.
+  * - std::optional: null or the value.
+  * - Types with jsonFields( JsonWriter&, T const& ) found by ADL, as objects.
+  * - Ranges, as arrays. The contiguous ones of int, long, double... with a
+  *   name get the block path of the jsonw array functions. */
+class JsonWriter {
+public:
+
+    /** Scope of an object or an array. It is closed when it is destroyed. */
+    template< bool object >
+    class Scope {
+    public:
+        Scope( Scope const& ) = delete;
+        Scope& operator=( Scope const& ) = delete;
+        ~Scope() {
+            if constexpr ( object )
+                jsonw_objClose( w_ );
+            else
+                jsonw_arrClose( w_ );
+        }
+    private:
+        friend class JsonWriter;
+        explicit Scope( jsonWriter_t* w ) noexcept: w_( w ) { }
+        jsonWriter_t* w_;
+    };
+
+    using Object = Scope< true >;
+    using Array = Scope< false >;
+
+    /** Writer that only measures. See jsonw_measure(). */
+    JsonWriter() noexcept { jsonw_measure( &w_ ); }
+
+    /** Writer of a memory block. See jsonw_init(). */
+    JsonWriter( char* dest, std::size_t size ) noexcept { jsonw_init( &w_, dest, size ); }
+
+    /** Writer of an array. See jsonw_init(). */
+    template< std::size_t N >
+    explicit JsonWriter( char (&dest)[ N ] ) noexcept { jsonw_init( &w_, dest, N ); }
+
+    /** Writer of an arena. See jsonw_initArena(). */
+    explicit JsonWriter( jsonArena_t& a ) noexcept { jsonw_initArena( &w_, &a ); }
+
+    /** Writer of a stream. See jsonw_initStream(). */
+    JsonWriter( jsonStream_t& s, char* buff, std::size_t size, jsonFlush_t flush, void* ctx ) noexcept {
+        jsonw_initStream( &w_, &s, buff, size, flush, ctx );
+    }
+
+    JsonWriter( JsonWriter const& ) = delete;
+    JsonWriter& operator=( JsonWriter const& ) = delete;
+
+    /** Finish the JSON. See jsonw_end(). */
+    std::size_t end() noexcept { return jsonw_end( &w_ ); }
+
+    /** Get the status flags. Zero if every value has been written. */
+    int status() const noexcept { return jsonw_status( &w_ ); }
+
+    /** Get the size needed to hold the whole JSON. See jsonw_needed(). */
+    std::size_t needed() const noexcept { return jsonw_needed( &w_ ); }
+
+    /** Get the C writer, for the functions that this class does not wrap. */
+    jsonWriter_t* get() noexcept { return &w_; }
+
+    /** Open an object.
+      * @param name Null-terminated string or null for unnamed.
+      * @return The scope that closes it. */
+    [[nodiscard]] Object object( char const* name = nullptr ) noexcept {
+        jsonw_objOpen( &w_, name );
+        return Object( &w_ );
+    }
+
+    /** Open a named object with a key. */
+    [[nodiscard]] Object object( jsonKey_t const& key ) noexcept {
+        jsonw_objOpen_k( &w_, &key );
+        return Object( &w_ );
+    }
+
+    /** Open an array.
+      * @param name Null-terminated string or null for unnamed.
+      * @return The scope that closes it. */
+    [[nodiscard]] Array array( char const* name = nullptr ) noexcept {
+        jsonw_arrOpen( &w_, name );
+        return Array( &w_ );
+    }
+
+    /** Open a named array with a key. */
+    [[nodiscard]] Array array( jsonKey_t const& key ) noexcept {
+        jsonw_arrOpen_k( &w_, &key );
+        return Array( &w_ );
+    }
+
+    /** Add a property.
+      * @param name Null-terminated string.
+      * @param value The value.
+      * @return This writer. */
+    template< class T >
+    JsonWriter& field( char const* name, T const& value ) {
+        put( name, value );
+        return *this;
+    }
+
+    /** Add a property with a key. */
+    template< class T >
+    JsonWriter& field( jsonKey_t const& key, T const& value ) {
+        put( key, value );
+        return *this;
+    }
+
+    /** Add an unnamed value, as an item of an array or the whole JSON. */
+    template< class T >
+    JsonWriter& value( T const& value ) {
+        put( static_cast< char const* >( nullptr ), value );
+        return *this;
+    }
+
+    /** Add an unnamed value. */
+    template< class T >
+    JsonWriter& operator<<( T const& value ) {
+        return this->value( value );
+    }
+
+    /** Add a property paired with named(). */
+    template< class Name, class T >
+    JsonWriter& operator<<( Named< Name, T > const& property ) {
+        put( property.name, property.value );
+        return *this;
+    }
+
+private:
+
+    /** Write a value with a name or a key. */
+    template< class Name, class T >
+    void put( Name const& name, T const& value ) {
+        using U = std::remove_cv_t< T >;
+        if constexpr ( std::is_same_v< U, bool > )
+            detail::putBool( &w_, name, value );
+        else if constexpr ( std::is_same_v< U, std::nullptr_t > || std::is_same_v< U, std::nullopt_t > )
+            detail::putNull( &w_, name );
+        else if constexpr ( std::is_enum_v< U > )
+            put( name, static_cast< std::underlying_type_t< U > >( value ) );
+        else if constexpr ( detail::isCharacter< U > )
+            static_assert( detail::dependentFalse< U >, "Characters are not numbers: cast them or write a string" );
+        else if constexpr ( std::is_integral_v< U > && std::is_signed_v< U > ) {
+            if constexpr ( sizeof( U ) <= sizeof( int ) )
+                detail::put( &w_, name, static_cast< int >( value ) );
+            else if constexpr ( sizeof( U ) <= sizeof( long ) )
+                detail::put( &w_, name, static_cast< long >( value ) );
+            else if constexpr ( sizeof( U ) <= sizeof( long long ) )
+                detail::put( &w_, name, static_cast< long long >( value ) );
+            else
+                static_assert( detail::dependentFalse< U >, "Integer wider than long long" );
+        }
+        else if constexpr ( std::is_integral_v< U > ) {
+            if constexpr ( sizeof( U ) <= sizeof( unsigned int ) )
+                detail::put( &w_, name, static_cast< unsigned int >( value ) );
+            else if constexpr ( sizeof( U ) <= sizeof( unsigned long ) )
+                detail::put( &w_, name, static_cast< unsigned long >( value ) );
+            else if constexpr ( sizeof( U ) <= sizeof( unsigned long long ) ) {
+                char buff[ 24 ];
+                auto const r = std::to_chars( buff, buff + sizeof buff, value );
+                detail::putRaw( &w_, name, buff, static_cast< std::size_t >( r.ptr - buff ) );
+            }
+            else
+                static_assert( detail::dependentFalse< U >, "Integer wider than unsigned long long" );
+        }
+        else if constexpr ( std::is_floating_point_v< U > )
+            detail::put( &w_, name, static_cast< double >( value ) );
+        else if constexpr ( std::is_pointer_v< U > && std::is_convertible_v< U, std::string_view > ) {
+            if ( value )
+                detail::putStr( &w_, name, value );
+            else
+                detail::putNull( &w_, name );
+        }
+        else if constexpr ( std::is_convertible_v< U const&, std::string_view > )
+            detail::putStr( &w_, name, value );
+        else if constexpr ( detail::isOptional< U >::value ) {
+            if ( value )
+                put( name, *value );
+            else
+                detail::putNull( &w_, name );
+        }
+        else if constexpr ( detail::hasFields< U >::value ) {
+            detail::objOpen( &w_, name );
+            jsonFields( *this, value );
+            jsonw_objClose( &w_ );
+        }
+        else if constexpr ( detail::isRange< U >::value ) {
+            using E = std::remove_cv_t< std::remove_reference_t< decltype( *std::begin( value ) ) > >;
+            if constexpr ( detail::isContiguous< U >::value && detail::hasArray< E >
+                        && std::is_same_v< Name, char const* > )
+                detail::putArray( &w_, name, std::data( value ), std::size( value ) );
+            else {
+                detail::arrOpen( &w_, name );
+                for( auto const& item: value )
+                    put( static_cast< char const* >( nullptr ), item );
+                jsonw_arrClose( &w_ );
+            }
+        }
+        else
+            static_assert( detail::dependentFalse< U >, "No JSON for this type: declare jsonFields() for it" );
+    }
+
+    jsonWriter_t w_;
+};
+
+/** @ } */
+
+} // namespace jsonmaker
+
+#endif	/* MAKE_JSON_HPP */
@@ -0,0 +1,306 @@
+
+/*
+<https://github.com/rafagafe/tiny-json>
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  SPDX-License-Identifier: MIT
+  Copyright (c) 2018 Rafa Garcia <rafagarcia77@gmail.com>.
+
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+
+*/
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json-maker.hpp"
+
+using namespace jsonmaker;
+using namespace jsonmaker::literals;
+
+// ----------------------------------------------------- Test "framework": ---
+
+#define done() return 0
+#define fail() return __LINE__
+static int checkqty = 0;
+#define check( x ) do { ++checkqty; if (!(x)) fail(); } while ( 0 )
+
+struct test {
+    int(*func)(void);
+    char const* name;
+};
+
+static int test_suit( struct test const* tests, int numtests ) {
+    printf( "%s", "\n\nTests:\n" );
+    int failed = 0;
+    for( int i = 0; i < numtests; ++i ) {
+        printf( " %02d%s%-25s ", i, ": ", tests[i].name );
+        int linerr = tests[i].func();
+        if ( 0 == linerr )
+            printf( "%s", "OK\n" );
+        else {
+            printf( "%s%d\n", "Failed, line: ", linerr );
+            ++failed;
+        }
+    }
+    printf( "\n%s%d\n", "Total checks: ", checkqty );
+    printf( "%s[ %d / %d ]\r\n\n\n", "Tests PASS: ", numtests - failed, numtests );
+    return failed;
+}
+
+
+// ----------------------------------------------------------- Unit tests: ---
+
+/* The keys are encoded by the compiler. */
+static constexpr auto quoted = key( "a \"quoted\"\tname" );
+static_assert( key( "a \"quoted\"\tname" ).text() == "\"a \\\"quoted\\\"\\tname\":" );
+static_assert( key( "\x01/\\" ).text() == "\"\\u0001\\/\\\\\":" );
+static_assert( key( "" ).text() == "\"\":" );
+
+static int keys( void ) {
+    jsonKey_t const& temp = "temp"_jk;
+    check( temp.len == 7 && 0 == memcmp( temp.text, "\"temp\":", 7 ) );
+    check( &temp == &"temp"_jk );
+    for( int ch = 1; ch < 256; ++ch ) {
+        char const name[] = { 'a', (char)ch, 'b', '\0' };
+        char text[ 32 ];
+        jsonKey_t c;
+        size_t const len = json_keyInit( &c, name, text, sizeof text );
+        Key< 32 > const k( name, 3 );
+        check( k.text() == std::string_view( text, len ) );
+    }
+    check( quoted.text() == "\"a \\\"quoted\\\"\\tname\":" );
+    auto const copy = quoted;
+    jsonKey_t const& ck = copy;
+    check( ck.text != static_cast< jsonKey_t const& >( quoted ).text );
+    check( std::string_view( ck.text, ck.len ) == quoted.text() );
+    bool thrown = false;
+    try {
+        Key< 6 > const tiny( "\t\t", 2 );
+        (void)tiny;
+    }
+    catch( std::length_error const& ) {
+        thrown = true;
+    }
+    check( thrown );
+    done();
+}
+
+enum class level: short { low = -1, high = 7 };
+
+/* Each type goes to the function of its exact type. */
+static int scalars( void ) {
+    char buff[ 512 ];
+    JsonWriter w( buff );
+    {
+        auto const o = w.object();
+        w.field( "b", true )
+         .field( "n", nullptr )
+         .field( "i8", std::numeric_limits< std::int8_t >::min() )
+         .field( "u8", std::numeric_limits< std::uint8_t >::max() )
+         .field( "i16", std::numeric_limits< std::int16_t >::min() )
+         .field( "u16", std::numeric_limits< std::uint16_t >::max() )
+         .field( "i32", std::numeric_limits< std::int32_t >::min() )
+         .field( "u32", std::numeric_limits< std::uint32_t >::max() )
+         .field( "i64", std::numeric_limits< std::int64_t >::min() )
+         .field( "u64", std::numeric_limits< std::uint64_t >::max() )
+         .field( "ll", std::numeric_limits< long long >::min() )
+         .field( "ull", std::numeric_limits< unsigned long long >::max() )
+         .field( "f", 0.5f )
+         .field( "d", 0.25 )
+         .field( "e", level::low )
+         .field( "nan", std::numeric_limits< double >::quiet_NaN() );
+    }
+    check( w.end() == strlen( buff ) );
+    check( 0 == w.status() );
+    static char const rslt[] = "{\"b\":true,\"n\":null,\"i8\":-128,\"u8\":255,"
+        "\"i16\":-32768,\"u16\":65535,\"i32\":-2147483648,\"u32\":4294967295,"
+        "\"i64\":-9223372036854775808,\"u64\":18446744073709551615,"
+        "\"ll\":-9223372036854775808,\"ull\":18446744073709551615,"
+        "\"f\":0.5,\"d\":0.25,\"e\":-1,\"nan\":null}";
+    check( 0 == strcmp( buff, rslt ) );
+    done();
+}
+
+static int strings( void ) {
+    char buff[ 256 ];
+    JsonWriter w( buff );
+    std::string const s( "a\0b", 3 );
+    char const* const null = nullptr;
+    char mutable_[] = "m";
+    std::optional< int > none;
+    std::optional< std::string > some( "x" );
+    {
+        auto const a = w.array();
+        w << std::array< int, 0 >();
+        w << "lit\n" << s << std::string_view( "view" ) << null << mutable_
+          << none << some << std::nullopt;
+    }
+    w.end();
+    check( 0 == w.status() );
+    check( 0 == strcmp( buff, "[[],\"lit\\n\",\"a\\u0000b\",\"view\",null,\"m\",null,\"x\",null]" ) );
+    done();
+}
+
+static int ranges( void ) {
+    char buff[ 512 ];
+    JsonWriter w( buff );
+    std::vector< int > const ints = { 1, -2, 3 };
+    std::array< double, 2 > const reals = { 0.5, -1 };
+    short const shorts[] = { 4, 5 };
+    std::list< std::string > const names = { "a", "b" };
+    std::vector< std::vector< unsigned > > const nested = { { 1, 2 }, { }, { 3 } };
+    std::vector< bool > const flags = { true, false };
+    {
+        auto const o = w.object();
+        w.field( "ints", ints )
+         .field( "ints"_jk, ints )
+         .field( "reals", reals )
+         .field( "shorts", shorts )
+         .field( "names", names )
+         .field( "nested", nested )
+         .field( "flags", flags );
+    }
+    w.end();
+    static char const rslt[] = "{\"ints\":[1,-2,3],\"ints\":[1,-2,3],\"reals\":[0.5,-1],"
+        "\"shorts\":[4,5],\"names\":[\"a\",\"b\"],\"nested\":[[1,2],[],[3]],"
+        "\"flags\":[true,false]}";
+    check( 0 == strcmp( buff, rslt ) );
+    done();
+}
+
+/* The document of example.c, with its structures. */
+namespace example {
+
+struct Weather {
+    int temp;
+    int hum;
+};
+
+struct Time {
+    int hour;
+    int minute;
+};
+
+struct Measure {
+    Time time;
+    Weather weather;
+};
+
+struct Data {
+    char const* city;
+    char const* street;
+    std::vector< Measure > measures;
+    std::array< int, 4 > samples;
+};
+
+static void jsonFields( JsonWriter& w, Weather const& v ) {
+    w.field( "temp"_jk, v.temp ).field( "hum"_jk, v.hum );
+}
+
+static void jsonFields( JsonWriter& w, Time const& v ) {
+    w.field( "hour"_jk, v.hour ).field( "minute"_jk, v.minute );
+}
+
+static void jsonFields( JsonWriter& w, Measure const& v ) {
+    w << named( "time"_jk, v.time ) << named( "weather"_jk, v.weather );
+}
+
+static void jsonFields( JsonWriter& w, Data const& v ) {
+    w.field( "city"_jk, v.city )
+     .field( "street"_jk, v.street )
+     .field( "measures"_jk, v.measures )
+     .field( "samples", v.samples );
+}
+
+static Data const sample = {
+    "liverpool", "mathew",
+    { { { 8, 20 }, { 18, 20 } }, { { 16, 4 }, { 13, 22 } } },
+    { 1, 2, 3, 4 }
+};
+
+} // namespace example
+
+/* The same document with the C functions. */
+static size_t cdata( char* buff, size_t size, example::Data const& d ) {
+    jsonWriter_t w;
+    jsonw_init( &w, buff, size );
+    jsonw_objOpen( &w, NULL );
+    jsonw_str( &w, "city", d.city );
+    jsonw_str( &w, "street", d.street );
+    jsonw_arrOpen( &w, "measures" );
+    for( auto const& m: d.measures ) {
+        jsonw_objOpen( &w, NULL );
+        jsonw_objOpen( &w, "time" );
+        jsonw_int( &w, "hour", m.time.hour );
+        jsonw_int( &w, "minute", m.time.minute );
+        jsonw_objClose( &w );
+        jsonw_objOpen( &w, "weather" );
+        jsonw_int( &w, "temp", m.weather.temp );
+        jsonw_int( &w, "hum", m.weather.hum );
+        jsonw_objClose( &w );
+        jsonw_objClose( &w );
+    }
+    jsonw_arrClose( &w );
+    jsonw_intArray( &w, "samples", d.samples.data(), d.samples.size() );
+    jsonw_objClose( &w );
+    return jsonw_end( &w );
+}
+
+static int aggregates( void ) {
+    char expected[ 512 ];
+    size_t const len = cdata( expected, sizeof expected, example::sample );
+    char buff[ 512 ];
+    JsonWriter w( buff );
+    w << example::sample;
+    check( len == w.end() );
+    check( 0 == strcmp( buff, expected ) );
+    JsonWriter m;
+    m << example::sample;
+    m.end();
+    check( 0 == m.status() );
+    check( m.needed() == len + 1 );
+    for( size_t cap = 1; cap < len; ++cap ) {
+        JsonWriter t( buff, cap );
+        t << example::sample;
+        t.end();
+        check( 0 != t.status() );
+        check( t.needed() == len + 1 );
+        check( strlen( buff ) < cap && 0 == strncmp( buff, expected, strlen( buff ) ) );
+    }
+    done();
+}
+
+int main( void ) {
+    static struct test const tests[] = {
+        { keys,       "Keys"                     },
+        { scalars,    "Scalars"                  },
+        { strings,    "Strings and optionals"    },
+        { ranges,     "Ranges"                   },
+        { aggregates, "Aggregates"               },
+    };
+    return test_suit( tests, sizeof tests / sizeof *tests );
+}
@@ -31,8 +31,18 @@
 #include <string.h>
 #include <stdint.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <math.h>
 #include "json-maker.h"
 
+#ifndef JSON_UTF8
+#define JSON_UTF8 JSON_UTF8_PASS
+#endif
+
+#ifndef JSON_NONFINITE
+#define JSON_NONFINITE JSON_NONFINITE_NULL
+#endif
+
 // ----------------------------------------------------- Test "framework": ---
 
 #define done() return 0
@@ -68,10 +78,11 @@ static int test_suit( struct test const* tests, int numtests ) {
 
 static int escape( void ) {
     char buff[512];
-    char* p = json_objOpen( buff, NULL );
-    p = json_str( p, "name", "\tHello: \"man\"\n" );
-    p = json_objClose( p );
-    p = json_end( p );
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_str( p, "name", "\tHello: \"man\"\n", &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
     printf( "\n\n%s\n\n", buff );
     static char const rslt[] = "{\"name\":\"\\tHello: \\\"man\\\"\\n\"}";
     check( p - buff == sizeof rslt - 1 );
@@ -79,12 +90,1739 @@ static int escape( void ) {
     done();
 }
 
+/* Reference escape of a character as json_str() has to do it. */
+static char* refesc( char* dest, unsigned char ch ) {
+    static char const spec[] = "\"\\/\b\f\n\r\t";
+    static char const code[] = "\"\\/bfnrt";
+    char const* pos = strchr( spec, ch );
+    if ( '\0' != ch && NULL != pos )
+        return dest + sprintf( dest, "\\%c", code[ pos - spec ] );
+    if ( ch < ' ' )
+        return dest + sprintf( dest, "\\u%04X", ch );
+    *dest = ch;
+    return dest + 1;
+}
+
+static int allchars( void ) {
+    char src[ 384 ];
+    char buff[ 2048 ];
+    char rslt[ sizeof buff ];
+    for( int off = 0; off < 64; ++off ) {
+        int i = 0;
+        for( ; i < off; ++i )
+            src[i] = 'a';
+        /* Lone bytes that are not ASCII are invalid UTF-8 for the other policies. */
+        for( int ch = 1; ch < ( JSON_UTF8 == JSON_UTF8_PASS ? 256 : 128 ); ++ch )
+            src[i++] = ch;
+        for( int j = 0; j < off; ++j )
+            src[i++] = 'b';
+        src[i] = '\0';
+        char* r = rslt;
+        *r++ = '\"';
+        for( int j = 0; j < i; ++j )
+            r = refesc( r, src[j] );
+        r += sprintf( r, "%s", "\"," );
+        size_t rem = sizeof buff - 1;
+        char* p = json_str( buff, NULL, src, &rem );
+        check( p - buff == r - rslt );
+        check( 0 == strcmp( buff, rslt ) );
+    }
+    done();
+}
+
+static int truncation( void ) {
+    static char const value[] = "0123456789abcdef\"0123456789abcdef\n";
+    char full[ 128 ];
+    size_t rem = sizeof full - 1;
+    char* end = json_str( full, "name", value, &rem );
+    int const fulllen = end - full;
+    for( int cap = 0; cap <= fulllen; ++cap ) {
+        char buff[ 128 ];
+        memset( buff, '#', sizeof buff );
+        rem = cap;
+        char* p = json_str( buff, "name", value, &rem );
+        check( p - buff == cap );
+        check( 0 == rem );
+        check( 0 == memcmp( buff, full, cap ) );
+        check( '\0' == buff[ cap ] && '#' == buff[ cap + 1 ] );
+    }
+    done();
+}
+
+/* Build a document with every function. */
+static char* document( char* dest, size_t* remLen ) {
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_str( dest, "name", "\"value\"", remLen );
+    dest = json_arrOpen( dest, "array", remLen );
+    dest = json_int( dest, NULL, -1, remLen );
+    dest = json_uint( dest, NULL, 2, remLen );
+    dest = json_long( dest, NULL, -3, remLen );
+    dest = json_ulong( dest, NULL, 4, remLen );
+    dest = json_verylong( dest, NULL, -5, remLen );
+    dest = json_double( dest, NULL, 0.5, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_objOpen( dest, "object", remLen );
+    dest = json_bool( dest, "true", 1, remLen );
+    dest = json_bool( dest, "false", 0, remLen );
+    dest = json_null( dest, "null", remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static int capacity( void ) {
+    static char const rslt[] = "{\"name\":\"\\\"value\\\"\","
+                                "\"array\":[-1,2,-3,4,-5,0.5],"
+                                "\"object\":{\"true\":true,\"false\":false,\"null\":null}}";
+    for( int cap = 0; cap < 2 * sizeof rslt; ++cap ) {
+        char buff[ 2 * sizeof rslt + 2 ];
+        memset( buff, '#', sizeof buff );
+        buff[0] = '\0';
+        size_t rem = cap;
+        char* p = document( buff + 1, &rem );
+        check( p - ( buff + 1 ) == cap - rem );
+        check( '\0' == *p && '#' == buff[ cap + 2 ] );
+        if ( cap >= sizeof rslt - 1 ) {
+            check( 0 == strcmp( buff + 1, rslt ) );
+            check( cap - rem == sizeof rslt - 1 );
+        }
+    }
+    done();
+}
+
+/* Build the same document with a writer. */
+static void wdocument( jsonWriter_t* w ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_str( w, "name", "\"value\"" );
+    jsonw_arrOpen( w, "array" );
+    jsonw_int( w, NULL, -1 );
+    jsonw_uint( w, NULL, 2 );
+    jsonw_long( w, NULL, -3 );
+    jsonw_ulong( w, NULL, 4 );
+    jsonw_verylong( w, NULL, -5 );
+    jsonw_double( w, NULL, 0.5 );
+    jsonw_arrClose( w );
+    jsonw_objOpen( w, "object" );
+    jsonw_bool( w, "true", 1 );
+    jsonw_bool( w, "false", 0 );
+    jsonw_null( w, "null" );
+    jsonw_objClose( w );
+    jsonw_objClose( w );
+}
+
+static int overflow( void ) {
+    char full[ 256 ];
+    size_t rem = sizeof full - 1;
+    size_t const len = document( full, &rem ) - full;
+    for( size_t size = 0; size < 2 * len; ++size ) {
+        char buff[ 512 ];
+        memset( buff, '#', sizeof buff );
+        jsonWriter_t w;
+        jsonw_init( &w, buff, size );
+        wdocument( &w );
+        size_t const rslt = jsonw_end( &w );
+        check( jsonw_needed( &w ) == len + 1 );
+        check( '#' == buff[ size ] );
+        if ( size > len ) {
+            check( 0 == jsonw_status( &w ) );
+            check( rslt == len );
+            check( 0 == strcmp( buff, full ) );
+        }
+        else {
+            check( JSON_OVERFLOW == jsonw_status( &w ) );
+            check( 0 == size || rslt < size );
+            check( 0 == size || 0 == memcmp( buff, full, rslt ) );
+        }
+    }
+    done();
+}
+
+static int measure( void ) {
+    char full[ 256 ];
+    size_t rem = sizeof full - 1;
+    size_t const len = document( full, &rem ) - full;
+    jsonWriter_t w;
+    jsonw_measure( &w );
+    wdocument( &w );
+    check( 0 == jsonw_end( &w ) );
+    check( 0 == jsonw_status( &w ) );
+    check( jsonw_needed( &w ) == len + 1 );
+    static char const value[] = "\x01\"\\/\b\f\n\r\t 0123456789abcdef0123456789abcdef\x1F";
+    char buff[ 128 ];
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_str( &w, NULL, value );
+    check( 0 == jsonw_status( &w ) );
+    size_t const written = jsonw_end( &w );
+    jsonw_measure( &w );
+    jsonw_str( &w, NULL, value );
+    check( jsonw_needed( &w ) == written + 1 );
+    done();
+}
+
+/* Allocator that counts its calls. */
+static void* countalloc( void* ctx, size_t size ) {
+    ++((int*)ctx)[ 0 ];
+    return malloc( size );
+}
+
+static void countfree( void* ctx, void* ptr ) {
+    ++((int*)ctx)[ 1 ];
+    free( ptr );
+}
+
+/* Build a document long enough to take many blocks. */
+static void warena( jsonWriter_t* w ) {
+    jsonw_arrOpen( w, NULL );
+    for( int i = 0; i < 20; ++i ) {
+        wdocument( w );
+        jsonw_objOpen( w, NULL );
+        jsonw_str( w, "a somewhat long name", "\x01\"\\/\b\f\n\r\t 0123456789abcdef" );
+        jsonw_double( w, "pi", 3.141592653589793 );
+        jsonw_objClose( w );
+    }
+    jsonw_arrClose( w );
+}
+
+static int arena( void ) {
+    static char full[ 8192 ];
+    jsonWriter_t w;
+    jsonw_init( &w, full, sizeof full );
+    warena( &w );
+    size_t const len = jsonw_end( &w );
+    check( 0 == jsonw_status( &w ) );
+    int counts[ 2 ] = { 0, 0 };
+    jsonAlloc_t const alloc = { countalloc, countfree, counts };
+    jsonArena_t a;
+    json_arenaInit( &a, 0, &alloc );
+    for( int r = 0; r < 3; ++r ) {
+        jsonw_initArena( &w, &a );
+        warena( &w );
+        check( len == jsonw_end( &w ) );
+        check( 0 == jsonw_status( &w ) );
+        check( len + 1 == jsonw_needed( &w ) );
+        check( len == json_arenaLen( &a ) );
+        static char buff[ sizeof full ];
+        check( len == json_arenaFlatten( &a, buff, sizeof buff ) );
+        check( 0 == strcmp( buff, full ) );
+        check( len == json_arenaFlatten( &a, buff, 8 ) );
+        check( 0 == memcmp( buff, full, 7 ) && '\0' == buff[ 7 ] );
+        jsonIovec_t iov[ 64 ];
+        int const count = json_arenaIovec( &a, iov, 64 );
+        check( 1 < count && count <= 64 );
+        size_t total = 0;
+        for( int i = 0; i < count; ++i ) {
+            check( 0 == memcmp( iov[ i ].iov_base, full + total, iov[ i ].iov_len ) );
+            total += iov[ i ].iov_len;
+        }
+        check( len == total );
+        check( count == counts[ 0 ] );
+    }
+    json_arenaFree( &a );
+    check( counts[ 0 ] == counts[ 1 ] );
+    done();
+}
+
+/* Output of a stream collected in memory. */
+struct collect {
+    char data[ 8192 ];
+    size_t len;
+    int calls;
+    int fail;
+};
+
+static int collectflush( void* ctx, char const* data, size_t len ) {
+    struct collect* const c = ctx;
+    if ( c->calls++ == c->fail )
+        return 0;
+    memcpy( c->data + c->len, data, len );
+    c->len += len;
+    return 1;
+}
+
+static int stream( void ) {
+    static char full[ 8192 ];
+    jsonWriter_t w;
+    jsonw_init( &w, full, sizeof full );
+    warena( &w );
+    size_t const len = jsonw_end( &w );
+    static struct collect c;
+    for( size_t size = JSON_MINBLOCK; size < 300; size += 7 ) {
+        c.len = 0;
+        c.calls = 0;
+        c.fail = -1;
+        char buff[ 300 ];
+        jsonStream_t s;
+        jsonw_initStream( &w, &s, buff, size, collectflush, &c );
+        warena( &w );
+        check( len == jsonw_end( &w ) );
+        check( 0 == jsonw_status( &w ) );
+        check( len == c.len );
+        check( 0 == memcmp( c.data, full, len ) );
+        check( (size_t)c.calls >= len / size );
+    }
+    c.len = 0;
+    c.calls = 0;
+    c.fail = 3;
+    char buff[ 64 ];
+    jsonStream_t s;
+    jsonw_initStream( &w, &s, buff, sizeof buff, collectflush, &c );
+    warena( &w );
+    jsonw_end( &w );
+    check( JSON_OVERFLOW == jsonw_status( &w ) );
+    check( 4 == c.calls );
+    check( jsonw_needed( &w ) == len + 1 );
+    done();
+}
+
+static int misuse( void ) {
+    char buff[ 512 ];
+    jsonWriter_t w;
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_arrOpen( &w, NULL );
+    for( int i = 0; i < JSON_MAXDEPTH + 8; ++i )
+        jsonw_objOpen( &w, 0 == i ? NULL : "o" );
+    for( int i = 0; i < JSON_MAXDEPTH + 8; ++i )
+        jsonw_objClose( &w );
+    jsonw_arrClose( &w );
+    jsonw_end( &w );
+    check( 0 == jsonw_status( &w ) );
+#ifndef NDEBUG
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_objOpen( &w, NULL );
+    jsonw_int( &w, NULL, 1 );
+    check( JSON_MISUSE == jsonw_status( &w ) );
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_arrOpen( &w, NULL );
+    jsonw_null( &w, "name" );
+    check( JSON_MISUSE == jsonw_status( &w ) );
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_str( &w, "name", "root" );
+    check( JSON_MISUSE == jsonw_status( &w ) );
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_arrOpen( &w, NULL );
+    jsonw_objClose( &w );
+    check( JSON_MISUSE == jsonw_status( &w ) );
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_arrClose( &w );
+    check( JSON_MISUSE == jsonw_status( &w ) );
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_objOpen( &w, NULL );
+    jsonw_end( &w );
+    check( JSON_MISUSE == jsonw_status( &w ) );
+#endif
+    done();
+}
+
+struct point {
+    int x;
+    int y;
+};
+
+#define POINT( X ) \
+    X( int, x, 0 ) \
+    X( int, y, 0 )
+
+JSON_SCHEMA( point, struct point, POINT )
+
+struct sample {
+    char const* name;
+    struct point pos;
+    unsigned int id;
+    long l;
+    unsigned long ul;
+    long long ll;
+    double value;
+    int ok;
+    int ints[ 3 ];
+    double reals[ 2 ];
+};
+
+#define SAMPLE( X )                  \
+    X( str,      name,  0 )          \
+    X( obj,      pos,   point )      \
+    X( uint,     id,    0 )          \
+    X( long,     l,     0 )          \
+    X( ulong,    ul,    0 )          \
+    X( verylong, ll,    0 )          \
+    X( double,   value, 0 )          \
+    X( bool,     ok,    0 )          \
+    X( array,    ints,  ( int, 3 ) ) \
+    X( array,    reals, ( double, 2 ) )
+
+JSON_SCHEMA( sample, struct sample, SAMPLE )
+
+/* The example of the README. */
+struct weather {
+    int temp;
+    int hum;
+};
+
+struct time {
+    int hour;
+    int minute;
+};
+
+struct measure {
+    struct weather weather;
+    struct time time;
+};
+
+#define WEATHER( X ) \
+    X( int, temp, 0 ) \
+    X( int, hum,  0 )
+
+JSON_SCHEMA( weather, struct weather, WEATHER )
+
+#define TIME( X ) \
+    X( int, hour,   0 ) \
+    X( int, minute, 0 )
+
+JSON_SCHEMA( time, struct time, TIME )
+
+#define MEASURE( X )             \
+    X( obj, weather, weather )   \
+    X( obj, time,    time )
+
+JSON_SCHEMA( measure, struct measure, MEASURE )
+
+/* Schemas without fields and with an array without elements. */
+struct empty {
+    int ints[ 1 ];
+};
+
+#define NOFIELD( X )
+
+JSON_SCHEMA( nofield, struct empty, NOFIELD )
+
+#define NOELEM( X ) \
+    X( array, ints, ( int, 0 ) )
+
+JSON_SCHEMA( noelem, struct empty, NOELEM )
+
+/* The same serializer written by hand. */
+static char* handsample( char* dest, char const* name, struct sample const* src, size_t* remLen ) {
+    dest = json_objOpen( dest, name, remLen );
+    dest = json_str( dest, "name", src->name, remLen );
+    dest = json_objOpen( dest, "pos", remLen );
+    dest = json_int( dest, "x", src->pos.x, remLen );
+    dest = json_int( dest, "y", src->pos.y, remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_uint( dest, "id", src->id, remLen );
+    dest = json_long( dest, "l", src->l, remLen );
+    dest = json_ulong( dest, "ul", src->ul, remLen );
+    dest = json_verylong( dest, "ll", src->ll, remLen );
+    dest = json_double( dest, "value", src->value, remLen );
+    dest = json_bool( dest, "ok", src->ok, remLen );
+    dest = json_arrOpen( dest, "ints", remLen );
+    for( int i = 0; i < 3; ++i )
+        dest = json_int( dest, NULL, src->ints[ i ], remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_arrOpen( dest, "reals", remLen );
+    for( int i = 0; i < 2; ++i )
+        dest = json_double( dest, NULL, src->reals[ i ], remLen );
+    dest = json_arrClose( dest, remLen );
+    return json_objClose( dest, remLen );
+}
+
+static int parts( void ) {
+    jsonArena_t a[ 4 ];
+    for( int i = 0; i < 4; ++i )
+        json_arenaInit( &a[ i ], 0, NULL );
+    static char const rslt[] = "[{\"i\":0},{\"i\":1},{\"i\":2},{\"i\":3},{\"i\":4},{\"i\":5},{\"i\":6}]";
+    static int const first[] = { 0, 3, 3, 4, 7 };
+    for( int p = 0; p < 4; ++p ) {
+        jsonWriter_t w;
+        jsonw_initPart( &w, &a[ p ] );
+        for( int i = first[ p ]; i < first[ p + 1 ]; ++i ) {
+            jsonw_objOpen( &w, NULL );
+            jsonw_int( &w, "i", i );
+            jsonw_objClose( &w );
+        }
+        jsonw_endPart( &w );
+        check( 0 == jsonw_status( &w ) );
+    }
+    size_t const len = sizeof rslt - 1;
+    check( len == json_joinLen( a, 4 ) );
+    char buff[ 128 ];
+    for( size_t size = 0; size < sizeof rslt + 2; ++size ) {
+        buff[ size ] = '#';
+        check( len == json_joinFlatten( a, 4, buff, size ) );
+        check( '#' == buff[ size ] );
+        check( 0 == size || ( strlen( buff ) == size - 1 && 0 == memcmp( buff, rslt, size - 1 ) ) || 0 == strcmp( buff, rslt ) );
+    }
+    jsonIovec_t iov[ 16 ];
+    int const count = json_joinIovec( a, 4, iov, 16 );
+    check( 16 > count );
+    check( count == json_joinIovec( a, 4, NULL, 0 ) );
+    jsonIovec_t short3[ 3 ];
+    check( count == json_joinIovec( a, 4, short3, 3 ) );
+    check( 0 == memcmp( short3, iov, sizeof short3 ) );
+    size_t pos = 0;
+    for( int i = 0; i < count; ++i ) {
+        check( 0 == memcmp( rslt + pos, iov[ i ].iov_base, iov[ i ].iov_len ) );
+        pos += iov[ i ].iov_len;
+    }
+    check( len == pos );
+    check( 2 == json_joinLen( a + 1, 1 ) );
+    check( 2 == json_joinFlatten( a + 1, 1, buff, sizeof buff ) );
+    check( 0 == strcmp( buff, "[]" ) );
+    jsonWriter_t w;
+    jsonw_initPart( &w, &a[ 0 ] );
+    jsonw_int( &w, "named", 1 );
+    jsonw_endPart( &w );
+#ifndef NDEBUG
+    check( JSON_MISUSE & jsonw_status( &w ) );
+#endif
+    jsonw_initPart( &w, &a[ 0 ] );
+    jsonw_arrOpen( &w, NULL );
+    jsonw_endPart( &w );
+#ifndef NDEBUG
+    check( JSON_MISUSE & jsonw_status( &w ) );
+#endif
+    for( int i = 0; i < 4; ++i )
+        json_arenaFree( &a[ i ] );
+    done();
+}
+
+static int schema( void ) {
+    static struct sample const samples[] = {
+        { "\"quoted\"\n", { 1, -2 }, 3, -4, 5, -6, 0.1, 1, { 7, 8, 9 }, { 1e21, -0.0 } },
+        { "\x01\x1F\\", { INT_MIN, INT_MIN }, UINT_MAX, LONG_MIN, ULONG_MAX, LLONG_MIN,
+          -2.2250738585072014e-308, 0, { INT_MIN, INT_MIN, INT_MIN },
+          { -1.2345678901234567e-300, -1.2345678901234567e-7 } },
+        { "nonfinite", { 0, 0 }, 0, 0, 0, 0, NAN, 1, { 0, 0, 0 }, { INFINITY, -INFINITY } }
+    };
+    for( size_t i = 0; i < sizeof samples / sizeof *samples; ++i ) {
+        struct sample const* const sample = &samples[ i ];
+        char full[ 512 ];
+        size_t rem = sizeof full - 1;
+        char* p = handsample( full, NULL, sample, &rem );
+        p = json_end( p, &rem );
+        size_t const len = p - full;
+        check( len <= json_schema_sample_bound( sample ) );
+        char buff[ 512 ];
+        size_t const pointlen = json_schema_point_fmt( buff, &sample->pos ) - buff;
+        check( pointlen <= json_schema_point_max );
+        for( size_t cap = 0; cap < len + 8; ++cap ) {
+            char hand[ 512 ];
+            hand[ 0 ] = buff[ 0 ] = '#';
+            size_t handrem = cap;
+            p = handsample( hand + 1, NULL, sample, &handrem );
+            p = json_end( p, &handrem );
+            size_t const handlen = p - ( hand + 1 );
+            rem = cap;
+            p = json_schema_sample( buff + 1, NULL, sample, &rem );
+            p = json_end( p, &rem );
+            check( p - ( buff + 1 ) == handlen );
+            check( rem == handrem );
+            check( 0 == memcmp( buff, hand, handlen + 2 ) );
+            jsonWriter_t w;
+            jsonw_init( &w, buff, cap + 1 );
+            jsonw_schema_sample( &w, NULL, sample );
+            if ( JSON_NONFINITE == JSON_NONFINITE_ERROR && 2 == i ) {
+                check( JSON_ERROR & jsonw_status( &w ) );
+                continue;
+            }
+            check( len == jsonw_end( &w ) || cap < len );
+            check( jsonw_needed( &w ) == len + 1 );
+            check( ( cap < len ) == ( 0 != jsonw_status( &w ) ) );
+            check( cap < len || 0 == strcmp( buff, full ) );
+        }
+    }
+    static struct measure const measure = { { -5, 48 }, { 18, 32 } };
+    static char const rslt[] = "{\"weather\":{\"temp\":-5,\"hum\":48},\"time\":{\"hour\":18,\"minute\":32}}";
+    char buff[ 128 ];
+    size_t rem = sizeof buff;
+    char* p = json_schema_measure( buff, NULL, &measure, &rem );
+    p = json_end( p, &rem );
+    check( 0 == strcmp( buff, rslt ) );
+    check( sizeof rslt - 1 <= json_schema_measure_bound( &measure ) );
+    jsonWriter_t w;
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_schema_measure( &w, NULL, &measure );
+    check( sizeof rslt - 1 == jsonw_end( &w ) );
+    check( 0 == jsonw_status( &w ) && 0 == strcmp( buff, rslt ) );
+    static struct empty const empty = { { 1 } };
+    static char const nofield[] = "[{},{\"ints\":[]}]";
+    for( size_t cap = 0; cap < sizeof nofield + 8; ++cap ) {
+        size_t const len = sizeof nofield - 1;
+        char hand[ 128 ];
+        hand[ 0 ] = buff[ 0 ] = '#';
+        size_t handrem = cap;
+        p = json_arrOpen( hand + 1, NULL, &handrem );
+        p = json_objOpen( p, NULL, &handrem );
+        p = json_objClose( p, &handrem );
+        p = json_objOpen( p, NULL, &handrem );
+        p = json_arrOpen( p, "ints", &handrem );
+        p = json_arrClose( p, &handrem );
+        p = json_objClose( p, &handrem );
+        p = json_arrClose( p, &handrem );
+        p = json_end( p, &handrem );
+        size_t const handlen = p - ( hand + 1 );
+        rem = cap;
+        p = json_arrOpen( buff + 1, NULL, &rem );
+        p = json_schema_nofield( p, NULL, &empty, &rem );
+        p = json_schema_noelem( p, NULL, &empty, &rem );
+        p = json_arrClose( p, &rem );
+        p = json_end( p, &rem );
+        check( p - ( buff + 1 ) == handlen && rem == handrem );
+        check( 0 == memcmp( buff, hand, handlen + 2 ) );
+        check( cap < len || 0 == strcmp( buff + 1, nofield ) );
+        jsonw_init( &w, buff, cap );
+        jsonw_arrOpen( &w, NULL );
+        jsonw_schema_nofield( &w, NULL, &empty );
+        jsonw_schema_noelem( &w, NULL, &empty );
+        jsonw_arrClose( &w );
+        check( len == jsonw_end( &w ) || cap <= len );
+        check( ( cap <= len ) == ( 0 != jsonw_status( &w ) ) );
+        check( cap <= len || 0 == strcmp( buff, nofield ) );
+    }
+    check( 2 <= json_schema_nofield_bound( &empty ) );
+    check( 2 <= json_schema_nofield_max );
+    check( sizeof ",\"ints\":[]" - 1 <= json_schema_noelem_max );
+    done();
+}
+
+/* A document with plain names and the same with keys. */
+static char* plaindoc( char* dest, size_t* remLen ) {
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_objOpen( dest, "a \"quoted\"\tname", remLen );
+    dest = json_arrOpen( dest, "arr", remLen );
+    dest = json_int( dest, NULL, -1, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_str( dest, "str", "value", remLen );
+    dest = json_bool( dest, "bool", 1, remLen );
+    dest = json_null( dest, "null", remLen );
+    dest = json_uint( dest, "uint", 2, remLen );
+    dest = json_long( dest, "long", -3, remLen );
+    dest = json_ulong( dest, "ulong", 4, remLen );
+    dest = json_verylong( dest, "verylong", -5, remLen );
+    dest = json_double( dest, "double", 0.5, remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static jsonKey_t k_quoted;
+static jsonKey_t const k_arr = JSON_KEY( "arr" );
+static jsonKey_t const k_str = JSON_KEY( "str" );
+static jsonKey_t const k_bool = JSON_KEY( "bool" );
+static jsonKey_t const k_null = JSON_KEY( "null" );
+static jsonKey_t const k_uint = JSON_KEY( "uint" );
+static jsonKey_t const k_long = JSON_KEY( "long" );
+static jsonKey_t const k_ulong = JSON_KEY( "ulong" );
+static jsonKey_t const k_verylong = JSON_KEY( "verylong" );
+static jsonKey_t const k_double = JSON_KEY( "double" );
+
+static char* keydoc( char* dest, size_t* remLen ) {
+    dest = json_objOpen_k( dest, NULL, remLen );
+    dest = json_objOpen_k( dest, &k_quoted, remLen );
+    dest = json_arrOpen_k( dest, &k_arr, remLen );
+    dest = json_int_k( dest, NULL, -1, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_str_k( dest, &k_str, "value", remLen );
+    dest = json_bool_k( dest, &k_bool, 1, remLen );
+    dest = json_null_k( dest, &k_null, remLen );
+    dest = json_uint_k( dest, &k_uint, 2, remLen );
+    dest = json_long_k( dest, &k_long, -3, remLen );
+    dest = json_ulong_k( dest, &k_ulong, 4, remLen );
+    dest = json_verylong_k( dest, &k_verylong, -5, remLen );
+    dest = json_double_k( dest, &k_double, 0.5, remLen );
+    dest = json_objClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static void wkeydoc( jsonWriter_t* w ) {
+    jsonw_objOpen_k( w, NULL );
+    jsonw_objOpen_k( w, &k_quoted );
+    jsonw_arrOpen_k( w, &k_arr );
+    jsonw_int_k( w, NULL, -1 );
+    jsonw_arrClose( w );
+    jsonw_str_k( w, &k_str, "value" );
+    jsonw_bool_k( w, &k_bool, 1 );
+    jsonw_null_k( w, &k_null );
+    jsonw_uint_k( w, &k_uint, 2 );
+    jsonw_long_k( w, &k_long, -3 );
+    jsonw_ulong_k( w, &k_ulong, 4 );
+    jsonw_verylong_k( w, &k_verylong, -5 );
+    jsonw_double_k( w, &k_double, 0.5 );
+    jsonw_objClose( w );
+    jsonw_objClose( w );
+}
+
+static int keys( void ) {
+    static char text[ 32 ];
+    char const* const name = "a \"quoted\"\tname";
+    check( 0 == json_keyInit( &k_quoted, name, text, 20 ) );
+    check( 21 == json_keyInit( &k_quoted, name, text, sizeof text ) );
+    check( 0 == memcmp( text, "\"a \\\"quoted\\\"\\tname\":", 21 ) );
+    char full[ 256 ];
+    size_t rem = sizeof full - 1;
+    size_t const len = plaindoc( full, &rem ) - full;
+    static char const rslt[] = "{\"a \\\"quoted\\\"\\tname\":{\"arr\":[-1],\"str\":\"value\","
+        "\"bool\":true,\"null\":null,\"uint\":2,\"long\":-3,\"ulong\":4,"
+        "\"verylong\":-5,\"double\":0.5}}";
+    check( 0 == strcmp( full, rslt ) );
+    for( size_t cap = 0; cap < len + 4; ++cap ) {
+        char plain[ 256 ];
+        char key[ 256 ];
+        plain[ 0 ] = key[ 0 ] = '#';
+        size_t plainrem = cap;
+        size_t const plainlen = plaindoc( plain + 1, &plainrem ) - ( plain + 1 );
+        rem = cap;
+        check( plainlen == (size_t)( keydoc( key + 1, &rem ) - ( key + 1 ) ) );
+        check( rem == plainrem );
+        check( 0 == memcmp( plain, key, plainlen + 2 ) );
+        jsonWriter_t w;
+        jsonw_init( &w, key, cap + 1 );
+        wkeydoc( &w );
+        jsonw_end( &w );
+        check( jsonw_needed( &w ) == len + 1 );
+        check( cap < len || 0 == strcmp( key, full ) );
+    }
+    jsonArena_t a;
+    json_arenaInit( &a, 0, NULL );
+    jsonWriter_t w;
+    jsonw_initArena( &w, &a );
+    jsonw_arrOpen( &w, NULL );
+    for( int i = 0; i < 4; ++i ) {
+        jsonw_objOpen( &w, NULL );
+        jsonw_null( &w, "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0A" );
+        jsonw_objClose( &w );
+    }
+    jsonw_arrClose( &w );
+    char buff[ 512 ];
+    check( jsonw_end( &w ) == json_arenaFlatten( &a, buff, sizeof buff ) );
+    json_arenaFree( &a );
+    static char const first[] = "[{\"\\u0001\\u0002\\u0003\\u0004\\u0005\\u0006\\u0007\\b\\t\\n\":null},";
+    check( 0 == strncmp( buff, first, sizeof first - 1 ) );
+    done();
+}
+
+struct reading {
+    char const* tag;
+    int level;
+    double value;
+};
+
+static struct reading const readings[] = {
+    { "a",      -2147483647 - 1, 0.1     },
+    { "b\"",    42,              -1e300  },
+    { "\n",     0,               5e-324  },
+    { "long",   2147483647,      1.5     },
+    { "",       -7,              0       },
+    { "\x01",   1000000,         123.456 },
+};
+
+enum { numreadings = sizeof readings / sizeof *readings };
+
+static char* loopdoc( char* dest, size_t* remLen ) {
+    static long long const big[] = { LLONG_MIN, 0, LLONG_MAX };
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_arrOpen( dest, "levels", remLen );
+    for( int i = 0; i < numreadings; ++i )
+        dest = json_int( dest, NULL, readings[ i ].level, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_arrOpen( dest, "values", remLen );
+    for( int i = 0; i < numreadings; ++i )
+        dest = json_double( dest, NULL, readings[ i ].value, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_arrOpen( dest, "tags", remLen );
+    for( int i = 0; i < numreadings; ++i )
+        dest = json_str( dest, NULL, readings[ i ].tag, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_arrOpen( dest, "big", remLen );
+    for( int i = 0; i < 3; ++i )
+        dest = json_verylong( dest, NULL, big[ i ], remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_arrOpen( dest, "none", remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static char* bulkdoc( char* dest, size_t* remLen ) {
+    static long long const big[] = { LLONG_MIN, 0, LLONG_MAX };
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_intStride( dest, "levels", &readings->level, numreadings, sizeof *readings, remLen );
+    dest = json_doubleStride( dest, "values", &readings->value, numreadings, sizeof *readings, remLen );
+    dest = json_strStride( dest, "tags", &readings->tag, numreadings, sizeof *readings, remLen );
+    dest = json_verylongArray( dest, "big", big, 3, remLen );
+    dest = json_uintArray( dest, "none", NULL, 0, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static void wbulkdoc( jsonWriter_t* w ) {
+    static long long const big[] = { LLONG_MIN, 0, LLONG_MAX };
+    jsonw_objOpen( w, NULL );
+    jsonw_intStride( w, "levels", &readings->level, numreadings, sizeof *readings );
+    jsonw_doubleStride( w, "values", &readings->value, numreadings, sizeof *readings );
+    jsonw_strStride( w, "tags", &readings->tag, numreadings, sizeof *readings );
+    jsonw_verylongArray( w, "big", big, 3 );
+    jsonw_uintArray( w, "none", NULL, 0 );
+    jsonw_objClose( w );
+}
+
+static int bulk( void ) {
+    char full[ 512 ];
+    size_t rem = sizeof full - 1;
+    size_t const len = loopdoc( full, &rem ) - full;
+    check( 0 != rem );
+    static char const begin[] = "{\"levels\":[-2147483648,42,0,2147483647,-7,1000000],"
+        "\"values\":[0.1,-1e+300,5e-324,1.5,0,123.456],";
+    check( 0 == strncmp( full, begin, sizeof begin - 1 ) );
+    for( size_t cap = 0; cap < len + 4; ++cap ) {
+        char loop[ 512 ];
+        char blk[ 512 ];
+        loop[ 0 ] = blk[ 0 ] = '#';
+        size_t looprem = cap;
+        size_t const looplen = loopdoc( loop + 1, &looprem ) - ( loop + 1 );
+        rem = cap;
+        check( looplen == (size_t)( bulkdoc( blk + 1, &rem ) - ( blk + 1 ) ) );
+        check( rem == looprem );
+        check( 0 == memcmp( loop, blk, looplen + 2 ) );
+        jsonWriter_t w;
+        jsonw_init( &w, blk, cap + 1 );
+        wbulkdoc( &w );
+        jsonw_end( &w );
+        check( jsonw_needed( &w ) == len + 1 );
+        check( cap < len || 0 == strcmp( blk, full ) );
+    }
+    jsonArena_t a;
+    json_arenaInit( &a, 0, NULL );
+    jsonWriter_t w;
+    jsonw_initArena( &w, &a );
+    wbulkdoc( &w );
+    check( len == jsonw_end( &w ) );
+    check( 0 == jsonw_status( &w ) );
+    char buff[ 512 ];
+    check( len == json_arenaFlatten( &a, buff, sizeof buff ) );
+    check( 0 == strcmp( buff, full ) );
+    json_arenaFree( &a );
+    done();
+}
+
+static char* rawdoc( char* dest, char const* meta, size_t len, size_t* remLen ) {
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_int( dest, "seq", 7, remLen );
+    dest = json_raw( dest, "meta", meta, len, remLen );
+    dest = json_arrOpen( dest, "list", remLen );
+    dest = json_raw( dest, NULL, "[1,2]", 5, remLen );
+    dest = json_raw_k( dest, NULL, "null", 4, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static void wrawdoc( jsonWriter_t* w, jsonFragment_t const* meta ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_int( w, "seq", 7 );
+    jsonw_fragment( w, "meta", meta );
+    jsonw_arrOpen( w, "list" );
+    jsonw_raw( w, NULL, "[1,2]", 5 );
+    jsonw_raw_k( w, NULL, "null", 4 );
+    jsonw_arrClose( w );
+    jsonw_objClose( w );
+}
+
+static int fragments( void ) {
+    static char metabuff[ 512 ];
+    jsonFragment_t meta;
+    json_fragmentInit( &meta, metabuff, sizeof metabuff );
+    check( json_fragmentStale( &meta, 0 ) );
+    jsonWriter_t w;
+    jsonw_initFragment( &w, &meta );
+    jsonw_objOpen( &w, NULL );
+    for( int i = 0; i < 20; ++i )
+        jsonw_int( &w, "field", 10000 + i );
+    jsonw_objClose( &w );
+    check( json_fragmentEnd( &meta, &w, 3 ) );
+    check( !json_fragmentStale( &meta, 3 ) );
+    check( json_fragmentStale( &meta, 4 ) );
+    check( JSON_MINREF <= meta.len );
+    char full[ 1024 ];
+    size_t rem = sizeof full - 1;
+    size_t const len = rawdoc( full, meta.buff, meta.len, &rem ) - full;
+    check( 0 != rem );
+    static char const head[] = "{\"seq\":7,\"meta\":{\"field\":10000,";
+    check( 0 == strncmp( full, head, sizeof head - 1 ) );
+    static char const tail[] = "\"field\":10019},\"list\":[[1,2],null]}";
+    check( 0 == strcmp( full + len - ( sizeof tail - 1 ), tail ) );
+    for( size_t cap = 0; cap < len + 4; ++cap ) {
+        char buff[ 1024 ];
+        buff[ 0 ] = '#';
+        rem = cap;
+        char* const end = json_fragment( json_int( json_objOpen( buff + 1, NULL, &rem ), "seq", 7, &rem ), "meta", &meta, &rem );
+        size_t const head = end - ( buff + 1 );
+        check( head <= len && 0 == memcmp( buff + 1, full, head ) );
+        jsonw_init( &w, buff, cap + 1 );
+        wrawdoc( &w, &meta );
+        jsonw_end( &w );
+        check( jsonw_needed( &w ) == len + 1 );
+        check( cap < len || 0 == strcmp( buff, full ) );
+    }
+    jsonArena_t a;
+    json_arenaInit( &a, 64, NULL );
+    for( int r = 0; r < 2; ++r ) {
+        jsonw_initArena( &w, &a );
+        wrawdoc( &w, &meta );
+        check( len == jsonw_end( &w ) );
+        check( 0 == jsonw_status( &w ) );
+        check( len == json_arenaLen( &a ) );
+        char buff[ 1024 ];
+        check( len == json_arenaFlatten( &a, buff, sizeof buff ) );
+        check( 0 == strcmp( buff, full ) );
+        jsonIovec_t iov[ 16 ];
+        int const count = json_arenaIovec( &a, iov, 16 );
+        check( count <= 16 );
+        int referenced = 0;
+        size_t pos = 0;
+        for( int i = 0; i < count; ++i ) {
+            check( 0 != iov[ i ].iov_len );
+            check( 0 == memcmp( full + pos, iov[ i ].iov_base, iov[ i ].iov_len ) );
+            referenced += metabuff == iov[ i ].iov_base && meta.len == iov[ i ].iov_len;
+            pos += iov[ i ].iov_len;
+        }
+        check( len == pos );
+        check( 1 == referenced );
+    }
+    json_arenaFree( &a );
+    json_fragmentDirty( &meta );
+    check( json_fragmentStale( &meta, 3 ) );
+    char buff[ 64 ];
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_fragment( &w, NULL, &meta );
+    check( JSON_ERROR & jsonw_status( &w ) );
+    meta.size = 8;
+    jsonw_initFragment( &w, &meta );
+    jsonw_str( &w, NULL, "too long for the fragment" );
+    check( !json_fragmentEnd( &meta, &w, 5 ) );
+    check( json_fragmentStale( &meta, 5 ) );
+    done();
+}
+
+static void wpayload( jsonWriter_t* w, char const* big, char const* mixed ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_str( w, "short", "clean" );
+    jsonw_str( w, "big", big );
+    jsonw_str( w, "mixed", mixed );
+    jsonw_nstr( w, "prefix", big, 300 );
+    jsonw_objClose( w );
+}
+
+static int vectored( void ) {
+    static char big[ 1000 ];
+    static char mixed[ 1000 ];
+    for( int i = 0; i < 999; ++i ) {
+        big[ i ] = 'a' + i % 26;
+        mixed[ i ] = 'A' + i % 26;
+    }
+    mixed[ 100 ] = '\n';
+    mixed[ 500 ] = '\"';
+    mixed[ 998 ] = '\\';
+    static char full[ 4096 ];
+    jsonWriter_t w;
+    jsonw_init( &w, full, sizeof full );
+    wpayload( &w, big, mixed );
+    size_t const len = jsonw_end( &w );
+    check( 0 == jsonw_status( &w ) );
+    jsonArena_t a;
+    json_arenaInit( &a, 64, NULL );
+    for( int r = 0; r < 2; ++r ) {
+        jsonw_initIovec( &w, &a );
+        wpayload( &w, big, mixed );
+        check( len == jsonw_end( &w ) );
+        check( 0 == jsonw_status( &w ) );
+        static char buff[ sizeof full ];
+        check( len == json_arenaFlatten( &a, buff, sizeof buff ) );
+        check( 0 == strcmp( buff, full ) );
+        jsonIovec_t iov[ 32 ];
+        int const count = json_arenaIovec( &a, iov, 32 );
+        check( count <= 32 );
+        size_t pos = 0;
+        size_t referenced = 0;
+        for( int i = 0; i < count; ++i ) {
+            check( 0 == memcmp( full + pos, iov[ i ].iov_base, iov[ i ].iov_len ) );
+            char const* const base = iov[ i ].iov_base;
+            if ( ( base >= big && base < big + sizeof big ) || ( base >= mixed && base < mixed + sizeof mixed ) )
+                referenced += iov[ i ].iov_len;
+            pos += iov[ i ].iov_len;
+        }
+        check( len == pos );
+        check( 999 + 300 + 497 + 399 == referenced );
+    }
+    jsonw_initArena( &w, &a );
+    wpayload( &w, big, mixed );
+    check( len == jsonw_end( &w ) );
+    jsonIovec_t iov[ 32 ];
+    int const count = json_arenaIovec( &a, iov, 32 );
+    for( int i = 0; i < count; ++i )
+        check( (char const*)iov[ i ].iov_base < big || (char const*)iov[ i ].iov_base >= big + sizeof big );
+    json_arenaFree( &a );
+    done();
+}
+
+static char const nulname[] = "a\0b";
+static char const nulvalue[] = "x\0y\"z\0";
+
+static char* sizeddoc( char* dest, jsonKey_t const* key, size_t* remLen ) {
+    dest = json_objOpen( dest, NULL, remLen );
+    dest = json_strLen( dest, "v", nulvalue, sizeof nulvalue - 1, remLen );
+    dest = json_strLen_k( dest, key, nulvalue, 3, remLen );
+    dest = json_strLen( dest, "empty", nulvalue, 0, remLen );
+    dest = json_objClose( dest, remLen );
+    return json_end( dest, remLen );
+}
+
+static void wsizeddoc( jsonWriter_t* w, jsonKey_t const* key ) {
+    jsonw_objOpen( w, NULL );
+    jsonw_strLen( w, "v", nulvalue, sizeof nulvalue - 1 );
+    jsonw_strLen_k( w, key, nulvalue, 3 );
+    jsonw_strLen( w, "empty", nulvalue, 0 );
+    jsonw_objClose( w );
+}
+
+static int sized( void ) {
+    char text[ 32 ];
+    jsonKey_t key;
+    check( 0 == json_keyInitLen( &key, nulname, sizeof nulname - 1, text, 10 ) );
+    check( 11 == json_keyInitLen( &key, nulname, sizeof nulname - 1, text, sizeof text ) );
+    check( 0 == memcmp( text, "\"a\\u0000b\":", 11 ) );
+    static char const rslt[] = "{\"v\":\"x\\u0000y\\\"z\\u0000\",\"a\\u0000b\":\"x\\u0000y\",\"empty\":\"\"}";
+    char full[ 128 ];
+    size_t rem = sizeof full - 1;
+    size_t const len = sizeddoc( full, &key, &rem ) - full;
+    check( 0 == strcmp( full, rslt ) );
+    check( len == sizeof rslt - 1 );
+    for( size_t cap = 0; cap < len + 4; ++cap ) {
+        char buff[ 128 ];
+        buff[ 0 ] = '#';
+        rem = cap;
+        size_t const partlen = sizeddoc( buff + 1, &key, &rem ) - ( buff + 1 );
+        check( cap < len ? 0 == rem : partlen == len );
+        jsonWriter_t w;
+        jsonw_init( &w, buff, cap + 1 );
+        wsizeddoc( &w, &key );
+        jsonw_end( &w );
+        check( jsonw_needed( &w ) == len + 1 );
+        check( cap < len || 0 == strcmp( buff, full ) );
+    }
+    static char big[ 600 ];
+    memset( big, 'q', sizeof big );
+    big[ 300 ] = '\0';
+    jsonArena_t a;
+    json_arenaInit( &a, 0, NULL );
+    for( int mode = 0; mode < 2; ++mode ) {
+        jsonWriter_t w;
+        if ( 0 == mode )
+            jsonw_initArena( &w, &a );
+        else
+            jsonw_initIovec( &w, &a );
+        jsonw_arrOpen( &w, NULL );
+        jsonw_strLen( &w, NULL, big, sizeof big );
+        jsonw_arrClose( &w );
+        check( 2 + 2 + sizeof big + 5 == jsonw_end( &w ) );
+        static char buff[ 1024 ];
+        json_arenaFlatten( &a, buff, sizeof buff );
+        check( 0 == memcmp( buff + 2 + 300, "\\u0000qq", 8 ) );
+    }
+    json_arenaFree( &a );
+    done();
+}
+
+/* Reference of the UTF-8 policies: decode the code point and check it. */
+static size_t refdecode( unsigned char const* s, size_t len, unsigned long* code ) {
+    static unsigned long const min[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    size_t const n = s[0] >= 0xF0 ? 4 : s[0] >= 0xE0 ? 3 : s[0] >= 0xC0 ? 2 : 0;
+    if ( 0 == n || n > len || s[0] >= 0xF8 )
+        return 0;
+    *code = s[0] & ( 0x7F >> n );
+    for( size_t i = 1; i < n; ++i ) {
+        if ( 0x80 != ( s[i] & 0xC0 ) )
+            return 0;
+        *code = *code << 6 | ( s[i] & 0x3F );
+    }
+    if ( *code < min[ n ] || *code > 0x10FFFF || ( *code >= 0xD800 && *code <= 0xDFFF ) )
+        return 0;
+    return n;
+}
+
+/* Write a string of letters and non-ASCII bytes as JSON_UTF8 selects.
+   Return the length or zero if it is an error. */
+static size_t refutf8( char* dest, unsigned char const* s, size_t len ) {
+    char* p = dest;
+    *p++ = '\"';
+    while( 0 != len ) {
+        unsigned long code;
+        size_t n = s[0] < 0x80 ? 1 : refdecode( s, len, &code );
+        if ( JSON_UTF8 == JSON_UTF8_PASS || 1 == n )
+            n = 1, *p++ = *s;
+        else if ( 0 == n ) {
+            if ( JSON_UTF8 == JSON_UTF8_ERROR )
+                return 0;
+            n = 1;
+            p += sprintf( p, JSON_UTF8 == JSON_UTF8_ASCII ? "\\uFFFD" : "\xEF\xBF\xBD" );
+        }
+        else if ( JSON_UTF8 != JSON_UTF8_ASCII ) {
+            memcpy( p, s, n );
+            p += n;
+        }
+        else if ( code < 0x10000 )
+            p += sprintf( p, "\\u%04lX", code );
+        else
+            p += sprintf( p, "\\u%04lX\\u%04lX", 0xD800 + ( ( code - 0x10000 ) >> 10 ), 0xDC00 + ( code & 0x3FF ) );
+        s += n;
+        len -= n;
+    }
+    *p++ = '\"';
+    *p++ = ',';
+    *p = '\0';
+    return p - dest;
+}
+
+static int utf8( void ) {
+    static char const text[] = "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80";
+    static char const* const rslt[] = {
+        "\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\",",
+        "\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\",",
+        "\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\",",
+        "\"\\u00E9\\u20AC\\uD83D\\uDE00\","
+    };
+    static char buff[ 2048 ];
+    size_t rem = sizeof buff;
+    json_str( buff, NULL, text, &rem );
+    check( 0 == strcmp( buff, rslt[ JSON_UTF8 ] ) );
+    jsonKey_t key;
+    char keytext[ 32 ];
+    check( 0 != json_keyInit( &key, "\xC3(", keytext, sizeof keytext ) );
+    check( 0 == memcmp( keytext, JSON_UTF8 == JSON_UTF8_PASS ? "\"\xC3(\":" :
+                                 JSON_UTF8 == JSON_UTF8_ASCII ? "\"\\uFFFD(\":" : "\"\xEF\xBF\xBD(\":", key.len ) );
+    /* Limits of the UTF-8 at each position of a long text. */
+    static char const* const limits[] = {
+        "\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xEF\xBF\xBF",
+        "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "\xC0\xAF", "\xC1\xBF", "\xE0\x9F\xBF",
+        "\xED\xA0\x80", "\xED\xBF\xBF", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+        "\xF8\x88\x80\x80\x80", "\xFF", "\x80", "\xBF\x80", "\xE2\x82", "\xF0\x9F\x98", "\xC3"
+    };
+    for( size_t l = 0; l < sizeof limits / sizeof *limits; ++l ) {
+        for( size_t pos = 0; pos < 80; ++pos ) {
+            unsigned char src[ 128 ];
+            for( size_t j = 0; j < sizeof src; j += 2 )
+                memcpy( src + j, j % 6 ? "\xC3\xA9" : "ab", 2 );
+            size_t const limlen = strlen( limits[ l ] );
+            memcpy( src + pos, limits[ l ], limlen );
+            if ( 0x80 == ( src[ pos + limlen ] & 0xC0 ) )
+                src[ pos + limlen ] = 'c';
+            for( size_t len = pos + limlen; len <= sizeof src; len += sizeof src - pos - limlen ) {
+                static char expected[ 1024 ];
+                size_t const explen = refutf8( expected, src, len );
+                rem = sizeof buff;
+                char const* const end = json_strLen( buff, NULL, (char const*)src, len, &rem );
+                check( 0 == explen ? 0 == rem : 0 == strcmp( buff, expected ) && explen == (size_t)( end - buff ) );
+            }
+        }
+    }
+    /* Random strings with letters, random bytes and valid sequences. */
+    unsigned long seed = 12345;
+    for( int i = 0; i < 20000; ++i ) {
+        unsigned char src[ 260 ];
+        size_t len = 0;
+        seed = seed * 1103515245 + 12345;
+        size_t const max = seed >> 16 & 255;
+        int const noisy = seed >> 24 & 1;
+        while( len < max ) {
+            seed = seed * 1103515245 + 12345;
+            unsigned int const r = seed >> 16 & 0x7FFF;
+            unsigned long code = r < 0x2000 ? 'a' + ( r & 0xF ) : r < 0x4000 ? 0x80 + ( r & 0x77F ) : r < 0x6000 ? 0x800 + ( r << 2 ) : 0x10000 + ( seed >> 8 & 0xFFFFF );
+            if ( code >= 0xD800 && code <= 0xDFFF )
+                code = 0xE9;
+            if ( noisy && r < 0x400 )
+                src[ len++ ] = 0x80 | ( r & 0x7F );
+            else if ( code < 0x80 )
+                src[ len++ ] = code;
+            else if ( code < 0x800 ) {
+                src[ len++ ] = 0xC0 | code >> 6;
+                src[ len++ ] = 0x80 | ( code & 0x3F );
+            }
+            else if ( code < 0x10000 ) {
+                src[ len++ ] = 0xE0 | code >> 12;
+                src[ len++ ] = 0x80 | ( code >> 6 & 0x3F );
+                src[ len++ ] = 0x80 | ( code & 0x3F );
+            }
+            else {
+                src[ len++ ] = 0xF0 | code >> 18;
+                src[ len++ ] = 0x80 | ( code >> 12 & 0x3F );
+                src[ len++ ] = 0x80 | ( code >> 6 & 0x3F );
+                src[ len++ ] = 0x80 | ( code & 0x3F );
+            }
+        }
+        static char expected[ 2048 ];
+        size_t const explen = refutf8( expected, src, len );
+        rem = sizeof buff;
+        char const* const end = json_strLen( buff, NULL, (char const*)src, len, &rem );
+        check( 0 == explen ? 0 == rem : 0 == strcmp( buff, expected ) && explen == (size_t)( end - buff ) );
+        jsonWriter_t w;
+        jsonw_init( &w, buff, 1 + i % 64 );
+        jsonw_strLen( &w, NULL, (char const*)src, len );
+        size_t const needed = jsonw_needed( &w );
+        if ( 0 == explen )
+            check( jsonw_status( &w ) & JSON_ERROR );
+        else
+            check( needed == explen );
+        if ( 0 != explen && needed <= 1 + i % 64 )
+            check( 0 == memcmp( buff, expected, explen - 1 ) );
+    }
+    /* Escapes around long valid runs in a vectored writer. */
+    static char big[ 700 ];
+    memset( big, 'q', sizeof big );
+    memcpy( big + 300, "\xE2\x82\xAC\xC3", 4 );
+    memcpy( big + 650, "\xF0\x9F\x98\x80", 4 );
+    char full[ 2048 ];
+    rem = sizeof full;
+    size_t const len = json_strLen( full, NULL, big, sizeof big, &rem ) - full;
+    jsonArena_t a;
+    json_arenaInit( &a, 0, NULL );
+    jsonWriter_t w;
+    jsonw_initIovec( &w, &a );
+    jsonw_strLen( &w, NULL, big, sizeof big );
+    if ( JSON_UTF8 == JSON_UTF8_ERROR ) {
+        check( 0 == rem );
+        check( jsonw_status( &w ) & JSON_ERROR );
+    }
+    else {
+        check( len - 1 == jsonw_end( &w ) );
+        static char flat[ 2048 ];
+        json_arenaFlatten( &a, flat, sizeof flat );
+        check( 0 == memcmp( flat, full, len - 1 ) );
+    }
+    json_arenaFree( &a );
+    done();
+}
+
+/* Reference of the binary encodings: one character at a time. */
+static size_t refbinary( char* dest, unsigned char const* s, size_t len, int base64 ) {
+    static char const digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char* p = dest;
+    *p++ = '\"';
+    if ( !base64 )
+        for( size_t i = 0; i < len; ++i )
+            p += sprintf( p, "%02x", s[i] );
+    else
+        for( size_t i = 0; i < len; i += 3 ) {
+            unsigned long x = (unsigned long)s[i] << 16;
+            if ( i + 1 < len ) x |= (unsigned long)s[i+1] << 8;
+            if ( i + 2 < len ) x |= s[i+2];
+            *p++ = digits[ x >> 18 ];
+            *p++ = digits[ x >> 12 & 63 ];
+            *p++ = i + 1 < len ? digits[ x >> 6 & 63 ] : '=';
+            *p++ = i + 2 < len ? digits[ x & 63 ] : '=';
+        }
+    *p++ = '\"';
+    *p++ = ',';
+    *p = '\0';
+    return p - dest;
+}
+
+static int binary( void ) {
+    static char const* const rfc[] = { "\"\",", "\"Zg==\",", "\"Zm8=\",", "\"Zm9v\",", "\"Zm9vYg==\",", "\"Zm9vYmE=\",", "\"Zm9vYmFy\"," };
+    for( int i = 0; i < 7; ++i ) {
+        char buff[ 16 ];
+        size_t rem = sizeof buff;
+        char* const p = json_base64( buff, NULL, "foobar", i, &rem );
+        check( 0 == strcmp( buff, rfc[ i ] ) );
+        check( p - buff == (ptrdiff_t)strlen( rfc[ i ] ) );
+    }
+    char buff[ 16 ];
+    size_t rem = sizeof buff;
+    json_hex( buff, "h", "\x00\x9F\xFA", 3, &rem );
+    check( 0 == strcmp( buff, "\"h\":\"009ffa\"," ) );
+    static unsigned char data[ 300 ];
+    for( size_t i = 0; i < sizeof data; ++i )
+        data[ i ] = rand();
+    static jsonKey_t const key = JSON_KEY( "bin" );
+    for( int base64 = 0; base64 < 2; ++base64 )
+        for( size_t n = 0; n < sizeof data; n += 1 + n / 16 ) {
+            static char full[ 1024 ];
+            static char expected[ 1024 ];
+            size_t const len = refbinary( expected, data + 1, n, base64 );
+            rem = sizeof full;
+            char* p = base64 ? json_base64( full, NULL, data + 1, n, &rem ) : json_hex( full, NULL, data + 1, n, &rem );
+            check( p - full == (ptrdiff_t)len );
+            check( 0 == strcmp( full, expected ) );
+            for( size_t cap = len - 3; cap < len + 8; ++cap ) {
+                static char part[ 1024 ];
+                rem = cap;
+                p = base64 ? json_base64_k( part, &key, data + 1, n, &rem ) : json_hex_k( part, &key, data + 1, n, &rem );
+                check( cap < len + 6 ? 0 == rem : p - part == (ptrdiff_t)len + 6 );
+                jsonWriter_t w;
+                jsonw_init( &w, part, cap );
+                jsonw_arrOpen( &w, NULL );
+                if ( base64 )
+                    jsonw_base64( &w, NULL, data + 1, n );
+                else
+                    jsonw_hex( &w, NULL, data + 1, n );
+                jsonw_arrClose( &w );
+                jsonw_end( &w );
+                check( jsonw_needed( &w ) == len + 2 );
+                check( cap < len + 2 || 0 == memcmp( part + 1, expected, len - 1 ) );
+            }
+            static struct collect c;
+            c.len = 0;
+            c.calls = 0;
+            c.fail = -1;
+            char block[ JSON_MINBLOCK ];
+            jsonStream_t s;
+            jsonWriter_t w;
+            jsonw_initStream( &w, &s, block, sizeof block, collectflush, &c );
+            if ( base64 )
+                jsonw_base64_k( &w, NULL, data + 1, n );
+            else
+                jsonw_hex_k( &w, NULL, data + 1, n );
+            check( len - 1 == jsonw_end( &w ) );
+            check( 0 == jsonw_status( &w ) );
+            check( 0 == memcmp( c.data, expected, len - 1 ) );
+        }
+    done();
+}
+
+/* The JSON of the template test written call by call. */
+static char* tpldoc( char* dest, jsonValue_t const* values, size_t* remLen ) {
+    dest = json_objOpen( dest, "status", remLen );
+    dest = json_str( dest, "device", "meter-7", remLen );
+    dest = json_verylong( dest, "id", values[ 0 ].integer, remLen );
+    dest = json_arrOpen( dest, "temps", remLen );
+    dest = json_double( dest, NULL, values[ 1 ].real, remLen );
+    dest = json_double( dest, NULL, values[ 2 ].real, remLen );
+    dest = json_arrClose( dest, remLen );
+    dest = json_str( dest, "place", values[ 3 ].str, remLen );
+    dest = json_bool( dest, "on", values[ 4 ].boolean, remLen );
+    dest = json_raw( dest, "seq", "    42", 6, remLen );
+    return json_objClose( dest, remLen );
+}
+
+/* The status document with fixed-width numbers. */
+static size_t fixeddoc( jsonWriter_t* w, long long seq, double temp, jsonFixed_t* f ) {
+    static jsonKey_t const level = JSON_KEY( "level" );
+    jsonw_objOpen( w, NULL );
+    jsonw_str( w, "device", "meter \"7\"" );
+    jsonw_fixedInt( w, "seq", seq, 8, &f[ 0 ] );
+    jsonw_fixedDouble_k( w, &level, temp, 9, 3, &f[ 1 ] );
+    jsonw_arrOpen( w, "temps" );
+    jsonw_fixedDouble( w, NULL, -temp, 9, 0, &f[ 2 ] );
+    jsonw_arrClose( w );
+    jsonw_fixedInt_k( w, &level, -seq, 20, &f[ 3 ] );
+    jsonw_objClose( w );
+    return jsonw_end( w );
+}
+
+static int fixed( void ) {
+    static char const rslt[] = "{\"device\":\"meter \\\"7\\\"\",\"seq\":      42,"
+        "\"level\":   21.500,\"temps\":[      -22],\"level\":                 -42}";
+    char buff[ 128 ];
+    jsonFixed_t f[ 4 ];
+    jsonWriter_t w;
+    jsonw_init( &w, buff, sizeof buff );
+    size_t const len = fixeddoc( &w, 42, 21.5, f );
+    check( 0 == jsonw_status( &w ) );
+    check( sizeof rslt - 1 == len && 0 == strcmp( buff, rslt ) );
+    check( 0 == memcmp( buff + f[ 0 ].offset, "      42", 8 ) );
+    check( 8 == f[ 0 ].width && -1 == f[ 0 ].decimals );
+    check( 9 == f[ 1 ].width && 3 == f[ 1 ].decimals );
+    static struct { long long seq; double temp; } const updates[] = {
+        { 0, 0 }, { 99999999, 99999.999 }, { -9999999, -9999.999 }, { 7, 0.0005 }, { 1, -0.0004 }
+    };
+    for( size_t i = 0; i < sizeof updates / sizeof *updates; ++i ) {
+        check( 1 == json_patchInt( buff, &f[ 0 ], updates[ i ].seq ) );
+        check( 1 == json_patchDouble( buff, &f[ 1 ], updates[ i ].temp ) );
+        check( 1 == json_patchDouble( buff, &f[ 2 ], -updates[ i ].temp ) );
+        check( 1 == json_patchInt( buff, &f[ 3 ], -updates[ i ].seq ) );
+        char fresh[ 128 ];
+        jsonFixed_t g[ 4 ];
+        jsonw_init( &w, fresh, sizeof fresh );
+        check( len == fixeddoc( &w, updates[ i ].seq, updates[ i ].temp, g ) );
+        check( 0 == strcmp( buff, fresh ) );
+    }
+    check( 0 == memcmp( buff + f[ 1 ].offset, "    0.000", 9 ) );
+    char copy[ sizeof buff ];
+    memcpy( copy, buff, sizeof buff );
+    check( 0 == json_patchInt( buff, &f[ 0 ], 100000000 ) );
+    check( 0 == json_patchDouble( buff, &f[ 1 ], 100000 ) );
+    check( 0 == json_patchDouble( buff, &f[ 2 ], 1e300 ) );
+    check( 0 == memcmp( buff, copy, sizeof buff ) );
+    check( 1 == json_patchInt( buff, &f[ 1 ], 12 ) );
+    check( 0 == memcmp( buff + f[ 1 ].offset, "   12.000", 9 ) );
+    check( 1 == json_patchDouble( buff, &f[ 0 ], 2.5 ) );
+    check( 0 == memcmp( buff + f[ 0 ].offset, "       3", 8 ) );
+    check( 1 == json_patchDouble( buff, &f[ 1 ], -0.0625 ) );
+    check( 0 == memcmp( buff + f[ 1 ].offset, "   -0.063", 9 ) );
+    check( 1 == json_patchDouble( buff, &f[ 1 ], 2.675 ) );
+    check( 0 == memcmp( buff + f[ 1 ].offset, "    2.675", 9 ) );
+    check( 1 == json_patchDouble( buff, &f[ 0 ], 0.49999999999999994 ) );
+    check( 0 == memcmp( buff + f[ 0 ].offset, "       0", 8 ) );
+#if JSON_NONFINITE == JSON_NONFINITE_NULL
+    check( 1 == json_patchDouble( buff, &f[ 1 ], NAN ) );
+    check( 0 == memcmp( buff + f[ 1 ].offset, "     null", 9 ) );
+#endif
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_arrOpen( &w, NULL );
+    jsonFixed_t h;
+    check( 0 == jsonw_fixedInt( &w, NULL, 1, 0, &h ) );
+    check( 0 == jsonw_fixedInt( &w, NULL, 1, JSON_FIXED_MAXWIDTH + 1, &h ) );
+    check( 0 == jsonw_fixedInt( &w, NULL, 100, 2, &h ) );
+    check( 0 == jsonw_fixedDouble( &w, NULL, 1, 8, JSON_FIXED_MAXDECIMALS + 1, &h ) );
+    check( 0 == jsonw_fixedDouble( &w, NULL, 1, 3, 2, &h ) );
+    check( 0 == jsonw_fixedDouble( &w, NULL, 1e10, 32, 9, &h ) );
+    check( JSON_ERROR == jsonw_status( &w ) );
+    check( 1 == jsonw_fixedDouble( &w, NULL, 1, 4, 2, &h ) );
+    jsonw_arrClose( &w );
+    jsonw_end( &w );
+    check( 0 == strcmp( buff, "[1.00]" ) && 1 == h.offset );
+    /* Rounded from the exact value of the double, as printf does out of ties. */
+    static struct { double value; unsigned width; int decimals; char const* text; } const reals[] = {
+        { 4503599627370497.0, 20, 0, "[    4503599627370497]" },
+        { 0.49999999999999994, 1, 0, "[0]" },
+        { -0.49999999999999994, 1, 0, "[0]" },
+        { 2.675, 4, 2, "[2.67]" },
+        { 1.005, 4, 2, "[1.00]" },
+        { 0.5, 1, 0, "[1]" },
+        { -2.5, 2, 0, "[-3]" },
+        { 9223372036854774784.0, 19, 0, "[9223372036854774784]" },
+        { 5e-324, 11, 9, "[0.000000000]" },
+    };
+    for( size_t i = 0; i < sizeof reals / sizeof *reals; ++i ) {
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_arrOpen( &w, NULL );
+        check( 1 == jsonw_fixedDouble( &w, NULL, reals[ i ].value, reals[ i ].width, reals[ i ].decimals, &h ) );
+        jsonw_arrClose( &w );
+        jsonw_end( &w );
+        check( 0 == strcmp( buff, reals[ i ].text ) );
+    }
+    jsonw_init( &w, buff, sizeof buff );
+    check( 0 == jsonw_fixedDouble( &w, NULL, 9223372036854775808.0, 32, 0, &h ) );
+    for( int i = -2000; i <= 2000; ++i ) {
+        /* The multiples of 1/8 are ties, which printf rounds to even, and
+           printf keeps the sign of the negatives that round to zero. */
+        if ( 0 == i % 125 || ( -5 < i && i < 0 ) )
+            continue;
+        double const value = i / 1000.0;
+        char expected[ 16 ];
+        sprintf( expected, "[%5.2f]", value );
+        jsonw_init( &w, buff, sizeof buff );
+        jsonw_arrOpen( &w, NULL );
+        jsonw_fixedDouble( &w, NULL, value, 5, 2, &h );
+        jsonw_arrClose( &w );
+        jsonw_end( &w );
+        check( 0 == strcmp( buff, expected ) );
+    }
+    for( size_t cap = 0; cap < len + 2; ++cap ) {
+        jsonFixed_t g[ 4 ];
+        jsonw_init( &w, buff, cap + 1 );
+        fixeddoc( &w, 42, 21.5, g );
+        check( jsonw_needed( &w ) == len + 1 );
+        for( int i = 0; i < 4; ++i )
+            check( g[ i ].offset == f[ i ].offset );
+    }
+    static struct collect c;
+    c.len = 0;
+    c.calls = 0;
+    c.fail = -1;
+    char block[ JSON_MINBLOCK ];
+    jsonStream_t s;
+    jsonw_initStream( &w, &s, block, sizeof block, collectflush, &c );
+    check( len == fixeddoc( &w, 42, 21.5, f ) );
+    check( 2 < c.calls );
+    check( 1 == json_patchInt( c.data, &f[ 3 ], 123 ) );
+    check( 0 == memcmp( c.data + len - 5, " 123}", 5 ) );
+    done();
+}
+
+static int templates( void ) {
+    static char text[ 128 ];
+    jsonSlot_t slots[ 6 ];
+    jsonTemplate_t t;
+    json_templateInit( &t, text, sizeof text, slots, 6 );
+    jsonWriter_t w;
+    jsonw_initTemplate( &w, &t );
+    jsonw_objOpen( &w, NULL );
+    jsonw_str( &w, "device", "meter-7" );
+    check( 0 == jsonw_slot( &w, &t, "id", JSON_SLOT_INT ) );
+    jsonw_arrOpen( &w, "temps" );
+    check( 1 == jsonw_slot( &w, &t, NULL, JSON_SLOT_DOUBLE ) );
+    check( 2 == jsonw_slot( &w, &t, NULL, JSON_SLOT_DOUBLE ) );
+    jsonw_arrClose( &w );
+    check( 3 == jsonw_slot( &w, &t, "place", JSON_SLOT_STR ) );
+    check( 4 == jsonw_slot( &w, &t, "on", JSON_SLOT_BOOL ) );
+    check( 5 == jsonw_fixedSlot( &w, &t, "seq", 6 ) );
+    jsonw_objClose( &w );
+    check( 1 == json_templateEnd( &t, &w ) );
+    check( 0 == strcmp( text, "{\"device\":\"meter-7\",\"id\":,\"temps\":[,],\"place\":,\"on\":,\"seq\":     0}" ) );
+    check( 1 == json_templatePatch( &t, 5, 42 ) );
+    check( 0 == json_templatePatch( &t, 5, 1234567 ) );
+    check( 0 == json_templatePatch( &t, 4, 1 ) );
+    check( 0 == strcmp( text + t.len - 7, "    42}" ) );
+    static char const* const places[] = { "", "kitchen", "a \"b\"\n", "0123456789012345678901234567890123456789" };
+    for( int r = 0; r < 64; ++r ) {
+        jsonValue_t values[ 6 ];
+        values[ 0 ].integer = r & 1 ? LLONG_MIN : r * 1000003ll;
+        values[ 1 ].real = r / 7.0;
+        values[ 2 ].real = -r / 7.0;
+        values[ 3 ].str = places[ r % 4 ];
+        values[ 4 ].boolean = r & 2;
+        static char full[ 256 ];
+        size_t rem = sizeof full;
+        size_t const len = tpldoc( full, values, &rem ) - full;
+        for( size_t cap = 0; cap < len + 4; ++cap ) {
+            static char buff[ 256 ];
+            rem = cap;
+            char* const p = json_template( buff, "status", &t, values, &rem );
+            check( cap < len ? 0 == rem : p - buff == (ptrdiff_t)len && 0 == strcmp( buff, full ) );
+            check( strlen( buff ) == ( cap < len ? cap : len ) );
+            check( 0 == memcmp( buff, full, strlen( buff ) ) );
+            jsonw_init( &w, buff, cap + 1 );
+            jsonw_template( &w, NULL, &t, values );
+            jsonw_end( &w );
+            check( jsonw_needed( &w ) == len - 9 );
+            check( cap + 1 < len - 9 || 0 == strncmp( buff, full + 9, len - 10 ) );
+        }
+        static struct collect c;
+        c.len = 0;
+        c.calls = 0;
+        c.fail = -1;
+        char block[ JSON_MINBLOCK ];
+        jsonStream_t s;
+        jsonw_initStream( &w, &s, block, sizeof block, collectflush, &c );
+        jsonw_template( &w, NULL, &t, values );
+        check( len - 10 == jsonw_end( &w ) );
+        check( 0 == memcmp( c.data, full + 9, len - 10 ) );
+    }
+    jsonSlot_t one;
+    json_templateInit( &t, text, 8, &one, 1 );
+    jsonw_initTemplate( &w, &t );
+    jsonw_arrOpen( &w, NULL );
+    check( 0 == jsonw_slot( &w, &t, NULL, JSON_SLOT_INT ) );
+    check( -1 == jsonw_slot( &w, &t, NULL, JSON_SLOT_INT ) );
+    check( -1 == jsonw_slot( &w, &t, NULL, JSON_SLOT_FIXED ) );
+    jsonw_arrClose( &w );
+    check( 0 == json_templateEnd( &t, &w ) );
+    char buff[ 16 ];
+    size_t rem = sizeof buff;
+    json_template( buff, NULL, &t, NULL, &rem );
+    check( 0 == rem );
+    jsonw_init( &w, buff, sizeof buff );
+    jsonw_template( &w, NULL, &t, NULL );
+    check( JSON_ERROR == jsonw_status( &w ) );
+    done();
+}
+
+static int reformat( void ) {
+    static char const compact[] = "{\"a\":1,\"b\":[true,{}],\"c\":{\"d\":\"x\\\"},\\\\\"},\"e\":[]}";
+    static char const pretty[] =
+        "{\r\n"
+        "  \"a\": 1,\r\n"
+        "  \"b\": [\r\n"
+        "    true,\r\n"
+        "    {}\r\n"
+        "  ],\r\n"
+        "  \"c\": {\r\n"
+        "    \"d\": \"x\\\"},\\\\\"\r\n"
+        "  },\r\n"
+        "  \"e\": []\r\n"
+        "}";
+    size_t const len = sizeof compact - 1;
+    for( size_t split = 0; split <= len; ++split ) {
+        jsonFormat_t f;
+        json_formatInit( &f, 2, "\r\n" );
+        char buff[ 256 ];
+        size_t rem = sizeof buff - 1;
+        char* p = json_format( buff, &f, compact, split, &rem );
+        p = json_format( p, &f, compact + split, len - split, &rem );
+        check( 0 == strcmp( buff, pretty ) );
+        check( p - buff == sizeof pretty - 1 );
+        json_formatInit( &f, 0, NULL );
+        rem = sizeof buff - 1;
+        p = json_format( buff, &f, pretty, split, &rem );
+        json_format( p, &f, pretty + split, sizeof pretty - 1 - split, &rem );
+        check( 0 == strcmp( buff, compact ) );
+    }
+    for( size_t cap = 0; cap < sizeof pretty + 2; ++cap ) {
+        jsonFormat_t f;
+        json_formatInit( &f, 2, "\r\n" );
+        char buff[ 256 ];
+        size_t rem = cap;
+        json_format( buff, &f, compact, len, &rem );
+        check( cap < sizeof pretty - 1 ? 0 == rem : 0 == strcmp( buff, pretty ) );
+        check( 0 == strncmp( buff, pretty, strlen( buff ) ) );
+    }
+    for( size_t cap = 0; cap < sizeof compact + 2; ++cap ) {
+        jsonFormat_t f;
+        json_formatInit( &f, 2, "" );
+        char buff[ 256 ];
+        size_t rem = cap;
+        json_format( buff, &f, pretty, sizeof pretty - 1, &rem );
+        check( cap < len ? 0 == rem : 0 == strcmp( buff, compact ) );
+        check( 0 == strncmp( buff, compact, strlen( buff ) ) );
+    }
+    {
+        jsonFormat_t f;
+        json_formatInit( &f, 2, "" );
+        jsonWriter_t w;
+        jsonw_measure( &w );
+        jsonw_format( &w, &f, pretty, sizeof pretty - 1 );
+        jsonw_end( &w );
+        check( len + 1 == jsonw_needed( &w ) );
+    }
+    static char full[ 8192 ];
+    jsonWriter_t w;
+    jsonw_init( &w, full, sizeof full );
+    warena( &w );
+    size_t const fulllen = jsonw_end( &w );
+    static char expected[ 16384 ];
+    jsonFormat_t f;
+    json_formatInit( &f, 4, "\n" );
+    size_t rem = sizeof expected - 1;
+    size_t const prettylen = json_format( expected, &f, full, fulllen, &rem ) - expected;
+    check( 0 != rem );
+    static char minified[ 8192 ];
+    json_formatInit( &f, 4, NULL );
+    rem = sizeof minified - 1;
+    json_format( minified, &f, expected, prettylen, &rem );
+    check( 0 == strcmp( minified, full ) );
+    jsonWriter_t out;
+    jsonPretty_t pp;
+    static char buff[ 16384 ];
+    for( size_t size = 0; size < prettylen + 2; size += 1 + size / 8 ) {
+        jsonw_init( &out, buff, size );
+        jsonw_initPretty( &w, &pp, &out, 4, "\n" );
+        warena( &w );
+        size_t const rslt = jsonw_end( &w );
+        check( jsonw_needed( &out ) == prettylen + 1 );
+        check( jsonw_status( &w ) == jsonw_status( &out ) );
+        if ( size < prettylen + 1 ) {
+            check( JSON_OVERFLOW == jsonw_status( &w ) );
+            check( 0 == size || rslt < size );
+        }
+        else {
+            check( prettylen == rslt );
+            check( 0 == strcmp( buff, expected ) );
+        }
+    }
+    static struct collect c;
+    c.len = 0;
+    c.calls = 0;
+    c.fail = -1;
+    char block[ JSON_MINBLOCK ];
+    jsonStream_t s;
+    jsonw_initStream( &out, &s, block, sizeof block, collectflush, &c );
+    jsonw_initPretty( &w, &pp, &out, 4, "\n" );
+    warena( &w );
+    check( prettylen == jsonw_end( &w ) );
+    check( 0 == jsonw_status( &w ) );
+    check( prettylen == c.len );
+    check( 0 == memcmp( c.data, expected, prettylen ) );
+    done();
+}
+
+/** Sum the bytes of the families of some counters. */
+static unsigned long long statbytes( jsonStats_t const* s ) {
+    unsigned long long bytes = 0;
+    for( int i = 0; i < JSON_STATS_FAMILIES; ++i )
+        bytes += s->family[i].bytes;
+    return bytes;
+}
+
+static int instrumentation( void ) {
+    jsonStats_t s = { 0 };
+    json_statsCollect( &s );
+    memset( &s, 0, sizeof s );
+    char buff[ 64 ];
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_str( p, "a\n", "x\"y", &rem );
+    p = json_int( p, "n", 42, &rem );
+    p = json_arrOpen( p, "v", &rem );
+    p = json_double( p, NULL, 0.5, &rem );
+    p = json_bool( p, NULL, 1, &rem );
+    p = json_arrClose( p, &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
+    json_statsCollect( &s );
+    check( 0 == strcmp( buff, "{\"a\\n\":\"x\\\"y\",\"n\":42,\"v\":[0.5,true]}" ) );
+#ifdef JSON_STATS
+    check( 4 == s.family[ JSON_STATS_STRUCT ].calls );
+    check( 1 == s.family[ JSON_STATS_STRING ].calls );
+    check( 1 == s.family[ JSON_STATS_INTEGER ].calls );
+    check( 1 == s.family[ JSON_STATS_REAL ].calls );
+    check( 1 == s.family[ JSON_STATS_LITERAL ].calls );
+    check( 0 == s.family[ JSON_STATS_BINARY ].calls );
+    check( statbytes( &s ) == (unsigned long long)( p - buff ) + 1 );
+    check( 3 == s.names );
+    check( 14 == s.nameBytes );
+    check( 2 == s.escapeBytes );
+    check( 0 == s.truncations );
+    check( 2 == s.maxDepth );
+    check( 0 == s.family[ JSON_STATS_STRUCT ].samples );
+#else
+    check( 0 == s.family[ JSON_STATS_STRUCT ].calls );
+    check( 0 == statbytes( &s ) );
+    check( 0 == s.names && 0 == s.escapeBytes && 0 == s.maxDepth );
+#endif
+
+    static int const values[] = { 1, 22, 333 };
+    json_statsSample( 1 );
+    rem = sizeof buff - 1;
+    p = json_intArray( buff, "i", values, 3, &rem );
+    json_statsSample( 0 );
+    jsonStats_t a = { 0 };
+    json_statsCollect( &a );
+#ifdef JSON_STATS
+    check( 1 == a.family[ JSON_STATS_ARRAY ].calls );
+    check( 2 == a.family[ JSON_STATS_STRUCT ].calls );
+    check( 0 == a.family[ JSON_STATS_STRUCT ].bytes );
+    check( a.family[ JSON_STATS_ARRAY ].bytes == (unsigned long long)( p - buff ) );
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    check( 1 == a.family[ JSON_STATS_ARRAY ].samples );
+#endif
+    check( 0 == a.family[ JSON_STATS_STRUCT ].samples );
+#endif
+
+    jsonWriter_t w;
+    jsonw_init( &w, buff, 8 );
+    jsonw_objOpen( &w, NULL );
+    jsonw_objOpen( &w, "b" );
+    jsonw_arrOpen( &w, "c" );
+    jsonw_null( &w, NULL );
+    jsonw_arrClose( &w );
+    jsonw_objClose( &w );
+    jsonw_objClose( &w );
+    jsonw_end( &w );
+    jsonStats_t ws = { 0 };
+    json_statsCollect( &ws );
+#ifdef JSON_STATS
+    check( 6 == ws.family[ JSON_STATS_STRUCT ].calls );
+    check( 1 == ws.family[ JSON_STATS_LITERAL ].calls );
+    check( statbytes( &ws ) == jsonw_needed( &w ) - 1 - w.lost );
+    check( 0 != ws.truncations );
+    check( 3 == ws.maxDepth );
+#endif
+
+    jsonStats_t total = s;
+    json_statsMerge( &total, &ws );
+    check( total.family[ JSON_STATS_STRUCT ].calls == s.family[ JSON_STATS_STRUCT ].calls + ws.family[ JSON_STATS_STRUCT ].calls );
+    check( total.names == s.names + ws.names );
+    check( total.maxDepth == ( s.maxDepth > ws.maxDepth ? s.maxDepth : ws.maxDepth ) );
+    check( 0 == json_statsThread()->family[ JSON_STATS_STRUCT ].calls );
+    done();
+}
+
 static int len( void ) {
     char buff[512];
-    char* p = json_objOpen( buff, NULL );
-    p = json_nstr( p, "name", "\tHello: \"man\"\n", 6 );
-    p = json_objClose( p );
-    p = json_end( p );
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_nstr( p, "name", "\tHello: \"man\"\n", 6, &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
     static char const rslt[] = "{\"name\":\"\\tHello\"}";
     check( p - buff == sizeof rslt - 1 );
     check( 0 == strcmp( buff, rslt ) );
@@ -94,33 +1832,36 @@ static int len( void ) {
 static int empty( void ) {
     char buff[512];
     {
-        char* p = json_objOpen( buff, NULL );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         static char const rslt[] = "{}";
         check( p - buff == sizeof rslt - 1 );
         check( 0 == strcmp( buff, rslt ) );
     }
     {
-        char* p = json_objOpen( buff, NULL );
-        p = json_arrOpen( p, "a" );
-        p = json_arrClose( p );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_arrOpen( p, "a", &rem );
+        p = json_arrClose( p, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         static char const rslt[] = "{\"a\":[]}";
         check( p - buff == sizeof rslt - 1 );
         check( 0 == strcmp( buff, rslt ) );
     }
     {
-        char* p = json_objOpen( buff, NULL );
-        p = json_arrOpen( p, "a" );
-        p = json_objOpen( p, NULL );
-        p = json_objClose( p );
-        p = json_objOpen( p, NULL );
-        p = json_objClose( p );
-        p = json_arrClose( p );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_arrOpen( p, "a", &rem );
+        p = json_objOpen( p, NULL, &rem );
+        p = json_objClose( p, &rem );
+        p = json_objOpen( p, NULL, &rem );
+        p = json_objClose( p, &rem );
+        p = json_arrClose( p, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         static char const rslt[] = "{\"a\":[{},{}]}";
         check( p - buff == sizeof rslt - 1 );
         check( 0 == strcmp( buff, rslt ) );
@@ -135,14 +1876,15 @@ static int empty( void ) {
 
 static int primitive( void ) {
     char buff[512];
-    char* p = json_objOpen( buff, NULL );
-    p = json_verylong( p, "max",  LONG_LONG_MAX );
-    p = json_verylong( p, "min",  LONG_LONG_MIN );
-    p = json_bool( p, "boolvar0", 0 );
-    p = json_bool( p, "boolvar1", 1 );
-    p = json_null( p, "nullvar" );
-    p = json_objClose( p );
-    p = json_end( p );
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_verylong( p, "max",  LONG_LONG_MAX, &rem );
+    p = json_verylong( p, "min",  LONG_LONG_MIN, &rem );
+    p = json_bool( p, "boolvar0", 0, &rem );
+    p = json_bool( p, "boolvar1", 1, &rem );
+    p = json_null( p, "nullvar", &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
     static char const rslt[] =  "{"
                                     "\"max\":9223372036854775807,"
                                     "\"min\":-9223372036854775808,"
@@ -158,22 +1900,24 @@ static int primitive( void ) {
 static int integers( void ) {
     {
         char buff[64];
-        char* p = json_objOpen( buff, NULL );
-        p = json_int( p, "a", 0 );
-        p = json_int( p, "b", 1 );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_int( p, "a", 0, &rem );
+        p = json_int( p, "b", 1, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         static char const rslt[] = "{\"a\":0,\"b\":1}";
         check( p - buff == sizeof rslt - 1 );
         check( 0 == strcmp( buff, rslt ) );
     }
     {
         char buff[64];
-        char* p = json_objOpen( buff, NULL );
-        p = json_int( p, "max", INT_MAX );
-        p = json_int( p, "min", INT_MIN );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_int( p, "max", INT_MAX, &rem );
+        p = json_int( p, "min", INT_MIN, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         char rslt[ sizeof buff ];
         int len = sprintf( rslt, "{\"max\":%d,\"min\":%d}", INT_MAX, INT_MIN );
         check( len < sizeof buff );
@@ -182,10 +1926,11 @@ static int integers( void ) {
     }
     {
         char buff[64];
-        char* p = json_objOpen( buff, NULL );
-        p = json_uint( p, "max", UINT_MAX );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_uint( p, "max", UINT_MAX, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         char rslt[ sizeof buff ];
         int len = sprintf( rslt, "{\"max\":%u}", UINT_MAX );
         check( len < sizeof buff );
@@ -194,11 +1939,12 @@ static int integers( void ) {
     }
     {
         char buff[64];
-        char* p = json_objOpen( buff, NULL );
-        p = json_long( p, "max", LONG_MAX );
-        p = json_long( p, "min", LONG_MIN );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_long( p, "max", LONG_MAX, &rem );
+        p = json_long( p, "min", LONG_MIN, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         char rslt[ sizeof buff ];
         int len = sprintf( rslt, "{\"max\":%ld,\"min\":%ld}", LONG_MAX, LONG_MIN );
         check( len < sizeof buff );
@@ -207,10 +1953,11 @@ static int integers( void ) {
     }
     {
         char buff[64];
-        char* p = json_objOpen( buff, NULL );
-        p = json_ulong( p, "max", ULONG_MAX );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_ulong( p, "max", ULONG_MAX, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         char rslt[ sizeof buff ];
         int len = sprintf( rslt, "{\"max\":%lu}", ULONG_MAX );
         check( len < sizeof buff );
@@ -219,11 +1966,12 @@ static int integers( void ) {
     }
     {
         char buff[64];
-        char* p = json_objOpen( buff, NULL );
-        p = json_verylong( p, "max", LONG_LONG_MAX );
-        p = json_verylong( p, "min", LONG_LONG_MIN );
-        p = json_objClose( p );
-        p = json_end( p );
+        size_t rem = sizeof buff - 1;
+        char* p = json_objOpen( buff, NULL, &rem );
+        p = json_verylong( p, "max", LONG_LONG_MAX, &rem );
+        p = json_verylong( p, "min", LONG_LONG_MIN, &rem );
+        p = json_objClose( p, &rem );
+        p = json_end( p, &rem );
         char rslt[ sizeof buff ];
         int len = sprintf( rslt, "{\"max\":%lld,\"min\":%lld}", LONG_LONG_MAX, LONG_LONG_MIN );
         check( len < sizeof buff );
@@ -233,15 +1981,43 @@ static int integers( void ) {
     done();
 }
 
+static int digits( void ) {
+    long long num = 1;
+    for( int i = 0; i < 19; ++i, num = 19 > i ? num * 10 : num ) {
+        long long const lut[] = { num - 1, num, num + 1, -num + 1, -num, -num - 1 };
+        for( int j = 0; j < sizeof lut / sizeof *lut; ++j ) {
+            char buff[ 32 ];
+            size_t rem = sizeof buff - 1;
+            char* p = json_verylong( buff, NULL, lut[j], &rem );
+            char rslt[ sizeof buff ];
+            int len = sprintf( rslt, "%lld,", lut[j] );
+            check( p - buff == len );
+            check( 0 == strcmp( buff, rslt ) );
+        }
+    }
+    for( int cap = 0; cap < 6; ++cap ) {
+        char buff[ 16 ];
+        memset( buff, '#', sizeof buff );
+        size_t rem = cap;
+        char* p = json_int( buff, NULL, -12345, &rem );
+        check( p - buff == cap );
+        check( 0 == rem );
+        check( 0 == strncmp( buff, "-12345", cap ) );
+        check( '\0' == buff[ cap ] && '#' == buff[ cap + 1 ] );
+    }
+    done();
+}
+
 static int array( void ) {
     char buff[64];
-    char* p = json_objOpen( buff, NULL );
-    p = json_arrOpen( p, "a" );
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_arrOpen( p, "a", &rem );
     for( int i = 0; i < 4; ++i )
-        p = json_int( p, NULL, i );
-    p = json_arrClose( p );
-    p = json_objClose( p );
-    p = json_end( p );
+        p = json_int( p, NULL, i, &rem );
+    p = json_arrClose( p, &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
     static char const rslt[] = "{\"a\":[0,1,2,3]}";
     check( p - buff == sizeof rslt - 1 );
     check( 0 == strcmp( buff, rslt ) );
@@ -250,23 +2026,83 @@ static int array( void ) {
 
 static int real( void ) {
     char buff[64];
-    char* p = json_objOpen( buff, NULL );
-    p = json_arrOpen( p, "data" );
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_arrOpen( p, "data", &rem );
     static double const lut[] = { 0.2, 2e-6, 5e6 };
     for( int i = 0; i < sizeof lut / sizeof *lut; ++i )
-        p = json_double( p, NULL, lut[i] );
-    p = json_arrClose( p );
-    p = json_objClose( p );
-    p = json_end( p );
-#ifdef NO_SPRINTF
-    static char const rslt1[] = "{\"data\":[0,0,5000000]}";
-    static char const rslt2[] = "{\"data\":[0,0,5000000]}";
-#else
-    static char const rslt1[] = "{\"data\":[0.2,2e-006,5e+006]}";
-    static char const rslt2[] = "{\"data\":[0.2,2e-06,5e+06]}";
-#endif
-    check( p - buff == sizeof rslt1 - 1 || p - buff == sizeof rslt2 - 1 );
-    check( 0 == strcmp( buff, rslt1 ) ||  0 == strcmp( buff, rslt2 ) );
+        p = json_double( p, NULL, lut[i], &rem );
+    p = json_arrClose( p, &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
+    static char const rslt[] = "{\"data\":[0.2,0.000002,5000000]}";
+    check( p - buff == sizeof rslt - 1 );
+    check( 0 == strcmp( buff, rslt ) );
+    done();
+}
+
+static int notation( void ) {
+    static struct { double value; char const* text; } const lut[] = {
+        { 0.0,      "0,"          }, { -0.0,     "-0,"         },
+        { 1.0,      "1,"          }, { -1.5,     "-1.5,"       },
+        { 0.1,      "0.1,"        }, { 1e-6,     "0.000001,"   },
+        { 1e-7,     "1e-7,"       }, { 1.25e-7,  "1.25e-7,"    },
+        { 123.456,  "123.456,"    }, { 1e20,     "100000000000000000000," },
+        { 1e21,     "1e+21,"      }, { 5e-324,   "5e-324,"     },
+        { 1.7976931348623157e308, "1.7976931348623157e+308," },
+        { 0.30000000000000004,    "0.30000000000000004,"     },
+    };
+    for( int i = 0; i < sizeof lut / sizeof *lut; ++i ) {
+        char buff[ 64 ];
+        size_t rem = sizeof buff - 1;
+        char* p = json_double( buff, NULL, lut[i].value, &rem );
+        check( p - buff == strlen( lut[i].text ) );
+        check( 0 == strcmp( buff, lut[i].text ) );
+    }
+    char buff[ 64 ];
+    size_t rem = sizeof buff - 1;
+    char* p = json_objOpen( buff, NULL, &rem );
+    p = json_double( p, "nan", 0.0 / 0.0, &rem );
+    p = json_double( p, "inf", 1.0 / 0.0, &rem );
+    p = json_objClose( p, &rem );
+    p = json_end( p, &rem );
+    static char const rslt[] = "{\"nan\":null,\"inf\":null}";
+    check( p - buff == sizeof rslt - 1 );
+    check( 0 == strcmp( buff, rslt ) );
+    done();
+}
+
+/* Check that the text of a double is read back as the same double. */
+static int readback( double value ) {
+    char buff[ 64 ];
+    size_t rem = sizeof buff - 1;
+    char* p = json_double( buff, NULL, value, &rem );
+    p[-1] = '\0';
+    double const read = strtod( buff, NULL );
+    return 0 == memcmp( &read, &value, sizeof value );
+}
+
+static int roundtrip( void ) {
+    uint64_t seed = 88172645463325252ull;
+    for( int i = 0; i < 1000000; ++i ) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        double value;
+        memcpy( &value, &seed, sizeof value );
+        if ( value != value || value - value != 0 )
+            continue;
+        check( readback( value ) );
+        check( readback( (double)(int64_t)( seed >> 11 ) / 1e6 ) );
+    }
+    for( int e = -1074; e < 1024; ++e ) {
+        check( readback( ldexp( 1.0, e ) ) );
+        check( readback( nextafter( ldexp( 1.0, e ), 0.0 ) ) );
+        check( readback( nextafter( ldexp( 1.0, e ), 1e308 ) ) );
+    }
+    for( int e = -323; e < 309; ++e ) {
+        check( readback( pow( 10, e ) ) );
+    }
     done();
 }
 
@@ -275,12 +2111,36 @@ static int real( void ) {
 int main( void ) {
     static struct test const tests[] = {
         { escape,    "Escape characters"        },
+        { allchars,  "Escape all characters"    },
+        { truncation, "Truncated string"        },
+        { capacity,  "Buffer capacity"          },
+        { overflow,  "Writer overflow"          },
+        { measure,   "Writer measure"           },
+        { arena,     "Writer on an arena"       },
+        { stream,    "Writer on a stream"       },
+        { parts,     "Parts of an array"        },
+        { misuse,    "Writer misuse"            },
+        { schema,    "Schema serializers"       },
+        { keys,      "Encoded keys"             },
+        { bulk,      "Arrays of values"         },
+        { fragments, "Raw values and fragments" },
+        { vectored,  "Vectored strings"         },
+        { sized,     "Strings with length"      },
+        { utf8,      "UTF-8 policies"           },
+        { binary,    "Base64 and hexadecimal"   },
+        { fixed,     "Fixed-width numbers"      },
+        { templates, "Templates"                },
+        { reformat,  "Reformatter"              },
+        { instrumentation, "Instrumentation"    },
         { len,       "Non-null-terminated"      },
         { empty,     "Empty objects and arrays" },
         { primitive, "Primitives values"        },
         { integers,  "Integers values"          },
+        { digits,    "Integer digits"           },
         { array,     "Array"                    },
-        { real,      "Real"                     }
+        { real,      "Real"                     },
+        { notation,  "Real notation"            },
+        { roundtrip, "Real round trip"          }
     };
     return test_suit( tests, sizeof tests / sizeof *tests );
 }